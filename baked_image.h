@@ -0,0 +1,24 @@
+// Bio-Hybrid Coffee Machine Example - Copyright (c) 2021 Bio-Hybrid GmbH
+#pragma once
+
+#include <QtEndian>
+
+/// File layout of a pre-scaled, pre-decoded image written by the image-baker tool.
+///
+/// The header is followed by height * bytesPerLine bytes of pixels in the QImage::Format given by
+/// `format`, so the image can be used straight from the resource data without decoding.
+namespace BakedImage {
+
+    constexpr char magic[8] = {'C', 'W', 'I', 'M', 'G', 'v', '0', '1'};
+    constexpr char fileSuffix[] = "cwimg";
+
+    struct Header {
+        char magic[8];
+        quint32_le width;
+        quint32_le height;
+        quint32_le bytesPerLine;
+        quint32_le format;
+        quint32_le reserved[2];
+    };
+    static_assert(sizeof(Header) == 32, "the pixel data has to stay 32-bit aligned to the header");
+}
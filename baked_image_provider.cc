@@ -0,0 +1,158 @@
+// Bio-Hybrid Coffee Machine Example - Copyright (c) 2021 Bio-Hybrid GmbH
+#include "baked_image_provider.h"
+#include "baked_image.h"
+
+#include <QDir>
+#include <QImageReader>
+#include <QQuickTextureFactory>
+#include <QResource>
+#include <QRunnable>
+#include <QDebug>
+
+#include <algorithm>
+#include <cstring>
+
+// -------------------------------------------------------------------------------------------------
+namespace {
+    class BakedImageResponse : public QQuickImageResponse, public QRunnable
+    {
+    public:
+        BakedImageResponse(BakedImageProvider* provider, const QString& id, const QSize& requestedSize)
+            : provider_(provider), id_(id), requestedSize_(requestedSize)
+        {
+            setAutoDelete(false);
+        }
+
+        QQuickTextureFactory* textureFactory() const override {
+            return QQuickTextureFactory::textureFactoryForImage(image_);
+        }
+
+        QString errorString() const override {
+            return image_.isNull() ? QString("No image for '%1'").arg(id_) : QString();
+        }
+
+        void run() override {
+            image_ = provider_->image(id_, requestedSize_);
+            emit finished();
+        }
+
+    private:
+        BakedImageProvider* provider_;
+        const QString id_;
+        const QSize requestedSize_;
+        QImage image_;
+    };
+}
+
+// -------------------------------------------------------------------------------------------------
+BakedImageProvider::BakedImageProvider(int cacheBytes)
+{
+    cache_.setMaxCost(cacheBytes);
+    pool_.setMaxThreadCount(1);
+
+    // Variants are named <name>@<w>x<h>.cwimg, sorted by area for bestVariant()
+    const auto suffix = QString(".") + BakedImage::fileSuffix;
+    for (const auto& fileName : QDir(":/baked").entryList({"*" + suffix}, QDir::Files)) {
+        const auto at = fileName.lastIndexOf('@');
+        const auto dims = fileName.mid(at + 1, fileName.size() - at - 1 - suffix.size()).split('x');
+        if (at <= 0 || dims.size() != 2) continue;
+        variants_[fileName.left(at)].append({QSize(dims.at(0).toInt(), dims.at(1).toInt()),
+                                             ":/baked/" + fileName});
+    }
+    for (auto& list : variants_) {
+        std::sort(list.begin(), list.end(), [](const Variant& a, const Variant& b) {
+            return qint64(a.size.width()) * a.size.height() < qint64(b.size.width()) * b.size.height();
+        });
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+QQuickImageResponse* BakedImageProvider::requestImageResponse(const QString& id, const QSize& requestedSize)
+{
+    const auto response = new BakedImageResponse(this, id, requestedSize);
+    pool_.start(response);
+    return response;
+}
+
+// -------------------------------------------------------------------------------------------------
+QImage BakedImageProvider::image(const QString& id, const QSize& requestedSize)
+{
+    const auto variant = bestVariant(id, requestedSize);
+    const auto key = variant ? variant->path
+                   : QString("%1@%2x%3").arg(id).arg(requestedSize.width()).arg(requestedSize.height());
+    {
+        QMutexLocker lock(&cacheMutex_);
+        if (const auto cached = cache_.object(key)) return *cached;
+    }
+
+    QImage image;
+    int cost = 0;
+    if (variant) {
+        image = loadBaked(variant->path, &cost);
+    } else {
+        // Not baked: decode at the requested size, JPEG decoders scale while decoding
+        QImageReader reader(":/images/" + id);
+        const auto size = reader.size();
+        if (requestedSize.isValid() && size.isValid()) {
+            reader.setScaledSize(size.scaled(requestedSize.boundedTo(size), Qt::KeepAspectRatio));
+        }
+        image = reader.read();
+        cost = image.sizeInBytes();
+    }
+
+    // Images used in place of the resource data cost no memory and are not cached
+    if (cost > 0 && !image.isNull()) {
+        QMutexLocker lock(&cacheMutex_);
+        cache_.insert(key, new QImage(image), cost);
+    }
+    return image;
+}
+
+// -------------------------------------------------------------------------------------------------
+const BakedImageProvider::Variant* BakedImageProvider::bestVariant(const QString& id, const QSize& requestedSize) const
+{
+    const auto it = variants_.find(id);
+    if (it == variants_.end() || it->isEmpty()) return nullptr;
+    if (!requestedSize.isValid()) return &it->last();
+
+    for (const auto& variant : *it) {
+        if (variant.size.width() >= requestedSize.width() && variant.size.height() >= requestedSize.height()) {
+            return &variant;
+        }
+    }
+    return &it->last();
+}
+
+// -------------------------------------------------------------------------------------------------
+QImage BakedImageProvider::loadBaked(const QString& path, int* cost)
+{
+    const QResource resource(path);
+    QByteArray data;
+    if (resource.isCompressed()) {
+        data = qUncompress(resource.data(), int(resource.size()));
+    } else {
+        data = QByteArray::fromRawData(reinterpret_cast<const char*>(resource.data()), int(resource.size()));
+    }
+
+    BakedImage::Header header;
+    if (data.size() < int(sizeof(header))) return {};
+    std::memcpy(&header, data.constData(), sizeof(header));
+    if (std::memcmp(header.magic, BakedImage::magic, sizeof(header.magic)) != 0
+        || data.size() - int(sizeof(header)) < qint64(header.height) * header.bytesPerLine) {
+        qWarning() << "Invalid baked image" << path;
+        return {};
+    }
+
+    const auto pixels = reinterpret_cast<const uchar*>(data.constData()) + sizeof(header);
+    const QImage view(pixels, int(header.width), int(header.height), int(header.bytesPerLine),
+                      QImage::Format(quint32(header.format)));
+
+    // Uncompressed and aligned resource data lives as long as the executable
+    if (!resource.isCompressed() && reinterpret_cast<quintptr>(pixels) % 4 == 0) {
+        *cost = 0;
+        return view;
+    }
+    const auto copy = view.copy();
+    *cost = copy.sizeInBytes();
+    return copy;
+}
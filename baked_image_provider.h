@@ -0,0 +1,41 @@
+// Bio-Hybrid Coffee Machine Example - Copyright (c) 2021 Bio-Hybrid GmbH
+#pragma once
+
+#include <QCache>
+#include <QHash>
+#include <QImage>
+#include <QMutex>
+#include <QQuickAsyncImageProvider>
+#include <QThreadPool>
+#include <QVector>
+
+/// Asynchronous image provider for the images baked by the image-baker tool.
+///
+/// `image://baked/<name>` resolves to the smallest baked variant covering the requested
+/// sourceSize. Variants are used straight from the resource data when possible. Other images are
+/// decoded from `:/images/<name>` at the requested size. Decoded images are kept in a cache
+/// bounded by `cacheBytes`.
+class BakedImageProvider : public QQuickAsyncImageProvider
+{
+public:
+    explicit BakedImageProvider(int cacheBytes = 8 * 1024 * 1024);
+
+    QQuickImageResponse* requestImageResponse(const QString& id, const QSize& requestedSize) override;
+
+    /// Loads the image for `id` and `requestedSize`, called on the provider's worker threads
+    QImage image(const QString& id, const QSize& requestedSize);
+
+private:
+    struct Variant {
+        QSize size;
+        QString path;
+    };
+
+    const Variant* bestVariant(const QString& id, const QSize& requestedSize) const;
+    static QImage loadBaked(const QString& path, int* cost);
+
+    QHash<QString, QVector<Variant>> variants_;
+    QMutex cacheMutex_;
+    QCache<QString, QImage> cache_;
+    QThreadPool pool_;
+};
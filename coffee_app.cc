@@ -1,23 +1,255 @@
 // Bio-Hybrid Coffee Machine Example - Copyright (c) 2021 Bio-Hybrid GmbH
 #include "coffee_app.h"
+#include "baked_image_provider.h"
+#include "coffee_maker_proxy.h"
+#include "frame_benchmark.h"
+#include "metrics_server.h"
+#include "recipe_file_loader.h"
+#include "recipe_filter_model.h"
+#include "recipe_model.h"
+#include "remote_control_server.h"
+#include "startup_orchestrator.h"
+#include "startup_timeline.h"
 
 #include <coffeemaker/coffeemaker.h>
+#include <coffeemaker/coffeemakertelemetry.h>
+#include <coffeemaker/consumptionlog.h>
 #include <coffeeweb/coffeeweb.h>
+#include <coffeeweb/recipecatalog.h>
 
+#include <QCommandLineParser>
+#include <QFile>
 #include <QGuiApplication>
 #include <QQmlApplicationEngine>
 #include <QQmlContext>
+#include <QQuickWindow>
+#include <QTimer>
 
 #include <QDebug>
 
+#include <memory>
+
+// -------------------------------------------------------------------------------------------------
+namespace {
+    /// The recipes of a catalog, read on a worker
+    struct CatalogRecipes {
+        QVector<Recipe> recipes;
+        QString collectionVersion;
+        QString errorString;    ///< empty if the catalog was read
+    };
+}
+
 // -------------------------------------------------------------------------------------------------
 CoffeeApp::CoffeeApp(int& argc, char** argv)
     : QGuiApplication(argc, argv)
-    , m_coffeeMaker(new CoffeeMaker(this))
+    , m_coffeeMaker(new CoffeeMakerProxy(this))
     , m_coffeeWeb(new CoffeeWeb(this))
+    , m_recipeModel(new RecipeModel(this))
+    , m_recipeFilter(new RecipeFilterModel(m_recipeModel, this))
 {
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Bio-Hybrid Coffee Machine");
+    parser.addHelpOption();
+    const QCommandLineOption recipesUrlOption("recipes-url",
+        "Fetch the recipes via HTTP from <url> instead of the simulated backend.", "url");
+    parser.addOption(recipesUrlOption);
+    const QCommandLineOption recipesFileOption("recipes",
+        "Load the recipes from <file> (recipes JSON or compiled catalog), reloaded when it changes.",
+        "file");
+    parser.addOption(recipesFileOption);
+    const QCommandLineOption mergeRecipesOption("merge-recipes",
+        "Merge the recipes file with the CoffeeWeb collection, file recipes win on equal names.");
+    parser.addOption(mergeRecipesOption);
+    const QCommandLineOption measureStartupOption("measure-startup",
+        "Turn the machine on, log the startup timeline once the menu is interactive and quit.");
+    parser.addOption(measureStartupOption);
+    const QCommandLineOption warmUpOption("warm-up",
+        "Create the remaining screens in the background after the first frame.");
+    parser.addOption(warmUpOption);
+    const QCommandLineOption metricsOption("metrics",
+        "Serve Prometheus metrics on <address>, tcp:<port> for localhost or unix:<name>.", "address");
+    parser.addOption(metricsOption);
+    const QCommandLineOption telemetryOption("telemetry",
+        "Publish the machine state to the POSIX shared-memory segment <name> "
+        "(read it with coffeemaker-telemetry).", "name");
+    parser.addOption(telemetryOption);
+    const QCommandLineOption remoteOption("remote",
+        "Accept remote-control connections on the local socket <name> (see coffee-remote).", "name");
+    parser.addOption(remoteOption);
+    const QCommandLineOption consumptionLogOption("consumption-log",
+        "Append every dispensed cup to the consumption log <file> (see coffeemaker-consumption).", "file");
+    parser.addOption(consumptionLogOption);
+    const QCommandLineOption frameBenchmarkOption("frame-benchmark",
+        "Run a scripted session through all screens offscreen, log the frame times and quit.");
+    parser.addOption(frameBenchmarkOption);
+    const QCommandLineOption frameReportOption("frame-report",
+        "Write the results of --frame-benchmark as JSON to <file>.", "file");
+    parser.addOption(frameReportOption);
+    parser.process(*this);
+
+    m_startup = new StartupTimeline(parser.isSet(measureStartupOption), this);
+    m_startup->mark("application created");
+
+    // The machine is created with its persisted levels on the machine thread and the recipes are
+    // fetched while the QML loads
+    m_orchestrator = new StartupOrchestrator(m_startup, this);
+    m_orchestrator->begin("machine ready");
+    if (m_coffeeMaker->isReady()) {
+        m_orchestrator->end("machine ready");
+    } else {
+        connect(m_coffeeMaker, &CoffeeMakerProxy::ready, this, [this]() { m_orchestrator->end("machine ready"); });
+    }
+    connect(m_orchestrator, &StartupOrchestrator::finished, this, [this]() {
+        if (!m_startup->measuring()) m_startup->report();
+    });
+
+    // The menu shows which recipes can be made with the current machine supplies
+    connect(m_coffeeMaker, &CoffeeMakerProxy::beansContainerLevelChanged, this, [this](int level) {
+        m_recipeModel->setSupply(RecipeAvailability::Beans, level);
+    });
+    connect(m_coffeeMaker, &CoffeeMakerProxy::waterContainerLevelChanged, this, [this](int level) {
+        m_recipeModel->setSupply(RecipeAvailability::Water, level);
+    });
+    connect(m_coffeeMaker, &CoffeeMakerProxy::milkContainerLevelChanged, this, [this](int level) {
+        m_recipeModel->setSupply(RecipeAvailability::Milk, level);
+    });
+    const auto updateRestBinSpace = [this]() {
+        m_recipeModel->setSupply(RecipeAvailability::RestBinSpace,
+                                 m_coffeeMaker->restBinLevelMax() - m_coffeeMaker->restBinLevel());
+    };
+    connect(m_coffeeMaker, &CoffeeMakerProxy::restBinLevelChanged, this, updateRestBinSpace);
+    connect(m_coffeeMaker, &CoffeeMakerProxy::ready, this, updateRestBinSpace);
+
+    if (parser.isSet(recipesUrlOption)) {
+        m_coffeeWeb->setBackendUrl(QUrl::fromUserInput(parser.value(recipesUrlOption)));
+    }
+
+    // Recipes are streamed and applied as delta to the menu model. A refresh of an unchanged
+    // collection version is cancelled before any recipe is decoded.
+    // When merged, the recipes of the web collection are kept to reapply them with the file recipes
+    m_mergeRecipes = parser.isSet(recipesFileOption) && parser.isSet(mergeRecipesOption);
+    connect(m_coffeeWeb, &CoffeeWeb::recipesCollectionReceived, this,
+    [this](quint32 id, const QString&, const QString& version) {
+        if (id != m_recipesRequestId) return;
+        if (!version.isEmpty() && version == m_recipeModel->collectionVersion()) {
+            m_coffeeWeb->cancelRequest(id);
+            return;
+        }
+        m_recipeModel->beginUpdate(version);
+        m_webUpdating = true;
+        m_pendingWebRecipes.clear();
+    });
+
+    connect(m_coffeeWeb, &CoffeeWeb::recipesChunkReceived, this,
+    [this](quint32 id, const QVector<Recipe>& recipes) {
+        if (id != m_recipesRequestId) return;
+        if (m_mergeRecipes) {
+            // File recipes win, a web recipe of the same name never replaces them in the menu
+            m_recipeModel->updateRecipes(withoutFileRecipes(recipes));
+            m_pendingWebRecipes += recipes;
+        } else {
+            m_recipeModel->updateRecipes(recipes);
+        }
+    });
+
+    connect(m_coffeeWeb, &CoffeeWeb::recipesStreamFinished, this,
+    [this](quint32 id, int returnCode, const QString& errorMessage) {
+        if (id != m_recipesRequestId) return;
+        m_orchestrator->end("recipes");
+        m_webUpdating = false;
+        if (returnCode != 200) {
+            qWarning() << "Receiving recipes failed:" << returnCode << errorMessage;
+            m_recipeModel->abortUpdate();
+            // File recipes that changed during the update are applied now
+            if (m_mergeRecipes && !m_fileRecipes.isEmpty()) applyFileRecipes(QString());
+            return;
+        }
+        if (m_mergeRecipes) {
+            // The file may have changed during the update, unchanged recipes are not signalled again
+            m_recipeModel->updateRecipes(withoutFileRecipes(m_pendingWebRecipes) + m_fileRecipes);
+            m_webRecipes = std::move(m_pendingWebRecipes);
+            m_pendingWebRecipes.clear();
+        }
+        m_recipeModel->endUpdate();
+        m_recipeFilter->updateIndex();
+        emit receipesReceived();
+    });
+
+    if (parser.isSet(metricsOption)) {
+        const auto metricsServer = new MetricsServer(this);
+        const auto webMetrics = m_coffeeWeb->metrics();
+        metricsServer->addCollector([webMetrics](QTextStream& out) { Prometheus::writeCoffeeWeb(out, *webMetrics); });
+        const auto addMachineCollector = [this, metricsServer]() {
+            const auto makerMetrics = m_coffeeMaker->metrics();
+            metricsServer->addCollector([makerMetrics](QTextStream& out) {
+                Prometheus::writeCoffeeMaker(out, *makerMetrics);
+            });
+        };
+        if (m_coffeeMaker->isReady()) addMachineCollector();
+        else connect(m_coffeeMaker, &CoffeeMakerProxy::ready, this, addMachineCollector);
+        // A failed listen is only logged, the machine works without metrics
+        metricsServer->listen(parser.value(metricsOption));
+    }
+
+    if (parser.isSet(telemetryOption)) {
+        // Lives on the machine thread as a child of the machine, the segment is removed with it
+        const auto name = parser.value(telemetryOption);
+        m_coffeeMaker->invoke([name](CoffeeMaker* maker) { (new CoffeeMakerTelemetry(maker, name))->open(); });
+    }
+
+    if (parser.isSet(remoteOption)) {
+        // Served on the machine thread, so remote commands never wait for the GUI
+        const auto name = parser.value(remoteOption);
+        m_coffeeMaker->invoke([name](CoffeeMaker* maker) { (new RemoteControlServer(maker))->listen(name); });
+    }
+
+    if (parser.isSet(consumptionLogOption)) {
+        // Written on the machine thread, the last rows are flushed when the machine is deleted
+        const auto fileName = parser.value(consumptionLogOption);
+        m_coffeeMaker->invoke([fileName](CoffeeMaker* maker) {
+            const auto log = new ConsumptionLog(maker);
+            if (!log->open(fileName)) {
+                qWarning() << "Consumption log" << fileName << "not opened:" << log->errorString();
+                delete log;
+                return;
+            }
+            QObject::connect(maker, &CoffeeMaker::cupDispensed, log, &ConsumptionLog::record);
+        });
+    }
+
+    const auto useWeb = !parser.isSet(recipesFileOption) || m_mergeRecipes;
+    m_orchestrator->begin("recipes");
+    if (parser.isSet(recipesFileOption)) {
+        const auto loader = new RecipeFileLoader(parser.value(recipesFileOption), this);
+        connect(loader, &RecipeFileLoader::recipesLoaded, this,
+        [this](const QVector<Recipe>& recipes, const QString& version) {
+            if (!m_mergeRecipes) m_orchestrator->end("recipes");
+            m_fileRecipes = recipes;
+            m_fileRecipeNames.clear();
+            for (const auto& recipe : recipes) m_fileRecipeNames.insert(recipe.name);
+            applyFileRecipes(version);
+        });
+        connect(loader, &RecipeFileLoader::loadFailed, this, [this]() {
+            if (!m_mergeRecipes) m_orchestrator->end("recipes");
+        });
+        loader->start();
+    } else {
+        // The catalog compiled at build time fills the menu before the first web reply. A reply
+        // of the same collection version is then cancelled before any recipe is decoded.
+        loadBundledCatalog(applicationDirPath() + "/recipes.bin");
+    }
+
+    if (useWeb) {
+        const auto refreshTimer = new QTimer(this);
+        refreshTimer->setInterval(60 * 1000);
+        connect(refreshTimer, &QTimer::timeout, this, &CoffeeApp::requestRecipes);
+        refreshTimer->start();
+        requestRecipes();
+    }
+
     const auto engine = new QQmlApplicationEngine(this);
     qmlRegisterUncreatableType<CoffeeMaker>("CoffeeMaker", 1, 0, "CoffeeMaker", "Uncreatable type");
+    qmlRegisterUncreatableType<RecipeFilterModel>("CoffeeMaker", 1, 0, "RecipeFilter", "Uncreatable type");
     qmlRegisterUncreatableMetaObject(
       SCREENLIST_NAMESPACE::staticMetaObject, // static meta object
       "screenlistEnum",                // import statement (can be any string)
@@ -29,37 +261,161 @@ CoffeeApp::CoffeeApp(int& argc, char** argv)
 
     // Register the application's coffeemaker object with the engine so it is available in Qml.
     // it is registered with the name : 'maker'
-    _coffeeList.clear();
     const auto rootContext = engine->rootContext();
     rootContext->setContextProperty("maker", m_coffeeMaker);
     rootContext->setContextProperty("coffee", this);
+    rootContext->setContextProperty("recipeModel", m_recipeModel);
+    rootContext->setContextProperty("recipeFilter", m_recipeFilter);
+    rootContext->setContextProperty("startup", m_startup);
     rootContext->setContextProperty("applicationDirPath", QGuiApplication::applicationDirPath());
+    engine->addImageProvider("baked", new BakedImageProvider);
     // Load our main qml file
     engine->addImportPath("qrc:/");
+    m_orchestrator->begin("first frame");
+    m_orchestrator->begin("qml load");
     engine->load(QUrl(QStringLiteral("qrc:/main.qml")));
+    m_orchestrator->end("qml load");
 
+    // The bundled recipes are applied before the event loop delivers the first web reply
+    m_orchestrator->join("bundled recipes");
 
+    const auto window = qobject_cast<QQuickWindow*>(engine->rootObjects().value(0));
+    if (window) watchStartup(window, parser.isSet(warmUpOption));
 
-    quint32 old_id = 0;
-    connect(m_coffeeWeb, &CoffeeWeb::recipesRequestReply, this,
-    [&](quint32 id, const QString& json) {
+    if (parser.isSet(frameBenchmarkOption)) {
+        if (!window) {
+            qWarning() << "Frame benchmark: no window";
+            QTimer::singleShot(0, this, [this]() { exit(1); });
+            return;
+        }
+        // The machine steps finish within the ticks of the states screen
+        m_coffeeMaker->invoke([](CoffeeMaker* maker) { maker->setTimeScale(0.05); });
+        const auto benchmark = new FrameBenchmark(window, m_coffeeMaker, this);
+        const auto reportFile = parser.value(frameReportOption);
+        connect(benchmark, &FrameBenchmark::finished, this, [this, benchmark, reportFile](bool completed) {
+            const auto written = benchmark->report(reportFile);
+            exit(completed && written ? 0 : 1);
+        });
+        benchmark->start();
+    }
+}
 
-        //if(id != old_id)
-        {
-            _coffeeList = json;
-            //qDebug() << "#### Received JSON:" << id << "\n" << qPrintable(json);
-            emit receipesReceived(_coffeeList);
+void CoffeeApp::requestRecipes() {
+    if (m_recipesRequestId) {
+        m_coffeeWeb->cancelRequest(m_recipesRequestId);
+        m_recipeModel->abortUpdate();
+        m_webUpdating = false;
+    }
+    m_recipesRequestId = m_coffeeWeb->requestRecipesStreamed();
+}
 
-            old_id = id;
-        }
+// -------------------------------------------------------------------------------------------------
+void CoffeeApp::applyFileRecipes(const QString& collectionVersion)
+{
+    // A running web update picks up the file recipes when it finishes
+    if (m_webUpdating) return;
 
+    // The merged collection is applied at once, each recipe is compared and signalled once
+    if (m_mergeRecipes) {
+        m_recipeModel->beginUpdate(m_recipeModel->collectionVersion());
+        m_recipeModel->updateRecipes(withoutFileRecipes(m_webRecipes) + m_fileRecipes);
+    } else {
+        m_recipeModel->beginUpdate(collectionVersion);
+        m_recipeModel->updateRecipes(m_fileRecipes);
+    }
+    m_recipeModel->endUpdate();
+    m_recipeFilter->updateIndex();
+    emit receipesReceived();
+}
+
+// -------------------------------------------------------------------------------------------------
+void CoffeeApp::loadBundledCatalog(const QString& fileName)
+{
+    if (!QFile::exists(fileName)) return;
 
+    // Opening validates the name index and every string of the catalog. The catalog is opened
+    // and copied into recipes on a worker while the QML loads, the GUI thread only applies them.
+    m_orchestrator->run<CatalogRecipes>("bundled recipes", [fileName]() {
+        CatalogRecipes read;
+        RecipeCatalog catalog;
+        if (!catalog.open(fileName)) {
+            read.errorString = catalog.errorString();
+            return read;
+        }
+        read.collectionVersion = catalog.collectionVersion();
+        read.recipes.reserve(catalog.count());
+        for (int i = 0; i < catalog.count(); ++i) read.recipes.append(catalog.recipe(i));
+        return read;
+    }, [this](const CatalogRecipes& read) {
+        if (!read.errorString.isEmpty()) {
+            qWarning() << "Bundled recipes not loaded:" << read.errorString;
+            return;
+        }
+        m_recipeModel->beginUpdate(read.collectionVersion);
+        m_recipeModel->updateRecipes(read.recipes);
+        m_recipeModel->endUpdate();
+        m_recipeFilter->updateIndex();
+        m_orchestrator->end("recipes");
+        emit receipesReceived();
     });
-    m_coffeeWeb->requestRecipes();
 }
 
-QString CoffeeApp::coffeeList() {
-    return _coffeeList;
+// -------------------------------------------------------------------------------------------------
+QVector<Recipe> CoffeeApp::withoutFileRecipes(const QVector<Recipe>& recipes) const
+{
+    QVector<Recipe> web;
+    web.reserve(recipes.size());
+    for (const auto& recipe : recipes) {
+        if (!m_fileRecipeNames.contains(recipe.name)) web.append(recipe);
+    }
+    return web;
+}
+
+RecipeModel* CoffeeApp::recipes() const {
+    return m_recipeModel;
+}
+
+// -------------------------------------------------------------------------------------------------
+void CoffeeApp::watchStartup(QQuickWindow* window, bool warmUpScreens)
+{
+    // frameSwapped is emitted by the render thread, the queued connection brings it to this thread.
+    // The menu is interactive with the first frame after it is loaded and filled with recipes.
+    const auto firstFrame = std::make_shared<bool>(true);
+    const auto menuLoaded = std::make_shared<bool>(false);
+    const auto frameConnection = std::make_shared<QMetaObject::Connection>();
+    *frameConnection = connect(window, &QQuickWindow::frameSwapped, this,
+    [this, window, warmUpScreens, firstFrame, menuLoaded, frameConnection]() {
+        if (*firstFrame) {
+            *firstFrame = false;
+            m_orchestrator->end("first frame");
+            if (warmUpScreens) {
+                QMetaObject::invokeMethod(window->findChild<QObject*>("windowManager"), "warmUp");
+            }
+        }
+        if (!*menuLoaded || m_recipeModel->rowCount() == 0) return;
+
+        m_startup->mark("menu interactive");
+        disconnect(*frameConnection);
+        if (m_startup->measuring()) {
+            m_startup->report();
+            quit();
+        }
+    }, Qt::QueuedConnection);
+
+    connect(m_startup, &StartupTimeline::marked, window, [window, menuLoaded](const QString& name) {
+        if (name != "menu screen loaded") return;
+        *menuLoaded = true;
+        window->update();
+    });
+    connect(m_recipeModel, &RecipeModel::countChanged, window, &QQuickWindow::update);
+
+    if (m_startup->measuring()) {
+        QTimer::singleShot(30 * 1000, this, [this]() {
+            qWarning() << "The menu did not become interactive within 30 s";
+            m_startup->report();
+            exit(1);
+        });
+    }
 }
 
 
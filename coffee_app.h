@@ -1,10 +1,19 @@
 // Bio-Hybrid Coffee Machine Example - Copyright (c) 2021 Bio-Hybrid GmbH
 #pragma once
 
+#include <coffeeweb/recipe.h>
+
 #include <QGuiApplication>
+#include <QSet>
+#include <QVector>
 
-class CoffeeMaker;
+class CoffeeMakerProxy;
 class CoffeeWeb;
+class RecipeFilterModel;
+class RecipeModel;
+class StartupOrchestrator;
+class StartupTimeline;
+class QQuickWindow;
 
 
 namespace SCREENLIST_NAMESPACE {
@@ -22,17 +31,32 @@ namespace SCREENLIST_NAMESPACE {
 class CoffeeApp : public QGuiApplication
 {
     Q_OBJECT
-    Q_PROPERTY( QString coffeeList READ coffeeList NOTIFY receipesReceived )
 public:
     CoffeeApp(int& argc, char** argv);
-    QString coffeeList();
+    RecipeModel* recipes() const;
 
 
 private:
-    QString _coffeeList;
-    CoffeeMaker* m_coffeeMaker;
+    void requestRecipes();
+    void applyFileRecipes(const QString& collectionVersion);
+    void loadBundledCatalog(const QString& fileName);
+    QVector<Recipe> withoutFileRecipes(const QVector<Recipe>& recipes) const;
+    void watchStartup(QQuickWindow* window, bool warmUpScreens);
+
+    CoffeeMakerProxy* m_coffeeMaker;
     CoffeeWeb* m_coffeeWeb;
+    RecipeModel* m_recipeModel;
+    RecipeFilterModel* m_recipeFilter;
+    quint32 m_recipesRequestId = 0;
+    bool m_webUpdating = false;
+    bool m_mergeRecipes = false;
+    QVector<Recipe> m_webRecipes;
+    QVector<Recipe> m_pendingWebRecipes;
+    QVector<Recipe> m_fileRecipes;
+    QSet<QString> m_fileRecipeNames;
+    StartupTimeline* m_startup = nullptr;
+    StartupOrchestrator* m_orchestrator = nullptr;
 signals:
-    void receipesReceived(QString data);
+    void receipesReceived();
 
 };
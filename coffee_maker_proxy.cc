@@ -0,0 +1,205 @@
+// Bio-Hybrid Coffee Machine Example - Copyright (c) 2021 Bio-Hybrid GmbH
+#include "coffee_maker_proxy.h"
+
+#include <QThread>
+
+// -------------------------------------------------------------------------------------------------
+CoffeeMakerProxy::CoffeeMakerProxy(QObject* parent)
+    : QObject(parent)
+    , thread_(new QThread(this))
+    , context_(new QObject)
+{
+    qRegisterMetaType<CoffeeMaker::State>("CoffeeMaker::State");
+
+    thread_->setObjectName("coffeemaker");
+    context_->moveToThread(thread_);
+    connect(thread_, &QThread::finished, context_, &QObject::deleteLater);
+    thread_->start();
+
+    // Posted first, so every forwarded call runs after the machine exists
+    QMetaObject::invokeMethod(context_, [this]() { createMachine(); }, Qt::QueuedConnection);
+}
+
+// -------------------------------------------------------------------------------------------------
+CoffeeMakerProxy::~CoffeeMakerProxy()
+{
+    // The machine is deleted with its context when the thread finishes
+    thread_->quit();
+    thread_->wait();
+}
+
+// -------------------------------------------------------------------------------------------------
+void CoffeeMakerProxy::createMachine()
+{
+    // Machine thread
+    maker_ = new CoffeeMaker(context_);
+
+    // Queued to the GUI thread, the proxy is the context object
+    connect(maker_, &CoffeeMaker::waterContainerLevelChanged, this, [this](int level) {
+        mirror(levels_.water, level, &CoffeeMakerProxy::waterContainerLevelChanged);
+    });
+    connect(maker_, &CoffeeMaker::milkContainerLevelChanged, this, [this](int level) {
+        mirror(levels_.milk, level, &CoffeeMakerProxy::milkContainerLevelChanged);
+    });
+    connect(maker_, &CoffeeMaker::beansContainerLevelChanged, this, [this](int level) {
+        mirror(levels_.beans, level, &CoffeeMakerProxy::beansContainerLevelChanged);
+    });
+    connect(maker_, &CoffeeMaker::restBinLevelChanged, this, [this](int level) {
+        mirror(levels_.restBin, level, &CoffeeMakerProxy::restBinLevelChanged);
+    });
+    connect(maker_, &CoffeeMaker::overflowContainerLevelChanged, this, [this](int level) {
+        mirror(levels_.overflow, level, &CoffeeMakerProxy::overflowContainerLevelChanged);
+    });
+    connect(maker_, &CoffeeMaker::cupsProcessedChanged, this, [this](int cups) {
+        mirror(levels_.cupsProcessed, cups, &CoffeeMakerProxy::cupsProcessedChanged);
+    });
+    // A service visit is one queued call, the level types are not registered, so captured by value
+    connect(maker_, &CoffeeMaker::levelsChanged, maker_, [this](const CoffeeMaker::Levels& levels) {
+        QMetaObject::invokeMethod(this, [this, levels]() { mirrorLevels(levels); }, Qt::QueuedConnection);
+    });
+    connect(maker_, &CoffeeMaker::cupDetectedChanged, this, &CoffeeMakerProxy::setCupDetected);
+    // The State argument is not queued as type name "State", the state is captured by value instead
+    connect(maker_, &CoffeeMaker::currentStateChanged, maker_, [this](CoffeeMaker::State state) {
+        QMetaObject::invokeMethod(this, [this, state]() { setState(state); }, Qt::QueuedConnection);
+    });
+
+    const auto levels = maker_->levels();
+
+    CoffeeMaker::Levels maxima;
+    maxima.water = maker_->waterContainerMax();
+    maxima.milk = maker_->milkContainerMax();
+    maxima.beans = maker_->beansContainerMax();
+    maxima.restBin = maker_->restBinLevelMax();
+    maxima.overflow = maker_->overflowContainerMax();
+    maxima.cupsProcessed = maker_->maxCupsProcessedUntilCleanMode();
+
+    const auto state = maker_->currentState();
+    const auto cupDetected = maker_->cupDetected();
+    const auto metrics = maker_->metrics();
+
+    QMetaObject::invokeMethod(this, [=]() {
+        maxima_ = maxima;
+        metrics_ = metrics;
+        mirrorLevels(levels);
+        setCupDetected(cupDetected);
+        setState(state);
+        ready_ = true;
+        emit ready();
+    }, Qt::QueuedConnection);
+}
+
+// -------------------------------------------------------------------------------------------------
+void CoffeeMakerProxy::invoke(std::function<void(CoffeeMaker*)> call)
+{
+    QMetaObject::invokeMethod(context_, [this, call]() { call(maker_); }, Qt::QueuedConnection);
+}
+
+// -------------------------------------------------------------------------------------------------
+void CoffeeMakerProxy::mirror(int& member, int value, void (CoffeeMakerProxy::*changed)(int))
+{
+    if (member == value) return;
+    member = value;
+    emit (this->*changed)(member);
+}
+
+// -------------------------------------------------------------------------------------------------
+void CoffeeMakerProxy::mirrorLevels(const CoffeeMaker::Levels& levels)
+{
+    mirror(levels_.water, levels.water, &CoffeeMakerProxy::waterContainerLevelChanged);
+    mirror(levels_.milk, levels.milk, &CoffeeMakerProxy::milkContainerLevelChanged);
+    mirror(levels_.beans, levels.beans, &CoffeeMakerProxy::beansContainerLevelChanged);
+    mirror(levels_.restBin, levels.restBin, &CoffeeMakerProxy::restBinLevelChanged);
+    mirror(levels_.overflow, levels.overflow, &CoffeeMakerProxy::overflowContainerLevelChanged);
+    mirror(levels_.cupsProcessed, levels.cupsProcessed, &CoffeeMakerProxy::cupsProcessedChanged);
+}
+
+// -------------------------------------------------------------------------------------------------
+void CoffeeMakerProxy::setState(CoffeeMaker::State state)
+{
+    if (state_ == state) return;
+    state_ = state;
+    emit currentStateChanged(state_);
+}
+
+// -------------------------------------------------------------------------------------------------
+void CoffeeMakerProxy::setCupDetected(bool detected)
+{
+    if (cupDetected_ == detected) return;
+    cupDetected_ = detected;
+    emit cupDetectedChanged(cupDetected_);
+}
+
+// -------------------------------------------------------------------------------------------------
+void CoffeeMakerProxy::turnOn() { invoke([](CoffeeMaker* m) { m->turnOn(); }); }
+void CoffeeMakerProxy::turnOff() { invoke([](CoffeeMaker* m) { m->turnOff(); }); }
+void CoffeeMakerProxy::startCommandMode() { invoke([](CoffeeMaker* m) { m->startCommandMode(); }); }
+void CoffeeMakerProxy::setRecipeName(const QString& name) { invoke([name](CoffeeMaker* m) { m->setRecipeName(name); }); }
+void CoffeeMakerProxy::cancelCommandMode() { invoke([](CoffeeMaker* m) { m->cancelCommandMode(); }); }
+void CoffeeMakerProxy::finishCommandMode() { invoke([](CoffeeMaker* m) { m->finishCommandMode(); }); }
+void CoffeeMakerProxy::cleanTheMachine() { invoke([](CoffeeMaker* m) { m->cleanTheMachine(); }); }
+void CoffeeMakerProxy::emptyOverflowContainer() { invoke([](CoffeeMaker* m) { m->emptyOverflowContainer(); }); }
+void CoffeeMakerProxy::emptyRestBinContainer() { invoke([](CoffeeMaker* m) { m->emptyRestBinContainer(); }); }
+
+// -------------------------------------------------------------------------------------------------
+void CoffeeMakerProxy::addMilkToContainer(int milkMl)
+{
+    invoke([milkMl](CoffeeMaker* m) { m->addMilkToContainer(milkMl); });
+}
+
+// -------------------------------------------------------------------------------------------------
+void CoffeeMakerProxy::addWatertoContainer(int waterMl)
+{
+    invoke([waterMl](CoffeeMaker* m) { m->addWatertoContainer(waterMl); });
+}
+
+// -------------------------------------------------------------------------------------------------
+void CoffeeMakerProxy::addBeanstoContainer(int beansGram)
+{
+    invoke([beansGram](CoffeeMaker* m) { m->addBeanstoContainer(beansGram); });
+}
+
+// -------------------------------------------------------------------------------------------------
+void CoffeeMakerProxy::applyMaintenance(const QVariantMap& changes)
+{
+    CoffeeMaker::Maintenance maintenance;
+    maintenance.addBeansGram = changes.value("beans").toInt();
+    maintenance.addWaterMl = changes.value("water").toInt();
+    maintenance.addMilkMl = changes.value("milk").toInt();
+    maintenance.emptyRestBin = changes.value("emptyRestBin").toBool();
+    maintenance.emptyOverflow = changes.value("emptyOverflow").toBool();
+    maintenance.clean = changes.value("clean").toBool();
+    invoke([maintenance](CoffeeMaker* m) { m->applyMaintenance(maintenance); });
+}
+
+// -------------------------------------------------------------------------------------------------
+void CoffeeMakerProxy::doGrinding(int amount, int level)
+{
+    invoke([amount, level](CoffeeMaker* m) { m->doGrinding(amount, CoffeeMaker::GrindLevel(level)); });
+}
+
+// -------------------------------------------------------------------------------------------------
+void CoffeeMakerProxy::doBrew(int amount, int temp)
+{
+    invoke([amount, temp](CoffeeMaker* m) { m->doBrew(amount, temp); });
+}
+
+// -------------------------------------------------------------------------------------------------
+void CoffeeMakerProxy::doMilkPrep(int amount, int temp, bool foam)
+{
+    invoke([amount, temp, foam](CoffeeMaker* m) { m->doMilkPrep(amount, temp, foam); });
+}
+
+// -------------------------------------------------------------------------------------------------
+void CoffeeMakerProxy::placeCup()
+{
+    // Placing a cup always succeeds, the mirror is updated right away for the QML polling it
+    setCupDetected(true);
+    invoke([](CoffeeMaker* m) { m->placeCup(); });
+}
+
+// -------------------------------------------------------------------------------------------------
+void CoffeeMakerProxy::removeCup()
+{
+    setCupDetected(false);
+    invoke([](CoffeeMaker* m) { m->removeCup(); });
+}
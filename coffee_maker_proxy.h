@@ -0,0 +1,118 @@
+// Bio-Hybrid Coffee Machine Example - Copyright (c) 2021 Bio-Hybrid GmbH
+#pragma once
+
+#include <coffeemaker/coffeemaker.h>
+
+#include <QObject>
+#include <QVariantMap>
+
+#include <functional>
+#include <memory>
+
+class QThread;
+
+/// GUI thread stand-in for a CoffeeMaker that runs on its own thread.
+///
+/// The machine is created on the machine thread (reading its persisted levels there). The proxy
+/// mirrors its properties through queued signals and forwards every call as a queued invocation,
+/// so machine activity never blocks the GUI thread. Calls made before the machine exists are run
+/// in order once it does.
+class CoffeeMakerProxy : public QObject
+{
+    Q_OBJECT
+
+    Q_PROPERTY(CoffeeMaker::State currentState READ currentState NOTIFY currentStateChanged)
+    Q_PROPERTY(int waterContainerLevel READ waterContainerLevel NOTIFY waterContainerLevelChanged)
+    Q_PROPERTY(int milkContainerLevel READ milkContainerLevel NOTIFY milkContainerLevelChanged)
+    Q_PROPERTY(int beansContainerLevel READ beansContainerLevel NOTIFY beansContainerLevelChanged)
+    Q_PROPERTY(int restBinLevel READ restBinLevel NOTIFY restBinLevelChanged)
+    Q_PROPERTY(int overflowContainerLevel READ overflowContainerLevel NOTIFY overflowContainerLevelChanged)
+
+    Q_PROPERTY(bool cupDetected READ cupDetected NOTIFY cupDetectedChanged)
+    Q_PROPERTY(int cupsProcessed READ cupsProcessed NOTIFY cupsProcessedChanged)
+
+public:
+    explicit CoffeeMakerProxy(QObject* parent = nullptr);
+    ~CoffeeMakerProxy() override;
+
+    /// Returns if the machine was created and its properties are mirrored
+    bool isReady() const { return ready_; }
+
+    /// Returns the machine's metrics once ready, readable from any thread
+    std::shared_ptr<const CoffeeMakerMetrics> metrics() const { return metrics_; }
+
+    /// Runs `call` with the machine on the machine thread
+    void invoke(std::function<void(CoffeeMaker*)> call);
+
+    Q_INVOKABLE bool isPoweredOn() const { return state_ != CoffeeMaker::State::Off && state_ != CoffeeMaker::State::Unknown; }
+
+    Q_INVOKABLE void turnOn();
+    Q_INVOKABLE void turnOff();
+    Q_INVOKABLE void startCommandMode();
+    Q_INVOKABLE void setRecipeName(const QString& name);
+    Q_INVOKABLE void cancelCommandMode();
+    Q_INVOKABLE void finishCommandMode();
+    Q_INVOKABLE void cleanTheMachine();
+    Q_INVOKABLE void emptyOverflowContainer();
+    Q_INVOKABLE void emptyRestBinContainer();
+    Q_INVOKABLE void addMilkToContainer(int milkMl);
+    Q_INVOKABLE void addWatertoContainer(int waterMl);
+    Q_INVOKABLE void addBeanstoContainer(int beansGram);
+    /// Applies a service visit at once, see CoffeeMaker::applyMaintenance(). `changes` may have
+    /// "beans", "water", "milk" (amounts to add) and "emptyRestBin", "emptyOverflow", "clean".
+    Q_INVOKABLE void applyMaintenance(const QVariantMap& changes);
+    Q_INVOKABLE void doGrinding(int amount, int level);
+    Q_INVOKABLE void doBrew(int amount, int temp);
+    Q_INVOKABLE void doMilkPrep(int amount, int temp, bool foam = false);
+    Q_INVOKABLE void placeCup();
+    Q_INVOKABLE void removeCup();
+
+    /// The maxima of the machine's hardware profile. They are 0 until ready(), like the levels, so
+    /// checks against them fail safe; QML only reads them once the machine was turned on.
+    Q_INVOKABLE int waterContainerMax() const { return maxima_.water; }
+    Q_INVOKABLE int milkContainerMax() const { return maxima_.milk; }
+    Q_INVOKABLE int beansContainerMax() const { return maxima_.beans; }
+    Q_INVOKABLE int restBinLevelMax() const { return maxima_.restBin; }
+    Q_INVOKABLE int overflowContainerMax() const { return maxima_.overflow; }
+    Q_INVOKABLE int maxCupsProcessedUntilCleanMode() const { return maxima_.cupsProcessed; }
+
+    CoffeeMaker::State currentState() const { return state_; }
+    int waterContainerLevel() const { return levels_.water; }
+    int milkContainerLevel() const { return levels_.milk; }
+    int beansContainerLevel() const { return levels_.beans; }
+    int restBinLevel() const { return levels_.restBin; }
+    int overflowContainerLevel() const { return levels_.overflow; }
+    int cupsProcessed() const { return levels_.cupsProcessed; }
+    bool cupDetected() const { return cupDetected_; }
+
+signals:
+    void ready();
+
+    void cupDetectedChanged(bool cupInTray);
+    void milkContainerLevelChanged(int milkMl);
+    void waterContainerLevelChanged(int waterMl);
+    void beansContainerLevelChanged(int beansGram);
+    void restBinLevelChanged(int lvl);
+    void overflowContainerLevelChanged(int lvl);
+    void cupsProcessedChanged(int cups);
+
+    void currentStateChanged(CoffeeMaker::State state);
+
+private:
+    void createMachine();
+    void mirror(int& member, int value, void (CoffeeMakerProxy::*changed)(int));
+    void mirrorLevels(const CoffeeMaker::Levels& levels);
+    void setState(CoffeeMaker::State state);
+    void setCupDetected(bool detected);
+
+    QThread* thread_;
+    QObject* context_;              ///< lives on the machine thread, parent of the machine
+    CoffeeMaker* maker_ = nullptr;  ///< only used on the machine thread
+
+    bool ready_ = false;
+    CoffeeMaker::State state_ = CoffeeMaker::State::Unknown;
+    CoffeeMaker::Levels levels_;
+    CoffeeMaker::Levels maxima_;
+    bool cupDetected_ = false;
+    std::shared_ptr<const CoffeeMakerMetrics> metrics_;
+};
@@ -0,0 +1,391 @@
+// Bio-Hybrid Coffee Machine Example - Copyright (c) 2021 Bio-Hybrid GmbH
+#include "frame_benchmark.h"
+#include "coffee_maker_proxy.h"
+
+#include <coffeemaker/benchsupport.h>
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QGuiApplication>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMetaProperty>
+#include <QMouseEvent>
+#include <QQuickItem>
+#include <QQuickWindow>
+#include <QTimer>
+
+#include <QDebug>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#ifdef Q_OS_UNIX
+#include <time.h>
+#endif
+
+// -------------------------------------------------------------------------------------------------
+namespace {
+    /// Frames of all phases in the report
+    constexpr int allPhases = -1;
+
+    qint64 threadCpuNs()
+    {
+#ifdef Q_OS_UNIX
+        timespec time;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+        return qint64(time.tv_sec) * 1000000000 + time.tv_nsec;
+#else
+        // Wall time, close enough for a thread that is busy while it renders
+        static QElapsedTimer clock;
+        if (!clock.isValid()) clock.start();
+        return clock.nsecsElapsed();
+#endif
+    }
+
+    void setDefaultEnvironment(const char* name, const QByteArray& value)
+    {
+        if (!qEnvironmentVariableIsSet(name)) qputenv(name, value);
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+void FrameBenchmark::prepare(int argc, char** argv)
+{
+    const auto end = argv + argc;
+    if (argc < 2 || std::find_if(argv + 1, end, [](const char* arg) { return qstrcmp(arg, "--frame-benchmark") == 0; }) == end) {
+        return;
+    }
+    // No display and no GPU needed, and every frame is rendered on the GUI thread
+    setDefaultEnvironment("QT_QPA_PLATFORM", "offscreen");
+    setDefaultEnvironment("QT_QUICK_BACKEND", "software");
+    setDefaultEnvironment("QSG_RENDER_LOOP", "basic");
+
+    // The session brews and services the machine. Every run starts cold from the same levels,
+    // in settings of its own, before the proxy creates the machine.
+    static const SettingsSandbox settingsSandbox;
+    QSettings settings("MyCoffeeMachine", "MachineState");
+    settings.setValue("beansContainerLevel", 300);
+    settings.setValue("waterContainerLevel", 600);
+    settings.setValue("milkContainerLevel", 400);
+    settings.setValue("restBinLevel", 100);
+    settings.setValue("overflowLevel", 100);
+    settings.setValue("cupsProcessed", 5);
+}
+
+// -------------------------------------------------------------------------------------------------
+FrameBenchmark::FrameBenchmark(QQuickWindow* window, CoffeeMakerProxy* maker, QObject* parent)
+    : QObject(parent)
+    , window_(window)
+    , maker_(maker)
+    , ticker_(new QTimer(this))
+{
+    ticker_->setInterval(16);
+    connect(ticker_, &QTimer::timeout, this, &FrameBenchmark::tick);
+
+    // Both are emitted on the GUI thread by the basic render loop
+    connect(window_, &QQuickWindow::afterAnimating, this, &FrameBenchmark::frameBegin, Qt::DirectConnection);
+    connect(window_, &QQuickWindow::frameSwapped, this, &FrameBenchmark::frameEnd, Qt::DirectConnection);
+
+    buildSession();
+}
+
+// -------------------------------------------------------------------------------------------------
+void FrameBenchmark::start()
+{
+    frames_.clear();
+    lastFrameCpuNs_ = threadCpuNs();
+    step_ = 0;
+    phase_ = 0;
+    stepClock_.start();
+    instrument();
+    ticker_->start();
+}
+
+// -------------------------------------------------------------------------------------------------
+void FrameBenchmark::addStep(const QString& phase, std::function<bool()> run, int timeoutMs)
+{
+    if (!phases_.contains(phase)) phases_.append(phase);
+    steps_.append({phase, std::move(run), timeoutMs});
+}
+
+// -------------------------------------------------------------------------------------------------
+void FrameBenchmark::addWait(const QString& phase, int ms)
+{
+    addStep(phase, [this, ms]() { return stepClock_.elapsed() >= ms; });
+}
+
+// -------------------------------------------------------------------------------------------------
+void FrameBenchmark::addSequence(const QString& phase, int intervalMs, const QVector<std::function<void()>>& actions)
+{
+    const auto next = std::make_shared<int>(0);
+    addStep(phase, [this, next, intervalMs, actions]() {
+        if (stepClock_.elapsed() < qint64(*next) * intervalMs) return false;
+        if (*next == actions.size()) {
+            *next = 0;
+            return true;
+        }
+        actions[*next]();
+        ++*next;
+        return false;
+    }, intervalMs * (actions.size() + 1) + 5000);
+}
+
+// -------------------------------------------------------------------------------------------------
+void FrameBenchmark::buildSession()
+{
+    // A machine resumed in an on state starts on the menu, turn it off to start from stand by
+    addStep("startup", [this]() {
+        if (!maker_->isReady() || !item("windowManager")) return false;
+        if (activeScreen() == 1) click("btnGoBack");
+        return activeScreen() == 0;
+    });
+    addWait("standby", 500);
+
+    addStep("menu", [this]() { return click("btnTurnOn"); });
+    addStep("menu", [this]() {
+        const auto list = item("recipeList");
+        return activeScreen() == 1 && list && list->property("count").toInt() > 0;
+    });
+    addWait("menu", 500);
+
+    QVector<std::function<void()>> typing;
+    for (const auto text : {"l", "la", "lat", "la", "l", ""}) {
+        typing.append([this, text]() {
+            if (const auto search = item("txtSearch")) search->setProperty("text", QString(text));
+        });
+    }
+    addSequence("search", 150, typing);
+
+    // Down to the end of the menu and back up, a frame apart
+    QVector<std::function<void()>> scrolling;
+    constexpr int scrollSteps = 30;
+    for (int i = 1; i <= 2 * scrollSteps; ++i) {
+        const auto position = 1.0 - qAbs(double(i - scrollSteps)) / scrollSteps;
+        scrolling.append([this, position]() {
+            const auto list = item("recipeList");
+            if (!list) return;
+            const auto range = qMax(0.0, list->property("contentHeight").toReal() - list->height());
+            list->setProperty("contentY", list->property("originY").toReal() + position * range);
+        });
+    }
+    addSequence("scroll", 16, scrolling);
+    addWait("scroll", 300);
+
+    addStep("settings", [this]() { return click("btnSettings"); });
+    addStep("settings", [this]() { return activeScreen() == 2; });
+    addWait("settings", 300);
+    addStep("settings", [this]() { return click("btnFullService"); });
+    addWait("settings", 500);
+    addStep("settings", [this]() { return click("btnGoBack"); });
+    addStep("settings", [this]() { return activeScreen() == 1; });
+    addWait("settings", 300);
+
+    addStep("brew", [this]() {
+        const auto list = item("recipeList");
+        if (!list || !list->isVisible()) return false;
+        const QPointF firstCell(list->property("cellWidth").toReal() / 2, list->property("cellHeight").toReal() / 2);
+        clickAt(list->mapToScene(firstCell));
+        return true;
+    });
+    addStep("brew", [this]() { return activeScreen() == 3; });
+
+    // Clicks through the states screen like a customer: start, place the cup, refill if asked and
+    // remove the cup, which returns to the menu
+    struct Brew {
+        QString clicked;
+        QElapsedTimer sinceClick;
+        bool cupRemoved = false;
+    };
+    const auto brew = std::make_shared<Brew>();
+    addStep("brew", [this, brew]() {
+        if (activeScreen() != 3) return brew->cupRemoved;
+        const auto button = item("btnStates");
+        if (!button || !button->isVisible() || !button->isEnabled()) return false;
+        const auto text = button->property("text").toString();
+        if (text == brew->clicked && (!text.startsWith("Refill") || brew->sinceClick.elapsed() < 1500)) return false;
+        clickAt(button->mapToScene(QPointF(button->width() / 2, button->height() / 2)));
+        brew->clicked = text;
+        brew->sinceClick.start();
+        brew->cupRemoved = text.startsWith("Remove");
+        return false;
+    }, 90000);
+    addWait("brew", 500);
+
+    addStep("turn off", [this]() { return click("btnGoBack"); });
+    addStep("turn off", [this]() { return activeScreen() == 0; });
+    addWait("turn off", 500);
+}
+
+// -------------------------------------------------------------------------------------------------
+void FrameBenchmark::tick()
+{
+    if (step_ < 0 || step_ >= steps_.size()) return;
+
+    const auto& step = steps_[step_];
+    if (!step.run()) {
+        if (stepClock_.elapsed() <= step.timeoutMs) return;
+        qWarning() << "Frame benchmark: step" << step_ << "of phase" << step.phase << "timed out";
+        ticker_->stop();
+        emit finished(false);
+        return;
+    }
+
+    // The step may have created screens or delegates
+    instrument();
+    if (++step_ == steps_.size()) {
+        ticker_->stop();
+        emit finished(true);
+        return;
+    }
+    phase_ = phases_.indexOf(steps_[step_].phase);
+    stepClock_.start();
+}
+
+// -------------------------------------------------------------------------------------------------
+void FrameBenchmark::instrument()
+{
+    // Bindings re-run on the notify signals of the properties they read, every notification of the
+    // item tree is counted. Objects are connected once, new screens and delegates on the next call.
+    const auto countMethod = metaObject()->method(metaObject()->indexOfMethod("countNotification()"));
+    for (const auto object : window_->findChildren<QObject*>()) {
+        if (instrumented_.contains(object)) continue;
+        instrumented_.insert(object);
+        connect(object, &QObject::destroyed, this, [this, object]() { instrumented_.remove(object); });
+
+        const auto meta = object->metaObject();
+        QSet<int> notifySignals;
+        for (int i = 0; i < meta->propertyCount(); ++i) {
+            const auto property = meta->property(i);
+            if (!property.hasNotifySignal() || notifySignals.contains(property.notifySignalIndex())) continue;
+            notifySignals.insert(property.notifySignalIndex());
+            connect(object, property.notifySignal(), this, countMethod);
+        }
+
+        if (!object->inherits("QQuickItemView")) continue;
+        const auto content = object->property("contentItem").value<QQuickItem*>();
+        if (!content || viewItems_.contains(content)) continue;
+
+        // Delegates created before the view was seen count as well, it was created by this step
+        const auto children = content->childItems();
+        viewItems_.insert(content, children.toSet());
+        delegates_ += children.size();
+        connect(content, &QQuickItem::childrenChanged, this, [this, content]() {
+            auto& known = viewItems_[content];
+            QSet<QQuickItem*> current;
+            for (const auto child : content->childItems()) {
+                current.insert(child);
+                if (!known.contains(child)) ++delegates_;
+            }
+            known = current;
+        });
+        connect(content, &QObject::destroyed, this, [this, content]() { viewItems_.remove(content); });
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+void FrameBenchmark::frameBegin()
+{
+    renderStartCpuNs_ = threadCpuNs();
+}
+
+// -------------------------------------------------------------------------------------------------
+void FrameBenchmark::frameEnd()
+{
+    if (step_ < 0) return;
+    const auto now = threadCpuNs();
+    frames_.append({phase_, double(now - lastFrameCpuNs_) / 1e6, double(now - renderStartCpuNs_) / 1e6,
+                    notifications_, delegates_});
+    lastFrameCpuNs_ = now;
+    notifications_ = 0;
+    delegates_ = 0;
+}
+
+// -------------------------------------------------------------------------------------------------
+QQuickItem* FrameBenchmark::item(const char* objectName) const
+{
+    return window_->findChild<QQuickItem*>(objectName);
+}
+
+// -------------------------------------------------------------------------------------------------
+int FrameBenchmark::activeScreen() const
+{
+    const auto manager = item("windowManager");
+    return manager ? manager->property("activeScreenIndex").toInt() : -1;
+}
+
+// -------------------------------------------------------------------------------------------------
+bool FrameBenchmark::click(const char* objectName)
+{
+    const auto target = item(objectName);
+    if (!target || !target->isVisible() || !target->isEnabled()) return false;
+    clickAt(target->mapToScene(QPointF(target->width() / 2, target->height() / 2)));
+    return true;
+}
+
+// -------------------------------------------------------------------------------------------------
+void FrameBenchmark::clickAt(const QPointF& scenePos)
+{
+    const QPointF screenPos = window_->mapToGlobal(scenePos.toPoint());
+    QMouseEvent press(QEvent::MouseButtonPress, scenePos, scenePos, screenPos, Qt::LeftButton,
+                      Qt::LeftButton, Qt::NoModifier);
+    QCoreApplication::sendEvent(window_, &press);
+    QMouseEvent release(QEvent::MouseButtonRelease, scenePos, scenePos, screenPos, Qt::LeftButton,
+                        Qt::NoButton, Qt::NoModifier);
+    QCoreApplication::sendEvent(window_, &release);
+}
+
+// -------------------------------------------------------------------------------------------------
+bool FrameBenchmark::report(const QString& fileName) const
+{
+    qInfo().noquote() << QString("Frame benchmark on %1, GUI thread CPU ms per frame (render: animating to swap):")
+                         .arg(QGuiApplication::platformName());
+    qInfo().noquote() << QString("  %1 %2 %3 %4 %5 %6 %7 %8 %9 %10")
+                         .arg("phase", -10).arg("frames", 7).arg("p50", 7).arg("p90", 7).arg("p99", 7)
+                         .arg("max", 7).arg("render50", 9).arg("render99", 9).arg("notify", 8).arg("delegates", 10);
+
+    QJsonArray phases;
+    for (int phase = 0; phase <= phases_.size(); ++phase) {
+        const auto index = phase < phases_.size() ? phase : allPhases;
+        const auto name = index == allPhases ? QString("all") : phases_[index];
+        std::vector<double> cpuMs;
+        std::vector<double> renderMs;
+        qint64 notifications = 0;
+        qint64 delegates = 0;
+        for (const auto& frame : frames_) {
+            if (index != allPhases && frame.phase != index) continue;
+            cpuMs.push_back(frame.cpuMs);
+            renderMs.push_back(frame.renderMs);
+            notifications += frame.notifications;
+            delegates += frame.delegates;
+        }
+
+        qInfo().noquote() << QString("  %1 %2 %3 %4 %5 %6 %7 %8 %9 %10")
+                             .arg(name, -10).arg(cpuMs.size(), 7)
+                             .arg(percentile(cpuMs, 50), 7, 'f', 2).arg(percentile(cpuMs, 90), 7, 'f', 2)
+                             .arg(percentile(cpuMs, 99), 7, 'f', 2).arg(percentile(cpuMs, 100), 7, 'f', 2)
+                             .arg(percentile(renderMs, 50), 9, 'f', 2).arg(percentile(renderMs, 99), 9, 'f', 2)
+                             .arg(notifications, 8).arg(delegates, 10);
+
+        const auto times = [](const std::vector<double>& ms) {
+            return QJsonObject{{"p50", percentile(ms, 50)}, {"p90", percentile(ms, 90)},
+                               {"p99", percentile(ms, 99)}, {"max", percentile(ms, 100)}};
+        };
+        phases.append(QJsonObject{
+            {"phase", name}, {"frames", int(cpuMs.size())}, {"cpuMs", times(cpuMs)},
+            {"renderMs", times(renderMs)}, {"notifications", notifications}, {"delegates", delegates}
+        });
+    }
+
+    if (fileName.isEmpty()) return true;
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "Frame benchmark:" << fileName << file.errorString();
+        return false;
+    }
+    const QJsonObject result{{"platform", QGuiApplication::platformName()}, {"phases", phases}};
+    file.write(QJsonDocument(result).toJson());
+    return true;
+}
@@ -0,0 +1,99 @@
+// Bio-Hybrid Coffee Machine Example - Copyright (c) 2021 Bio-Hybrid GmbH
+#pragma once
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QObject>
+#include <QPointF>
+#include <QSet>
+#include <QStringList>
+#include <QVector>
+
+#include <functional>
+
+class CoffeeMakerProxy;
+class QQuickItem;
+class QQuickWindow;
+class QTimer;
+
+/// Drives the QML screens through a scripted session and records the cost of every frame.
+///
+/// The session turns the machine on, searches and scrolls the menu, services the machine on the
+/// settings screen, brews the first recipe on the states screen and turns the machine off again,
+/// with synthesized mouse clicks. It runs on the offscreen platform with the software scene graph
+/// and the basic render loop, so animating, polishing, syncing and rendering all happen on the GUI
+/// thread. Per frame it records the GUI thread CPU time since the previous frame (events,
+/// bindings and the frame itself), the CPU time of the frame alone, the property change
+/// notifications of the item tree that re-run the dependent bindings, and the delegates the item
+/// views created.
+class FrameBenchmark : public QObject
+{
+    Q_OBJECT
+
+public:
+    /// Selects the offscreen platform, the software scene graph and the basic render loop if
+    /// `argv` has --frame-benchmark, unless set in the environment, and gives the machine fixed
+    /// levels in temporary settings. Call it before the application is created.
+    static void prepare(int argc, char** argv);
+
+    FrameBenchmark(QQuickWindow* window, CoffeeMakerProxy* maker, QObject* parent = nullptr);
+
+    /// Runs the session, finished() is emitted once it is done or a step timed out
+    void start();
+
+    /// Logs the frame times and counts per phase and writes them as JSON to `fileName` if not empty.
+    /// Returns false if the file can't be written.
+    bool report(const QString& fileName) const;
+
+signals:
+    void finished(bool completed);
+
+private:
+    struct Frame {
+        int phase;
+        double cpuMs;           ///< GUI thread since the previous frame
+        double renderMs;        ///< GUI thread from animating to the swapped frame
+        int notifications;
+        int delegates;
+    };
+
+    /// A step of the session, `run` is called every tick until it returns true
+    struct Step {
+        QString phase;
+        std::function<bool()> run;
+        int timeoutMs;
+    };
+
+    void addStep(const QString& phase, std::function<bool()> run, int timeoutMs = 30000);
+    void addWait(const QString& phase, int ms);
+    void addSequence(const QString& phase, int intervalMs, const QVector<std::function<void()>>& actions);
+    void buildSession();
+    void tick();
+    void instrument();
+
+    void frameBegin();
+    void frameEnd();
+    Q_INVOKABLE void countNotification() { ++notifications_; }
+
+    QQuickItem* item(const char* objectName) const;
+    int activeScreen() const;
+    bool click(const char* objectName);
+    void clickAt(const QPointF& scenePos);
+
+    QQuickWindow* window_;
+    CoffeeMakerProxy* maker_;
+    QTimer* ticker_;
+    QVector<Step> steps_;
+    int step_ = -1;
+    QElapsedTimer stepClock_;
+    QStringList phases_;
+    int phase_ = 0;
+
+    QVector<Frame> frames_;
+    qint64 lastFrameCpuNs_ = 0;
+    qint64 renderStartCpuNs_ = 0;
+    int notifications_ = 0;
+    int delegates_ = 0;
+    QSet<QObject*> instrumented_;
+    QHash<QQuickItem*, QSet<QQuickItem*>> viewItems_; ///< delegates by item view content item
+};
@@ -0,0 +1,266 @@
+// Bio-Hybrid Coffee Machine Example - Copyright (c) 2021 Bio-Hybrid GmbH
+#include "machine_dispatcher.h"
+
+#include <algorithm>
+#include <limits>
+
+// -------------------------------------------------------------------------------------------------
+MachineDispatcher::MachineDispatcher(Routing routing, QObject* parent)
+    : QObject(parent)
+    , routing_(routing)
+{
+    clock_.start();
+    for (size_t model = 0; model < std::variant_size<HardwareProfile>::value; ++model) {
+        stageTimes_.emplace_back(HardwareModel(model));
+        modelMachines_.push_back(0);
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+int MachineDispatcher::addMachine(CoffeeMaker* maker)
+{
+    const auto index = int(machines_.size());
+    maker->setParent(this);
+
+    Machine machine;
+    machine.maker = maker;
+    machine.queue = new OrderQueue(maker, SchedulingPolicy::Fifo, 0.5, maker);
+    machine.queue->setTimeScale(timeScale_);
+    machine.model = maker->hardwareModel();
+    machine.selfCheckMs = std::visit([](auto profile) { return double(decltype(profile)::selfCheckMs); },
+                                     hardwareProfile(machine.model));
+    machine.heapIndex = int(heap_.size());
+    machines_.push_back(machine);
+    heap_.push_back(index);
+    ++modelMachines_[size_t(machine.model)];
+
+    const auto queue = machine.queue;
+    connect(queue, &OrderQueue::orderStarted, this, [this, index](quint64 id) {
+        auto& m = machines_[size_t(index)];
+        const auto estimateMs = m.orders.value(id).estimateMs;
+        m.waitingMs = m.orders.size() > 1 ? qMax(0.0, m.waitingMs - estimateMs) : 0.0;
+        m.running = true;
+        m.runningMs = estimateMs;
+        m.runningSinceMs = nowMs();
+        refresh(index);
+    });
+    connect(queue, &OrderQueue::orderFinished, this, [this, index](quint64 id, double waitMs, double serviceMs) {
+        finish(index, id, true, waitMs, serviceMs);
+    });
+    connect(queue, &OrderQueue::orderAborted, this, [this, index](quint64 id) {
+        finish(index, id, false, 0, 0);
+    });
+    connect(queue, &OrderQueue::stageMeasured, this, [this, model = machine.model](StageTimes::Stage stage, double ms) {
+        stageTimes_[size_t(model)].record(stage, ms);
+    });
+    connect(maker, &CoffeeMaker::currentStateChanged, this, [this, index]() { refresh(index); });
+
+    refresh(index);
+    return index;
+}
+
+// -------------------------------------------------------------------------------------------------
+void MachineDispatcher::setTimeScale(double scale)
+{
+    timeScale_ = scale;
+    for (const auto& machine : machines_) machine.queue->setTimeScale(scale);
+}
+
+// -------------------------------------------------------------------------------------------------
+quint64 MachineDispatcher::dispatch(const Recipe& recipe)
+{
+    const auto index = route(recipe);
+    if (index < 0) return 0;
+    nextRoundRobin_ = (index + 1) % machineCount();
+
+    auto& m = machines_[size_t(index)];
+    const auto id = nextId_++;
+    const auto estimateMs = stageTimes_[size_t(m.model)].estimateMs(recipe);
+    // Registered first, the queue starts the order right away on an idle machine
+    m.orders.insert(m.queue->nextId(), {id, estimateMs, recipe});
+    m.waitingMs += estimateMs;
+    addDemand(m.demand, recipe, 1);
+    emit orderRouted(id, index);
+
+    if (m.maker->currentState() == CoffeeMaker::State::Off) m.maker->turnOn();
+    m.queue->enqueue(recipe);
+    refresh(index);
+    return id;
+}
+
+// -------------------------------------------------------------------------------------------------
+int MachineDispatcher::route(const Recipe& recipe) const
+{
+    if (machines_.empty()) return -1;
+    if (routing_ == Routing::RoundRobin) return nextRoundRobin_;
+
+    // The bound holds for every machine with the estimate of the fastest model in the bank
+    const auto now = nowMs();
+    auto minEstimateMs = std::numeric_limits<double>::infinity();
+    for (size_t model = 0; model < stageTimes_.size(); ++model) {
+        if (modelMachines_[model] > 0) minEstimateMs = qMin(minEstimateMs, stageTimes_[model].estimateMs(recipe));
+    }
+    const auto boundMs = [&](int position) {
+        return qMax(machines_[size_t(heap_[size_t(position)])].doneMs, now) + minEstimateMs;
+    };
+    const auto later = [](const Candidate& a, const Candidate& b) { return a.boundMs > b.boundMs; };
+
+    // Best first over the heap: a machine is done no earlier than its heap parent, so once the
+    // lowest bound left can't beat the best cost, neither can anything below it
+    auto best = -1;
+    auto bestMs = std::numeric_limits<double>::infinity();
+    frontier_.clear();
+    frontier_.push_back({boundMs(0), 0});
+    while (!frontier_.empty()) {
+        std::pop_heap(frontier_.begin(), frontier_.end(), later);
+        const auto candidate = frontier_.back();
+        frontier_.pop_back();
+        if (candidate.boundMs >= bestMs) break;
+
+        const auto index = heap_[size_t(candidate.position)];
+        const auto& machine = machines_[size_t(index)];
+        const auto ms = costMs(machine, recipe, now, stageTimes_[size_t(machine.model)].estimateMs(recipe));
+        if (ms < bestMs) {
+            bestMs = ms;
+            best = index;
+        }
+        for (auto child = 2 * candidate.position + 1; child <= 2 * candidate.position + 2; ++child) {
+            if (child >= int(heap_.size())) break;
+            const auto childBoundMs = boundMs(child);
+            if (childBoundMs >= bestMs) continue;
+            frontier_.push_back({childBoundMs, child});
+            std::push_heap(frontier_.begin(), frontier_.end(), later);
+        }
+    }
+    return best;
+}
+
+// -------------------------------------------------------------------------------------------------
+double MachineDispatcher::stateStallMs(const Machine& machine) const
+{
+    switch (machine.maker->currentState()) {
+    case CoffeeMaker::State::Off:
+    case CoffeeMaker::State::SelfCheck:
+        return machine.selfCheckMs;
+    case CoffeeMaker::State::CleaningRequired:
+        return stallTimes_.cleaningMs;
+    case CoffeeMaker::State::BinFull:
+    case CoffeeMaker::State::OverflowFull:
+        return stallTimes_.emptyingMs;
+    case CoffeeMaker::State::BeansEmpty:
+    case CoffeeMaker::State::WaterEmpty:
+    case CoffeeMaker::State::MilkEmpty:
+        return stallTimes_.refillMs;
+    default:
+        return 0;
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+double MachineDispatcher::recipeStallMs(const Machine& machine, const Recipe& recipe) const
+{
+    using State = CoffeeMaker::State;
+    const auto& maker = *machine.maker;
+    const auto& demand = machine.demand;
+    const auto state = maker.currentState();
+
+    // Stalls the order runs into after the orders before it, unless the state already waits for it
+    auto ms = 0.0;
+    if (state != State::CleaningRequired
+        && maker.cupsProcessed() + demand.cups >= maker.maxCupsProcessedUntilCleanMode()) {
+        ms += stallTimes_.cleaningMs;
+    }
+    // The grounds of this order count too. The overflow container is not forecast: the queue
+    // places a cup for every order, only liquid that misses a cup ends up there.
+    if (state != State::BinFull
+        && maker.restBinLevel() + demand.beans + recipe.beansGram >= maker.restBinLevelMax()) {
+        ms += stallTimes_.emptyingMs;
+    }
+    if (state != State::BeansEmpty && maker.beansContainerLevel() - demand.beans < recipe.beansGram) {
+        ms += stallTimes_.refillMs;
+    }
+    if (state != State::WaterEmpty && maker.waterContainerLevel() - demand.water < recipe.waterMl) {
+        ms += stallTimes_.refillMs;
+    }
+    if (recipe.hasMilk && state != State::MilkEmpty
+        && maker.milkContainerLevel() - demand.milk < recipe.milkMl) {
+        ms += stallTimes_.refillMs;
+    }
+    return ms;
+}
+
+// -------------------------------------------------------------------------------------------------
+double MachineDispatcher::costMs(const Machine& machine, const Recipe& recipe, double nowMs, double estimateMs) const
+{
+    return qMax(machine.doneMs, nowMs) + estimateMs + recipeStallMs(machine, recipe);
+}
+
+// -------------------------------------------------------------------------------------------------
+void MachineDispatcher::refresh(int index)
+{
+    auto& m = machines_[size_t(index)];
+    const auto now = nowMs();
+    const auto runningLeftMs = m.running ? qMax(0.0, m.runningMs - (now - m.runningSinceMs)) : 0.0;
+    m.doneMs = now + stateStallMs(m) + runningLeftMs + m.waitingMs;
+    siftUp(m.heapIndex);
+    siftDown(m.heapIndex);
+}
+
+// -------------------------------------------------------------------------------------------------
+void MachineDispatcher::finish(int index, quint64 queueId, bool finished, double waitMs, double serviceMs)
+{
+    auto& m = machines_[size_t(index)];
+    const auto routed = m.orders.take(queueId);
+    addDemand(m.demand, routed.recipe, -1);
+    m.running = false;
+    if (m.orders.isEmpty()) m.waitingMs = 0;
+    refresh(index);
+
+    if (finished) emit orderFinished(routed.id, index, waitMs, serviceMs);
+    else emit orderAborted(routed.id, index);
+}
+
+// -------------------------------------------------------------------------------------------------
+void MachineDispatcher::addDemand(Demand& demand, const Recipe& recipe, int sign)
+{
+    demand.beans += sign * recipe.beansGram;
+    demand.water += sign * recipe.waterMl;
+    demand.milk += sign * (recipe.hasMilk ? recipe.milkMl : 0);
+    demand.cups += sign;
+}
+
+// -------------------------------------------------------------------------------------------------
+void MachineDispatcher::siftUp(int position)
+{
+    while (position > 0) {
+        const auto parent = (position - 1) / 2;
+        if (machines_[size_t(heap_[size_t(parent)])].doneMs <= machines_[size_t(heap_[size_t(position)])].doneMs) break;
+        swapHeap(parent, position);
+        position = parent;
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+void MachineDispatcher::siftDown(int position)
+{
+    const auto doneMs = [this](int p) { return machines_[size_t(heap_[size_t(p)])].doneMs; };
+    const auto size = int(heap_.size());
+    for (;;) {
+        auto smallest = position;
+        const auto left = 2 * position + 1;
+        const auto right = left + 1;
+        if (left < size && doneMs(left) < doneMs(smallest)) smallest = left;
+        if (right < size && doneMs(right) < doneMs(smallest)) smallest = right;
+        if (smallest == position) return;
+        swapHeap(position, smallest);
+        position = smallest;
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+void MachineDispatcher::swapHeap(int a, int b)
+{
+    std::swap(heap_[size_t(a)], heap_[size_t(b)]);
+    machines_[size_t(heap_[size_t(a)])].heapIndex = a;
+    machines_[size_t(heap_[size_t(b)])].heapIndex = b;
+}
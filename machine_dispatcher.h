@@ -0,0 +1,125 @@
+// Bio-Hybrid Coffee Machine Example - Copyright (c) 2021 Bio-Hybrid GmbH
+#pragma once
+
+#include "order_queue.h"
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QObject>
+
+#include <vector>
+
+/// Routes orders over a bank of CoffeeMakers, each running its own first come first served
+/// OrderQueue. The machines may be of different hardware models, the stage times are learned per
+/// model and the self-check takes the time of the machine's profile.
+///
+/// EarliestCompletion sends an order to the machine expected to finish it first: the work it
+/// already has, the stall of its state (turned off, cleaning, full bin, refill) and the stalls
+/// the order itself would run into (ingredients, bin, cleaning) before it is done. Machines sit
+/// in a binary heap by the time their work is done; routing searches it best first and prunes
+/// subtrees that can't beat the best machine found, so usually only a few machines are looked at.
+class MachineDispatcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum class Routing { EarliestCompletion, RoundRobin };
+
+    /// Machine time a stall is expected to take until the staff fixes it
+    struct StallTimes {
+        double cleaningMs = 120000;
+        double emptyingMs = 30000;  ///< rest bin or overflow
+        double refillMs = 30000;
+    };
+
+    explicit MachineDispatcher(Routing routing = Routing::EarliestCompletion, QObject* parent = nullptr);
+
+    /// Takes over `maker`, which has to live on the dispatcher's thread. Returns its index.
+    int addMachine(CoffeeMaker* maker);
+
+    int machineCount() const { return int(machines_.size()); }
+    CoffeeMaker* machine(int index) const { return machines_[size_t(index)].maker; }
+
+    void setStallTimes(const StallTimes& stallTimes) { stallTimes_ = stallTimes; }
+
+    /// Reports all times in machine time, for machines running with CoffeeMaker::setTimeScale
+    void setTimeScale(double scale);
+
+    /// Routes an order for `recipe` and queues it on that machine, turning it on if needed.
+    /// Returns the order id, 0 without machines.
+    quint64 dispatch(const Recipe& recipe);
+
+    /// Returns the machine dispatch() would pick for `recipe`, -1 without machines
+    int route(const Recipe& recipe) const;
+
+    /// Returns the expected machine time the machine is done with its work
+    double expectedDoneMs(int index) const { return machines_[size_t(index)].doneMs; }
+
+    /// Returns the current machine time in ms
+    double nowMs() const { return double(clock_.nsecsElapsed()) / 1e6 / timeScale_; }
+
+signals:
+    void orderRouted(quint64 id, int machine);
+    void orderFinished(quint64 id, int machine, double waitMs, double serviceMs);
+    void orderAborted(quint64 id, int machine);
+
+private:
+    /// Needs of the routed orders that did not finish yet, conservative while an order runs
+    struct Demand {
+        int beans = 0;
+        int water = 0;
+        int milk = 0;
+        int cups = 0;
+    };
+
+    struct Routed {
+        quint64 id = 0;
+        double estimateMs = 0;
+        Recipe recipe;
+    };
+
+    struct Machine {
+        CoffeeMaker* maker;
+        OrderQueue* queue;
+        double doneMs = 0;          ///< heap key
+        int heapIndex = 0;
+        double waitingMs = 0;       ///< estimates of the orders not started
+        double runningMs = 0;       ///< estimate of the running order
+        double runningSinceMs = 0;
+        bool running = false;
+        HardwareModel model = HardwareModel::Standard;
+        double selfCheckMs = 0;
+        Demand demand;
+        QHash<quint64, Routed> orders; ///< by queue id
+    };
+
+    double stateStallMs(const Machine& machine) const;
+    double recipeStallMs(const Machine& machine, const Recipe& recipe) const;
+    double costMs(const Machine& machine, const Recipe& recipe, double nowMs, double estimateMs) const;
+    void refresh(int index);
+    void finish(int index, quint64 queueId, bool finished, double waitMs, double serviceMs);
+    void addDemand(Demand& demand, const Recipe& recipe, int sign);
+
+    void siftUp(int position);
+    void siftDown(int position);
+    void swapHeap(int a, int b);
+
+private:
+    const Routing routing_;
+    StallTimes stallTimes_;
+    std::vector<StageTimes> stageTimes_;    ///< learned per hardware model
+    std::vector<int> modelMachines_;        ///< machines per hardware model
+    QElapsedTimer clock_;
+    double timeScale_ = 1.0;
+    quint64 nextId_ = 1;
+    int nextRoundRobin_ = 0;
+
+    std::vector<Machine> machines_;
+    std::vector<int> heap_;     ///< machine indices, min-heap by doneMs
+
+    struct Candidate {
+        double boundMs;
+        int position;
+    };
+    mutable std::vector<Candidate> frontier_; ///< of route(), kept to avoid allocations
+};
@@ -3,11 +3,13 @@
 #include <QDebug>
 
 #include "coffee_app.h"
+#include "frame_benchmark.h"
+#include "startup_timeline.h"
 
 int main(int argc, char** argv)
 {
-  // [OPTIONAL] Provide command line options to provide a recipe JSON file
-  //            or to set the name of the coffee machine
+  StartupTimeline::start();
+  FrameBenchmark::prepare(argc, argv);
 
   qDebug() << "Starting my coffee machine application...";
 
@@ -0,0 +1,213 @@
+// Bio-Hybrid Coffee Machine Example - Copyright (c) 2021 Bio-Hybrid GmbH
+#include "metrics_server.h"
+
+#include <coffeemaker/coffeemaker.h>
+#include <coffeeweb/coffeewebmetrics.h>
+
+#include <QHostAddress>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QMetaEnum>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QThread>
+#include <QDebug>
+
+// -------------------------------------------------------------------------------------------------
+namespace {
+    constexpr auto maxRequestSize = 8 * 1024;
+
+    /// Answers one HTTP request per connection with the scrape
+    void serve(MetricsServer* server, QIODevice* socket, std::function<void()> disconnect)
+    {
+        QObject::connect(socket, &QIODevice::readyRead, socket, [server, socket, disconnect]() {
+            auto request = socket->property("request").toByteArray() + socket->readAll();
+            if (!request.contains("\r\n\r\n") && !request.contains("\n\n")) {
+                if (request.size() > maxRequestSize) disconnect();
+                else socket->setProperty("request", request);
+                return;
+            }
+            const auto body = request.startsWith("GET ") ? server->scrape() : QByteArray();
+            const QByteArray status = request.startsWith("GET ") ? "200 OK" : "405 Method Not Allowed";
+            socket->write("HTTP/1.0 " + status + "\r\n"
+                          "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+                          "Content-Length: " + QByteArray::number(body.size()) + "\r\n"
+                          "Connection: close\r\n\r\n" + body);
+            disconnect();
+        });
+    }
+
+    void writeHeader(QTextStream& out, const char* name, const char* type, const char* help)
+    {
+        out << "# HELP " << name << ' ' << help << '\n' << "# TYPE " << name << ' ' << type << '\n';
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+MetricsServer::MetricsServer(QObject* parent)
+    : QObject(parent)
+    , thread_(new QThread(this))
+    , context_(new QObject)
+{
+    thread_->setObjectName("metrics");
+    context_->moveToThread(thread_);
+    connect(thread_, &QThread::finished, context_, &QObject::deleteLater);
+    thread_->start();
+}
+
+// -------------------------------------------------------------------------------------------------
+MetricsServer::~MetricsServer()
+{
+    thread_->quit();
+    thread_->wait();
+}
+
+// -------------------------------------------------------------------------------------------------
+void MetricsServer::addCollector(Collector collector)
+{
+    QMutexLocker lock(&mutex_);
+    collectors_.append(std::move(collector));
+}
+
+// -------------------------------------------------------------------------------------------------
+bool MetricsServer::listen(const QString& address)
+{
+    const auto separator = address.indexOf(':');
+    const auto scheme = address.left(separator);
+    const auto target = address.mid(separator + 1);
+    if (separator < 0 || target.isEmpty() || (scheme != "tcp" && scheme != "unix")) {
+        qWarning() << "Invalid metrics address" << address << "- expected tcp:<port> or unix:<name>";
+        return false;
+    }
+
+    // The servers are created on the server thread, so all socket I/O happens there
+    bool listening = false;
+    QMetaObject::invokeMethod(context_, [this, scheme, target, &listening]() {
+        if (scheme == "tcp") {
+            const auto server = new QTcpServer(context_);
+            listening = server->listen(QHostAddress::LocalHost, quint16(target.toUInt()));
+            if (!listening) qWarning() << "Metrics server:" << server->errorString();
+            QObject::connect(server, &QTcpServer::newConnection, server, [this, server]() {
+                while (const auto socket = server->nextPendingConnection()) {
+                    QObject::connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+                    serve(this, socket, [socket]() { socket->disconnectFromHost(); });
+                }
+            });
+        } else {
+            const auto server = new QLocalServer(context_);
+            QLocalServer::removeServer(target);
+            listening = server->listen(target);
+            if (!listening) qWarning() << "Metrics server:" << server->errorString();
+            QObject::connect(server, &QLocalServer::newConnection, server, [this, server]() {
+                while (const auto socket = server->nextPendingConnection()) {
+                    QObject::connect(socket, &QLocalSocket::disconnected, socket, &QObject::deleteLater);
+                    serve(this, socket, [socket]() { socket->disconnectFromServer(); });
+                }
+            });
+        }
+    }, Qt::BlockingQueuedConnection);
+    return listening;
+}
+
+// -------------------------------------------------------------------------------------------------
+QByteArray MetricsServer::scrape()
+{
+    QByteArray text;
+    QTextStream out(&text);
+    {
+        QMutexLocker lock(&mutex_);
+        for (const auto& collector : collectors_) collector(out);
+    }
+    out.flush();
+    return text;
+}
+
+// -------------------------------------------------------------------------------------------------
+void Prometheus::writeCoffeeMaker(QTextStream& out, const CoffeeMakerMetrics& metrics)
+{
+    constexpr auto relaxed = std::memory_order_relaxed;
+    const auto states = CoffeeMaker::staticMetaObject.enumerator(
+                            CoffeeMaker::staticMetaObject.indexOfEnumerator("State"));
+
+    writeHeader(out, "coffeemaker_cups_made_total", "counter", "Cups finished since the start of the application.");
+    out << "coffeemaker_cups_made_total " << metrics.cupsMadeTotal.load(relaxed) << '\n';
+
+    writeHeader(out, "coffeemaker_cups_processed", "gauge", "Cups made since the last cleaning.");
+    out << "coffeemaker_cups_processed " << metrics.cupsProcessed.load(relaxed) << '\n';
+
+    writeHeader(out, "coffeemaker_state_entries_total", "counter", "Number of times each state was entered.");
+    for (int s = 0; s < CoffeeMakerMetrics::stateCount; ++s) {
+        out << "coffeemaker_state_entries_total{state=\"" << states.valueToKey(s) << "\"} "
+            << metrics.stateEntries[size_t(s)].load(relaxed) << '\n';
+    }
+
+    writeHeader(out, "coffeemaker_state", "gauge", "1 for the current state of the machine.");
+    const auto current = metrics.state.load(relaxed);
+    for (int s = 0; s < CoffeeMakerMetrics::stateCount; ++s) {
+        out << "coffeemaker_state{state=\"" << states.valueToKey(s) << "\"} " << (s == current ? 1 : 0) << '\n';
+    }
+
+    writeHeader(out, "coffeemaker_container_level", "gauge", "Fill level of the containers (ml, gram or units).");
+    out << "coffeemaker_container_level{container=\"water\"} " << metrics.waterMl.load(relaxed) << '\n'
+        << "coffeemaker_container_level{container=\"milk\"} " << metrics.milkMl.load(relaxed) << '\n'
+        << "coffeemaker_container_level{container=\"beans\"} " << metrics.beansGram.load(relaxed) << '\n'
+        << "coffeemaker_container_level{container=\"rest_bin\"} " << metrics.restBinLevel.load(relaxed) << '\n'
+        << "coffeemaker_container_level{container=\"overflow\"} " << metrics.overflowLevel.load(relaxed) << '\n';
+
+    writeHeader(out, "coffeemaker_warm_started", "gauge", "1 if the machine resumed from its snapshot.");
+    out << "coffeemaker_warm_started " << metrics.warmStarted.load(relaxed) << '\n';
+
+    writeHeader(out, "coffeemaker_snapshots_saved_total", "counter", "Snapshots saved on state changes.");
+    out << "coffeemaker_snapshots_saved_total " << metrics.snapshotsSaved.load(relaxed) << '\n';
+
+    writeHeader(out, "coffeemaker_snapshot_seconds", "gauge", "Duration of the last snapshot save and of the restore.");
+    out << "coffeemaker_snapshot_seconds{operation=\"save\"} " << metrics.snapshotSaveNs.load(relaxed) / 1e9 << '\n'
+        << "coffeemaker_snapshot_seconds{operation=\"restore\"} " << metrics.snapshotRestoreNs.load(relaxed) / 1e9 << '\n';
+
+    writeHeader(out, "coffeemaker_heater_celsius", "gauge", "Temperature of the heaters.");
+    out << "coffeemaker_heater_celsius{heater=\"boiler\"} " << metrics.boilerMilliC.load(relaxed) / 1000.0 << '\n'
+        << "coffeemaker_heater_celsius{heater=\"milk\"} " << metrics.milkHeaterMilliC.load(relaxed) / 1000.0 << '\n';
+
+    writeHeader(out, "coffeemaker_preheating", "gauge", "1 while the boiler is kept warm for a forecast order.");
+    out << "coffeemaker_preheating " << metrics.preheating.load(relaxed) << '\n';
+
+    writeHeader(out, "coffeemaker_heat_up_wait_seconds_total", "counter", "Machine time brewing and milk steps waited for the heaters.");
+    out << "coffeemaker_heat_up_wait_seconds_total " << metrics.heatUpWaitMs.load(relaxed) / 1e3 << '\n';
+
+    writeHeader(out, "coffeemaker_preheat_saved_seconds_total", "counter", "Boiler wait avoided by preheating, compared to heating on demand.");
+    out << "coffeemaker_preheat_saved_seconds_total " << metrics.preheatSavedMs.load(relaxed) / 1e3 << '\n';
+
+    writeHeader(out, "coffeemaker_heater_energy_joules_total", "counter", "Energy of the heaters, and the part spent on preheating.");
+    out << "coffeemaker_heater_energy_joules_total{use=\"all\"} " << metrics.heaterEnergyJ.load(relaxed) << '\n'
+        << "coffeemaker_heater_energy_joules_total{use=\"preheat\"} " << metrics.preheatEnergyJ.load(relaxed) << '\n';
+}
+
+// -------------------------------------------------------------------------------------------------
+void Prometheus::writeCoffeeWeb(QTextStream& out, const CoffeeWebMetrics& metrics)
+{
+    constexpr auto relaxed = std::memory_order_relaxed;
+
+    writeHeader(out, "coffeeweb_requests_started_total", "counter", "Recipe requests started.");
+    out << "coffeeweb_requests_started_total " << metrics.requestsStarted.load(relaxed) << '\n';
+
+    writeHeader(out, "coffeeweb_requests_cancelled_total", "counter", "Recipe requests cancelled before a reply.");
+    out << "coffeeweb_requests_cancelled_total " << metrics.requestsCancelled.load(relaxed) << '\n';
+
+    writeHeader(out, "coffeeweb_replies_total", "counter", "Recipe request replies by return code.");
+    out << "coffeeweb_replies_total{code=\"200\"} " << metrics.repliesOk.load(relaxed) << '\n'
+        << "coffeeweb_replies_total{code=\"408\"} " << metrics.repliesTimeout.load(relaxed) << '\n'
+        << "coffeeweb_replies_total{code=\"500\"} " << metrics.repliesServerError.load(relaxed) << '\n'
+        << "coffeeweb_replies_total{code=\"other\"} " << metrics.repliesOther.load(relaxed) << '\n';
+
+    writeHeader(out, "coffeeweb_request_duration_seconds", "histogram", "Latency of finished recipe requests.");
+    quint64 cumulative = 0;
+    const auto& bounds = CoffeeWebMetrics::latencyBucketsMs;
+    for (size_t i = 0; i < bounds.size(); ++i) {
+        cumulative += metrics.latencyBuckets[i].load(relaxed);
+        out << "coffeeweb_request_duration_seconds_bucket{le=\"" << bounds[i] / 1000.0 << "\"} " << cumulative << '\n';
+    }
+    cumulative += metrics.latencyBuckets[bounds.size()].load(relaxed);
+    out << "coffeeweb_request_duration_seconds_bucket{le=\"+Inf\"} " << cumulative << '\n'
+        << "coffeeweb_request_duration_seconds_sum " << metrics.latencySumUs.load(relaxed) / 1e6 << '\n'
+        << "coffeeweb_request_duration_seconds_count " << cumulative << '\n';
+}
@@ -0,0 +1,51 @@
+// Bio-Hybrid Coffee Machine Example - Copyright (c) 2021 Bio-Hybrid GmbH
+#pragma once
+
+#include <QMutex>
+#include <QObject>
+#include <QString>
+#include <QTextStream>
+#include <QVector>
+
+#include <functional>
+
+struct CoffeeMakerMetrics;
+struct CoffeeWebMetrics;
+class QThread;
+
+/// Serves metrics in the Prometheus text exposition format.
+///
+/// The server runs on its own thread and answers every HTTP request with the output of the
+/// registered collectors. Collectors only read atomics, so a scrape never waits for the machine
+/// or the GUI thread.
+class MetricsServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    using Collector = std::function<void(QTextStream& out)>;
+
+    explicit MetricsServer(QObject* parent = nullptr);
+    ~MetricsServer() override;
+
+    /// Adds a collector, thread-safe
+    void addCollector(Collector collector);
+
+    /// Listens on `tcp:<port>` (localhost only) or on the local socket `unix:<name>`,
+    /// returns false if the address is invalid or in use
+    bool listen(const QString& address);
+
+    /// Writes the output of all collectors, thread-safe
+    QByteArray scrape();
+
+private:
+    QThread* thread_;
+    QObject* context_; ///< lives on the server thread, parent of the servers and sockets
+    QMutex mutex_;     ///< guards the collectors, only taken by registration and scrapes
+    QVector<Collector> collectors_;
+};
+
+namespace Prometheus {
+    void writeCoffeeMaker(QTextStream& out, const CoffeeMakerMetrics& metrics);
+    void writeCoffeeWeb(QTextStream& out, const CoffeeWebMetrics& metrics);
+}
@@ -0,0 +1,204 @@
+// Bio-Hybrid Coffee Machine Example - Copyright (c) 2021 Bio-Hybrid GmbH
+#include "order_queue.h"
+
+#include <algorithm>
+
+// -------------------------------------------------------------------------------------------------
+namespace {
+    /// Weight of a new measurement in the stage time average
+    constexpr double measurementWeight = 0.2;
+}
+
+// -------------------------------------------------------------------------------------------------
+StageTimes::StageTimes(HardwareModel model)
+{
+    std::visit([this](auto profile) {
+        using Profile = decltype(profile);
+        ms_ = {{double(Profile::startStepMs), double(Profile::grindStepMs), double(Profile::brewStepMs),
+                double(Profile::milkStepMs), double(Profile::finishStepMs)}};
+    }, hardwareProfile(model));
+}
+
+// -------------------------------------------------------------------------------------------------
+void StageTimes::record(Stage stage, double ms)
+{
+    auto& average = ms_[size_t(stage)];
+    average += measurementWeight * (ms - average);
+}
+
+// -------------------------------------------------------------------------------------------------
+double StageTimes::estimateMs(const Recipe& recipe) const
+{
+    return ms_[Start] + ms_[Grind] + ms_[Brew] + (recipe.hasMilk ? ms_[Milk] : 0.0) + ms_[Finish];
+}
+
+// -------------------------------------------------------------------------------------------------
+OrderScheduler::OrderScheduler(SchedulingPolicy policy, double agingRate)
+    : policy_(policy)
+    , agingRate_(agingRate)
+{
+}
+
+// -------------------------------------------------------------------------------------------------
+bool OrderScheduler::later(const Entry& a, const Entry& b)
+{
+    return a.key > b.key || (a.key == b.key && a.sequence > b.sequence);
+}
+
+// -------------------------------------------------------------------------------------------------
+void OrderScheduler::push(Order order)
+{
+    double key = 0;
+    switch (policy_) {
+    case SchedulingPolicy::Fifo: key = order.arrivalMs; break;
+    case SchedulingPolicy::ShortestJobFirst: key = order.estimateMs; break;
+    case SchedulingPolicy::AgingShortestJobFirst: key = order.estimateMs + agingRate_ * order.arrivalMs; break;
+    }
+    heap_.push_back({key, sequence_++, std::move(order)});
+    std::push_heap(heap_.begin(), heap_.end(), &OrderScheduler::later);
+}
+
+// -------------------------------------------------------------------------------------------------
+Order OrderScheduler::pop()
+{
+    std::pop_heap(heap_.begin(), heap_.end(), &OrderScheduler::later);
+    auto order = std::move(heap_.back().order);
+    heap_.pop_back();
+    return order;
+}
+
+// -------------------------------------------------------------------------------------------------
+OrderQueue::OrderQueue(CoffeeMaker* maker, SchedulingPolicy policy, double agingRate, QObject* parent)
+    : QObject(parent)
+    , maker_(maker)
+    , scheduler_(policy, agingRate)
+    , stageTimes_(maker->hardwareModel())
+    , machineState_(maker->currentState())
+{
+    clock_.start();
+    connect(maker, &CoffeeMaker::currentStateChanged, this, &OrderQueue::onStateChanged);
+}
+
+// -------------------------------------------------------------------------------------------------
+quint64 OrderQueue::enqueue(const Recipe& recipe)
+{
+    Order order;
+    order.id = nextId_++;
+    order.recipe = recipe;
+    order.arrivalMs = nowMs();
+    order.estimateMs = stageTimes_.estimateMs(recipe);
+    const auto id = order.id;
+    scheduler_.push(std::move(order));
+    startNext();
+    return id;
+}
+
+// -------------------------------------------------------------------------------------------------
+CoffeeMaker::GrindLevel OrderQueue::grindLevel(const QString& name)
+{
+    if (name == "extra-fine") return CoffeeMaker::GrindLevel::ExtraFine;
+    if (name == "medium-fine") return CoffeeMaker::GrindLevel::MediumFine;
+    if (name == "medium") return CoffeeMaker::GrindLevel::Medium;
+    if (name == "medium-coarse") return CoffeeMaker::GrindLevel::MediumCoarse;
+    if (name == "course" || name == "coarse") return CoffeeMaker::GrindLevel::Course;
+    if (name == "extra-course" || name == "extra-coarse") return CoffeeMaker::GrindLevel::ExtraCourse;
+    return CoffeeMaker::GrindLevel::Fine;
+}
+
+// -------------------------------------------------------------------------------------------------
+void OrderQueue::onStateChanged(CoffeeMaker::State state)
+{
+    machineState_ = state;
+    if (!active_) {
+        // Queued, so the self-check events posted on entering stand by are processed first
+        if (state == CoffeeMaker::State::StandBy) {
+            QMetaObject::invokeMethod(this, &OrderQueue::startNext, Qt::QueuedConnection);
+        }
+        return;
+    }
+
+    const auto now = nowMs();
+    switch (state) {
+    case CoffeeMaker::State::CommandMode:
+        if (!stageDisturbed_) recordStage(stage_, now - stageStartedMs_);
+        nextStep();
+        break;
+    case CoffeeMaker::State::BeansEmpty:
+    case CoffeeMaker::State::WaterEmpty:
+    case CoffeeMaker::State::MilkEmpty:
+        stageDisturbed_ = true;
+        break;
+    case CoffeeMaker::State::StandBy:
+    case CoffeeMaker::State::Off:
+        active_ = false;
+        maker_->removeCup();
+        if (stage_ == StageTimes::Finish && state == CoffeeMaker::State::StandBy) {
+            recordStage(StageTimes::Finish, now - stageStartedMs_);
+            emit orderFinished(current_.id, startedMs_ - current_.arrivalMs, now - startedMs_);
+        } else {
+            emit orderAborted(current_.id);
+        }
+        if (state == CoffeeMaker::State::StandBy) {
+            QMetaObject::invokeMethod(this, &OrderQueue::startNext, Qt::QueuedConnection);
+        }
+        break;
+    default:
+        break; // a step running, or resuming after a refill
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+void OrderQueue::recordStage(StageTimes::Stage stage, double ms)
+{
+    stageTimes_.record(stage, ms);
+    emit stageMeasured(stage, ms);
+}
+
+// -------------------------------------------------------------------------------------------------
+void OrderQueue::startNext()
+{
+    if (active_ || scheduler_.isEmpty() || machineState_ != CoffeeMaker::State::StandBy) return;
+
+    current_ = scheduler_.pop();
+    active_ = true;
+    step_ = 0;
+    startedMs_ = nowMs();
+    stage_ = StageTimes::Start;
+    stageStartedMs_ = startedMs_;
+    stageDisturbed_ = false;
+    emit orderStarted(current_.id, startedMs_ - current_.arrivalMs);
+
+    maker_->placeCup();
+    maker_->setRecipeName(current_.recipe.name);
+    maker_->startCommandMode();
+}
+
+// -------------------------------------------------------------------------------------------------
+void OrderQueue::nextStep()
+{
+    const auto& recipe = current_.recipe;
+    stageStartedMs_ = nowMs();
+    stageDisturbed_ = false;
+
+    switch (step_++) {
+    case 0:
+        stage_ = StageTimes::Grind;
+        maker_->doGrinding(recipe.beansGram, grindLevel(recipe.grindLevel));
+        return;
+    case 1:
+        stage_ = StageTimes::Brew;
+        maker_->doBrew(recipe.waterMl, recipe.waterTemp);
+        return;
+    case 2:
+        if (recipe.hasMilk) {
+            stage_ = StageTimes::Milk;
+            maker_->doMilkPrep(recipe.milkMl, recipe.milkTemp, recipe.foamMl > 0);
+            return;
+        }
+        break;
+    default:
+        break;
+    }
+    stage_ = StageTimes::Finish;
+    maker_->finishCommandMode();
+}
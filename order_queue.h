@@ -0,0 +1,138 @@
+// Bio-Hybrid Coffee Machine Example - Copyright (c) 2021 Bio-Hybrid GmbH
+#pragma once
+
+#include <coffeemaker/coffeemaker.h>
+#include <coffeeweb/recipe.h>
+
+#include <QElapsedTimer>
+#include <QObject>
+
+#include <array>
+#include <vector>
+
+/// Estimated durations of the machine stages, learned from the measured stage times
+class StageTimes
+{
+public:
+    enum Stage { Start, Grind, Brew, Milk, Finish, StageCount };
+
+    /// Starts with the nominal step durations of a `model` machine
+    explicit StageTimes(HardwareModel model = HardwareModel::Standard);
+
+    /// Adds a measured duration, recent measurements weigh more
+    void record(Stage stage, double ms);
+
+    double stageMs(Stage stage) const { return ms_[size_t(stage)]; }
+
+    /// Returns the expected time the machine is busy with `recipe`
+    double estimateMs(const Recipe& recipe) const;
+
+private:
+    std::array<double, StageCount> ms_;
+};
+
+enum class SchedulingPolicy {
+    Fifo,                   ///< arrival order
+    ShortestJobFirst,       ///< shortest estimated order first, long orders may starve
+    AgingShortestJobFirst   ///< shortest first, but waiting makes an order shorter
+};
+
+struct Order {
+    quint64 id = 0;
+    Recipe recipe;
+    double arrivalMs = 0;   ///< machine time
+    double estimateMs = 0;
+};
+
+/// Picks the next order by policy from a binary heap.
+///
+/// Aging prefers an order that waited w ms over one that is agingRate * w ms shorter. Since all
+/// waiting orders age equally, the priority `estimate - agingRate * (now - arrival)` orders like
+/// the constant `estimate + agingRate * arrival`, so the heap stays valid over time.
+class OrderScheduler
+{
+public:
+    explicit OrderScheduler(SchedulingPolicy policy, double agingRate = 0.5);
+
+    void push(Order order);
+    Order pop();
+    bool isEmpty() const { return heap_.empty(); }
+    int size() const { return int(heap_.size()); }
+    SchedulingPolicy policy() const { return policy_; }
+
+private:
+    struct Entry {
+        double key;
+        quint64 sequence; ///< arrival order among equal keys
+        Order order;
+    };
+    static bool later(const Entry& a, const Entry& b);
+
+    const SchedulingPolicy policy_;
+    const double agingRate_;
+    std::vector<Entry> heap_;
+    quint64 sequence_ = 0;
+};
+
+/// Runs queued orders on a CoffeeMaker one after the other, in the order of a scheduling policy.
+///
+/// Lives on the machine's thread. Orders start when the machine is in stand by, the stage times
+/// measured on the way improve the estimates of the following orders.
+class OrderQueue : public QObject
+{
+    Q_OBJECT
+
+public:
+    OrderQueue(CoffeeMaker* maker, SchedulingPolicy policy, double agingRate = 0.5, QObject* parent = nullptr);
+
+    /// Reports all times in machine time, for machines running with CoffeeMaker::setTimeScale
+    void setTimeScale(double scale) { timeScale_ = scale; }
+
+    /// Queues an order for `recipe`, returns its id
+    quint64 enqueue(const Recipe& recipe);
+
+    /// Returns the id the next enqueued order gets
+    quint64 nextId() const { return nextId_; }
+
+    /// Returns the number of orders waiting
+    int pending() const { return scheduler_.size(); }
+
+    const StageTimes& stageTimes() const { return stageTimes_; }
+
+    /// Returns the current machine time in ms
+    double nowMs() const { return double(clock_.nsecsElapsed()) / 1e6 / timeScale_; }
+
+    /// Maps the recipe grind levels to the machine's
+    static CoffeeMaker::GrindLevel grindLevel(const QString& name);
+
+signals:
+    void orderStarted(quint64 id, double waitMs);
+    void orderFinished(quint64 id, double waitMs, double serviceMs);
+    /// The order left command mode before it was complete, e.g. cancelled or turned off
+    void orderAborted(quint64 id);
+    /// A stage ran without waiting for a refill
+    void stageMeasured(StageTimes::Stage stage, double ms);
+
+private:
+    void onStateChanged(CoffeeMaker::State state);
+    void recordStage(StageTimes::Stage stage, double ms);
+    void startNext();
+    void nextStep();
+
+private:
+    CoffeeMaker* maker_;
+    OrderScheduler scheduler_;
+    StageTimes stageTimes_;
+    QElapsedTimer clock_;
+    double timeScale_ = 1.0;
+    quint64 nextId_ = 1;
+
+    CoffeeMaker::State machineState_;
+    bool active_ = false;
+    Order current_;
+    double startedMs_ = 0;
+    int step_ = 0;
+    StageTimes::Stage stage_ = StageTimes::Start;
+    double stageStartedMs_ = 0;
+    bool stageDisturbed_ = false; ///< waited for a refill, not a representative stage time
+};
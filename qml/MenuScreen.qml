@@ -3,6 +3,9 @@ import QtQuick.Window 2.12
 import QtQuick.Controls 2.12
 import QtQuick.Layouts 1.12
 
+// With this import you have access to special types, like enums
+import CoffeeMaker 1.0
+
 
 Item {
 
@@ -10,33 +13,56 @@ Item {
     height: parent.height
 
     Component.onCompleted: {
-        manager.oldScreenIndex = 0;//to the StandbyScreen
-    }
-
-    function getCoffeeList() {
-        var coffeObjList = JSON.parse(coffee.coffeeList);
-        return coffeObjList["recipes"];
+        startup.mark("menu screen loaded");
     }
 
     function recipeItemSelected(item){
         console.log(item.name);
-        statesScreen.recipeItem = item;
-        manager.activeScreenIndex = 3; //StatesScreen
+        manager.showRecipe(item);
     }
 
     Rectangle{
         anchors.fill: parent
         color:"transparent"
 
+        RowLayout {
+            id: filterBar
+            width: 750
+            y: 5
+            anchors.horizontalCenter: parent.horizontalCenter
+
+            TextField {
+                id: txtSearch
+                objectName: "txtSearch"
+                Layout.fillWidth: true
+                placeholderText: "Search recipes..."
+                onTextChanged: recipeFilter.searchText = text
+            }
+
+            ComboBox {
+                id: cmbMilk
+                model: ["All", "With milk", "Without milk"]
+                onCurrentIndexChanged: {
+                    switch(currentIndex) {
+                        case 1: recipeFilter.milk = RecipeFilter.WithMilk; break;
+                        case 2: recipeFilter.milk = RecipeFilter.WithoutMilk; break;
+                        default: recipeFilter.milk = RecipeFilter.AnyMilk; break;
+                    }
+                }
+            }
+        }
+
         GridView {
             width:750
-            height: 400
-            y:5
+            height: 355
+            y: filterBar.y + filterBar.height + 10
             cellWidth: 250
             cellHeight: 240
+            clip: true
             anchors.horizontalCenter: parent.horizontalCenter
             id:recipeList
-            model: getCoffeeList()
+            objectName: "recipeList"
+            model: recipeFilter
             delegate: Column {
                 Rectangle{
                     id:wrapper
@@ -44,22 +70,31 @@ Item {
                     height: recipeList.cellHeight - 15
                     width: recipeList.cellWidth
                     color: "transparent"
-                    Image { source: "images/Coffee.png"; anchors.horizontalCenter: parent.horizontalCenter }
+                    // Recipes that cannot be made with the current supplies are greyed out
+                    opacity: model.canMake ? 1.0 : 0.4
+                    Image { source: "image://baked/Coffee"; asynchronous: true; anchors.horizontalCenter: parent.horizontalCenter }
                     Text {
-                        text: recipeList.model[index]["name"]
+                        text: model.name
                         anchors.horizontalCenter: parent.horizontalCenter
                         anchors.verticalCenter: parent.bottom
                         color: "white"
                         font.pointSize: 15
                         font.bold: true
                     }
+                    Text {
+                        text: model.servings < 100 ? model.servings + " left" : ""
+                        anchors.right: parent.right
+                        anchors.top: parent.top
+                        color: "white"
+                        font.pointSize: 10
+                    }
                     MouseArea {
                         id: clickable
                         anchors.fill: wrapper
                         hoverEnabled: true
                         onClicked: {
                             //recipeList.currentIndex=index;
-                            recipeItemSelected(recipeList.model[index]);
+                            recipeItemSelected(model.recipe);
                         }
 
                     }
@@ -13,7 +13,6 @@ Item {
     height: parent.height
 
     Component.onCompleted: {
-        manager.oldScreenIndex = 2;//settingsScreen
         refreshValues();
     }
 
@@ -86,6 +85,17 @@ Item {
               }
             }
 
+            Button {
+              objectName: "btnFullService"
+              text: "Full service"
+              // One update: the machine never shows the states in between
+              onClicked: maker.applyMaintenance({
+                  "beans": maker.beansContainerMax(), "water": maker.waterContainerMax(),
+                  "milk": maker.milkContainerMax(), "emptyRestBin": true,
+                  "emptyOverflow": true, "clean": true
+              });
+            }
+
         }
 
 }
@@ -8,15 +8,12 @@ Item {
     width: parent.width
     height: parent.height
 
-    Component.onCompleted: {
-        manager.oldScreenIndex = 0;//StandbyScreen
-    }
-
     Rectangle{
         anchors.fill: parent
         color:"transparent"
 
         Button{
+            objectName: "btnTurnOn"
             anchors.horizontalCenter: parent.horizontalCenter
             anchors.verticalCenter: parent.verticalCenter
             text: "Turn ON"
@@ -25,7 +25,6 @@ Item {
     height: parent.height
 
     Component.onCompleted: {
-        manager.oldScreenIndex = 1;//MenuScreen
         btnFunction = "start";
         stScreen.state = "startCommandMode";
     }
@@ -53,6 +52,7 @@ Item {
 
             Button{
                 id: btnStates
+                objectName: "btnStates"
                 text: ""
                 anchors.horizontalCenter: parent.horizontalCenter
                 anchors.bottom: parent.bottom
@@ -162,6 +162,7 @@ Item {
         //we assume machine is ON
         if(stScreen.state === "startCommandMode"){
             maker.startCommandMode();
+            maker.setRecipeName(recipeItem["name"]);
 
             stScreen.state = "placeCup";
         }
@@ -10,46 +10,71 @@ Item {
     property var activeScreenIndex
     property var oldScreenIndex
 
+    // Screens are created on first use. With warm-up enabled the remaining screens are
+    // created asynchronously once the first frame is on screen.
+    function screenLoaders() {
+        return [standbyLoader, menuLoader, settingsLoader, statesLoader];
+    }
+
+    function screen(index) {
+        var loader = screenLoaders()[index];
+        loader.asynchronous = false; // completes a pending warm-up synchronously
+        loader.active = true;
+        return loader.item;
+    }
+
+    function showScreen(index) {
+        var loaders = screenLoaders();
+        for (var i = 0; i < loaders.length; ++i) {
+            loaders[i].visible = (i === index);
+        }
+        return screen(index);
+    }
+
+    function warmUp() {
+        var loaders = screenLoaders();
+        for (var i = 0; i < loaders.length; ++i) {
+            if (!loaders[i].active) {
+                loaders[i].asynchronous = true;
+                loaders[i].active = true;
+            }
+        }
+    }
+
+    function showRecipe(item) {
+        activeScreenIndex = 3; //StatesScreen
+        screen(3).recipeItem = item;
+    }
+
     onActiveScreenIndexChanged: {
         console.log("screen index set to : "+activeScreenIndex);
         switch(activeScreenIndex) {
             case 0: //StandbyScreen
                 btnGoBack.visible = false;
-                standbyScreen.visible = true;
-                menuScreen.visible = false;
-                settingsScreen.visible = false;
-                statesScreen.visible = false;
+                showScreen(0);
                 txtHeader.text = "Standby Screen";
 
                 return "Off";
             case 1: //MenuScreen
                 btnGoBack.visible = true;
                 btnGoBack.text = "Turn Off";
-                standbyScreen.visible = false;
-                menuScreen.visible = true;
-                settingsScreen.visible = false;
-                statesScreen.visible = false;
+                oldScreenIndex = 0;
+                showScreen(1);
                 txtHeader.text = "Menu Screen";
 
                 return "Off";
             case 2: //SettingsScreen
                 btnGoBack.visible = true;
                 btnGoBack.text = "Back";
-                standbyScreen.visible = false;
-                menuScreen.visible = false;
-                settingsScreen.visible = true;
-                settingsScreen.refreshValues();
-                statesScreen.visible = false;
+                showScreen(2).refreshValues();
                 txtHeader.text = "Settings Screen";
 
                 return "Off";
             case 3: //StatesScreen
                 btnGoBack.visible = true;
                 btnGoBack.text = "Back";
-                standbyScreen.visible = false;
-                menuScreen.visible = false;
-                settingsScreen.visible = false;
-                statesScreen.visible = true;
+                oldScreenIndex = 1;
+                showScreen(3);
                 txtHeader.text = "States Screen";
 
                 return "Off";
@@ -61,7 +86,9 @@ Item {
     Image {
         id: backgroundImage
         anchors.fill: parent
-        source: "images/wooden_background.jpg"
+        asynchronous: true
+        sourceSize: Qt.size(width, height)
+        source: "image://baked/wooden_background"
 
 
         //****************Constant area*******************************************
@@ -84,6 +111,7 @@ Item {
         }
         Button{
             id:btnGoBack
+            objectName: "btnGoBack"
             text: "<<"
             onClicked: {
 
@@ -103,6 +131,7 @@ Item {
             anchors.right: backgroundImage.right
             Button{
                 id: btnSettings
+                objectName: "btnSettings"
                 text: "Settings"
                 anchors.right: rightPane.left
 
@@ -119,29 +148,45 @@ Item {
 
         //****************Widget area****************************************************
 
-        StandbyScreen{
-            id:standbyScreen
+        Loader{
+            id:standbyLoader
+            source: "StandbyScreen.qml"
+            active: false
             visible: false
             y: (headerPane.height + 10)
             x: 0
+            width: parent.width
+            height: parent.height
         }
-        MenuScreen{
-            id:menuScreen
+        Loader{
+            id:menuLoader
+            source: "MenuScreen.qml"
+            active: false
             visible: false
             y: (headerPane.height + 10)
             x: 0
+            width: parent.width
+            height: parent.height
         }
-        StatesScreen{
-            id:statesScreen
+        Loader{
+            id:statesLoader
+            source: "StatesScreen.qml"
+            active: false
             visible: false
             y: (headerPane.height + 10)
             x: 0
+            width: parent.width
+            height: parent.height
         }
-        SettingsScreen{
-            id:settingsScreen
+        Loader{
+            id:settingsLoader
+            source: "SettingsScreen.qml"
+            active: false
             visible: false
             y: (headerPane.height + 10)
             x: 0
+            width: parent.width
+            height: parent.height
         }
 
         //****************end of Widget area*********************************************
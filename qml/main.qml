@@ -13,7 +13,27 @@ Window {
 
 
     WindowManager{
+        id: windowManager
+        objectName: "windowManager"
         activeScreenIndex: 0
 
+        // A startup measurement turns the machine on right away to reach the menu
+        Component.onCompleted: {
+            if (startup.measuring) {
+                maker.turnOn();
+                activeScreenIndex = 1;
+            } else if (maker.isPoweredOn()) {
+                activeScreenIndex = 1;
+            }
+        }
+
+        // A machine resumed from its snapshot is already on, skip the standby screen
+        Connections {
+            target: maker
+            onReady: {
+                if (maker.isPoweredOn() && windowManager.activeScreenIndex === 0)
+                    windowManager.activeScreenIndex = 1;
+            }
+        }
     }
 }
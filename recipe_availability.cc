@@ -0,0 +1,118 @@
+// Bio-Hybrid Coffee Machine Example - Copyright (c) 2021 Bio-Hybrid GmbH
+#include "recipe_availability.h"
+
+#include <algorithm>
+
+// -------------------------------------------------------------------------------------------------
+namespace {
+    /// floor(amount / need), or unlimited if need is 0.
+    /// The float estimate is corrected by one in either direction, so the result is exact.
+    inline qint32 servingsFor(qint32 amount, qint32 need, float inverseNeed)
+    {
+        const auto safeNeed = need > 0 ? need : 1;
+        auto s = qint32(float(amount) * inverseNeed);
+        s += qint32((s + 1) * safeNeed <= amount);
+        s -= qint32(s * safeNeed > amount);
+        s = s > 0 ? s : 0;
+        return need > 0 ? s : RecipeAvailability::unlimited;
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+const std::vector<int>& RecipeAvailability::setSupply(Supply supply, int amount)
+{
+    changed_.clear();
+    if (supply_[supply] == amount) return changed_;
+    supply_[supply] = amount;
+
+    const auto n = servings_.size();
+    const auto need = needs_[supply].data();
+    const auto inverse = inverseNeeds_[supply].data();
+    const auto column = perSupply_[supply].data();
+    for (size_t i = 0; i < n; ++i) column[i] = servingsFor(amount, need[i], inverse[i]);
+
+    // minimum over all supplies, then the rows that changed
+    previous_.swap(servings_);
+    servings_.resize(n);
+    const auto beans = perSupply_[Beans].data();
+    const auto water = perSupply_[Water].data();
+    const auto milk = perSupply_[Milk].data();
+    const auto restBin = perSupply_[RestBinSpace].data();
+    const auto out = servings_.data();
+    for (size_t i = 0; i < n; ++i) {
+        out[i] = std::min(std::min(beans[i], water[i]), std::min(milk[i], restBin[i]));
+    }
+
+    const auto before = previous_.data();
+    for (size_t i = 0; i < n; ++i) {
+        if (out[i] != before[i]) changed_.push_back(int(i));
+    }
+    return changed_;
+}
+
+// -------------------------------------------------------------------------------------------------
+void RecipeAvailability::insert(int row, const Recipe& recipe)
+{
+    const auto at = size_t(row);
+    for (int s = 0; s < SupplyCount; ++s) {
+        needs_[s].insert(needs_[s].begin() + at, 0);
+        inverseNeeds_[s].insert(inverseNeeds_[s].begin() + at, 0.f);
+        perSupply_[s].insert(perSupply_[s].begin() + at, 0);
+    }
+    servings_.insert(servings_.begin() + at, 0);
+    setNeeds(at, recipe);
+}
+
+// -------------------------------------------------------------------------------------------------
+void RecipeAvailability::set(int row, const Recipe& recipe)
+{
+    setNeeds(size_t(row), recipe);
+}
+
+// -------------------------------------------------------------------------------------------------
+void RecipeAvailability::remove(int first, int last)
+{
+    const auto begin = size_t(first);
+    const auto end = size_t(last) + 1;
+    for (int s = 0; s < SupplyCount; ++s) {
+        needs_[s].erase(needs_[s].begin() + begin, needs_[s].begin() + end);
+        inverseNeeds_[s].erase(inverseNeeds_[s].begin() + begin, inverseNeeds_[s].begin() + end);
+        perSupply_[s].erase(perSupply_[s].begin() + begin, perSupply_[s].begin() + end);
+    }
+    servings_.erase(servings_.begin() + begin, servings_.begin() + end);
+}
+
+// -------------------------------------------------------------------------------------------------
+void RecipeAvailability::clear()
+{
+    for (int s = 0; s < SupplyCount; ++s) {
+        needs_[s].clear();
+        inverseNeeds_[s].clear();
+        perSupply_[s].clear();
+    }
+    servings_.clear();
+}
+
+// -------------------------------------------------------------------------------------------------
+void RecipeAvailability::setNeeds(size_t row, const Recipe& recipe)
+{
+    // Brewing puts the used beans as coffee grounds into the rest bin
+    const std::array<qint32, SupplyCount> needs = {
+        recipe.beansGram, recipe.waterMl, recipe.hasMilk ? recipe.milkMl : 0, recipe.beansGram
+    };
+    for (int s = 0; s < SupplyCount; ++s) {
+        const auto need = std::max(needs[size_t(s)], 0);
+        needs_[s][row] = need;
+        inverseNeeds_[s][row] = need > 0 ? 1.f / float(need) : 0.f;
+        perSupply_[s][row] = servingsFor(supply_[size_t(s)], need, inverseNeeds_[s][row]);
+    }
+    servings_[row] = servingsOf(row);
+}
+
+// -------------------------------------------------------------------------------------------------
+qint32 RecipeAvailability::servingsOf(size_t row) const
+{
+    auto servings = perSupply_[0][row];
+    for (int s = 1; s < SupplyCount; ++s) servings = std::min(servings, perSupply_[s][row]);
+    return servings;
+}
@@ -0,0 +1,53 @@
+// Bio-Hybrid Coffee Machine Example - Copyright (c) 2021 Bio-Hybrid GmbH
+#pragma once
+
+#include <coffeeweb/recipe.h>
+
+#include <array>
+#include <vector>
+
+/// Servings remaining per recipe for the current machine supplies.
+///
+/// The needs of all recipes are kept as one column per supply. A supply change recomputes its
+/// column and the per-recipe minimum in branch-free loops the compiler vectorizes, and reports
+/// the rows whose servings changed. Recipes that do not use the supply never change.
+class RecipeAvailability
+{
+public:
+    enum Supply {
+        Beans,
+        Water,
+        Milk,
+        RestBinSpace, ///< free space in the rest bin, every serving adds its beans
+        SupplyCount
+    };
+
+    /// Servings of a recipe that needs none of the supplies
+    static constexpr int unlimited = 1 << 30;
+
+    /// Sets the available amount of a supply, returns the rows whose servings changed (ascending)
+    const std::vector<int>& setSupply(Supply supply, int amount);
+    int supply(Supply supply) const { return supply_[supply]; }
+
+    /// Adds, changes or removes the needs of recipes, in the row order of the model
+    void insert(int row, const Recipe& recipe);
+    void set(int row, const Recipe& recipe);
+    void remove(int first, int last);
+    void clear();
+
+    int size() const { return int(servings_.size()); }
+    int servings(int row) const { return servings_[size_t(row)]; }
+    bool canMake(int row) const { return servings_[size_t(row)] > 0; }
+
+private:
+    void setNeeds(size_t row, const Recipe& recipe);
+    qint32 servingsOf(size_t row) const;
+
+    std::array<int, SupplyCount> supply_ {};
+    std::array<std::vector<qint32>, SupplyCount> needs_;
+    std::array<std::vector<float>, SupplyCount> inverseNeeds_; ///< 1 / need, 0 if not needed
+    std::array<std::vector<qint32>, SupplyCount> perSupply_;   ///< servings of each supply alone
+    std::vector<qint32> servings_;
+    std::vector<qint32> previous_;
+    std::vector<int> changed_;
+};
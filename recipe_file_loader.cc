@@ -0,0 +1,138 @@
+// Bio-Hybrid Coffee Machine Example - Copyright (c) 2021 Bio-Hybrid GmbH
+#include "recipe_file_loader.h"
+
+#include <coffeeweb/recipecatalog.h>
+#include <coffeeweb/recipestreamparser.h>
+
+#include <QFile>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QHash>
+#include <QSet>
+#include <QTimer>
+#include <QtConcurrent>
+#include <QDebug>
+
+// -------------------------------------------------------------------------------------------------
+namespace {
+    constexpr char catalogMagic[] = "CWRCPCAT";
+    constexpr auto debounceMs = 50; // editors write a file in several steps
+
+    QString validate(const QVector<Recipe>& recipes)
+    {
+        QSet<QString> names;
+        names.reserve(recipes.size());
+        for (const auto& recipe : recipes) {
+            if (recipe.name.isEmpty()) return "Recipe without name";
+            if (recipe.beansGram <= 0 || recipe.waterMl <= 0) {
+                return QString("Recipe '%1' needs beans and water").arg(recipe.name);
+            }
+            if (names.contains(recipe.name)) return QString("Duplicate recipe '%1'").arg(recipe.name);
+            names.insert(recipe.name);
+        }
+        return {};
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+RecipeFileLoader::RecipeFileLoader(const QString& fileName, QObject* parent)
+    : QObject(parent)
+    , fileName_(QFileInfo(fileName).absoluteFilePath())
+    , watcher_(new QFileSystemWatcher(this))
+    , debounce_(new QTimer(this))
+{
+    debounce_->setSingleShot(true);
+    debounce_->setInterval(debounceMs);
+    connect(debounce_, &QTimer::timeout, this, &RecipeFileLoader::reload);
+    connect(watcher_, &QFileSystemWatcher::fileChanged, debounce_, qOverload<>(&QTimer::start));
+    connect(watcher_, &QFileSystemWatcher::directoryChanged, debounce_, qOverload<>(&QTimer::start));
+    connect(&loading_, &QFutureWatcherBase::finished, this, &RecipeFileLoader::onLoaded);
+}
+
+// -------------------------------------------------------------------------------------------------
+void RecipeFileLoader::start()
+{
+    // The directory is watched as well, a file replaced by rename drops the file watch
+    watcher_->addPath(QFileInfo(fileName_).absolutePath());
+    watch();
+    reload();
+}
+
+// -------------------------------------------------------------------------------------------------
+void RecipeFileLoader::watch()
+{
+    if (!watcher_->files().contains(fileName_) && QFileInfo::exists(fileName_)) {
+        watcher_->addPath(fileName_);
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+void RecipeFileLoader::reload()
+{
+    watch();
+    if (loading_.isRunning()) {
+        reloadPending_ = true;
+        return;
+    }
+    const auto fileName = fileName_;
+    loading_.setFuture(QtConcurrent::run([fileName]() { return load(fileName); }));
+}
+
+// -------------------------------------------------------------------------------------------------
+void RecipeFileLoader::onLoaded()
+{
+    const auto result = loading_.result();
+    if (!result.error.isEmpty()) {
+        qWarning() << "Loading recipes from" << fileName_ << "failed:" << result.error;
+        emit loadFailed(result.error);
+    } else if (!loaded_ || result.contentHash != contentHash_) {
+        loaded_ = true;
+        contentHash_ = result.contentHash;
+        emit recipesLoaded(result.recipes, result.collectionVersion);
+    }
+
+    if (reloadPending_) {
+        reloadPending_ = false;
+        reload();
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+RecipeFileLoader::Result RecipeFileLoader::load(const QString& fileName)
+{
+    Result result;
+    QFile file(fileName);
+    if (!file.open(QFile::ReadOnly)) {
+        result.error = file.errorString();
+        return result;
+    }
+    const auto size = file.size();
+    const auto data = size > 0 ? reinterpret_cast<const char*>(file.map(0, size)) : nullptr;
+    if (!data) {
+        result.error = size > 0 ? file.errorString() : QString("Empty file");
+        return result;
+    }
+    result.contentHash = qHashBits(data, size_t(size));
+
+    if (size >= qint64(sizeof(catalogMagic) - 1) && qstrncmp(data, catalogMagic, sizeof(catalogMagic) - 1) == 0) {
+        file.unmap(reinterpret_cast<uchar*>(const_cast<char*>(data)));
+        RecipeCatalog catalog;
+        if (!catalog.open(fileName)) {
+            result.error = catalog.errorString();
+            return result;
+        }
+        result.collectionVersion = catalog.collectionVersion();
+        result.recipes.reserve(catalog.count());
+        for (int i = 0; i < catalog.count(); ++i) result.recipes.append(catalog.recipe(i));
+    } else {
+        RecipeStreamParser parser([&result](const QVector<Recipe>& batch) { result.recipes += batch; }, 256);
+        if (!parser.feed(data, size) || !parser.finish()) {
+            result.error = parser.errorString();
+            return result;
+        }
+        result.collectionVersion = parser.collectionVersion();
+    }
+
+    result.error = validate(result.recipes);
+    return result;
+}
@@ -0,0 +1,60 @@
+// Bio-Hybrid Coffee Machine Example - Copyright (c) 2021 Bio-Hybrid GmbH
+#pragma once
+
+#include <coffeeweb/recipe.h>
+
+#include <QFutureWatcher>
+#include <QObject>
+#include <QString>
+#include <QVector>
+
+class QFileSystemWatcher;
+class QTimer;
+
+/// Loads a recipe file (recipes JSON or compiled catalog) and reloads it when it changes.
+///
+/// The file is memory-mapped, parsed and validated on a worker thread. Changes are picked up
+/// through a file system watcher (inotify on Linux), also when editors replace the file.
+/// An invalid file is reported and the last valid recipes stay in place.
+///
+/// There is no incremental parsing: every change re-parses the whole file (a catalog is read in
+/// place), the receiver applies only the differences through RecipeModel's delta update.
+class RecipeFileLoader : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit RecipeFileLoader(const QString& fileName, QObject* parent = nullptr);
+
+    QString fileName() const { return fileName_; }
+
+    /// Loads the file and starts watching it
+    void start();
+
+    struct Result {
+        QVector<Recipe> recipes;
+        QString collectionVersion;
+        QString error;
+        uint contentHash = 0;
+    };
+
+    /// Loads and validates the given file, thread-safe
+    static Result load(const QString& fileName);
+
+signals:
+    void recipesLoaded(const QVector<Recipe>& recipes, const QString& collectionVersion);
+    void loadFailed(const QString& error);
+
+private:
+    void reload();
+    void onLoaded();
+    void watch();
+
+    const QString fileName_;
+    QFileSystemWatcher* watcher_;
+    QTimer* debounce_;
+    QFutureWatcher<Result> loading_;
+    bool reloadPending_ = false;
+    bool loaded_ = false;
+    uint contentHash_ = 0;
+};
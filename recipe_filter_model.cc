@@ -0,0 +1,166 @@
+// Bio-Hybrid Coffee Machine Example - Copyright (c) 2021 Bio-Hybrid GmbH
+#include "recipe_filter_model.h"
+#include "recipe_model.h"
+
+#include <QTimer>
+
+#include <algorithm>
+#include <iterator>
+
+// -------------------------------------------------------------------------------------------------
+RecipeFilterModel::RecipeFilterModel(RecipeModel* recipes, QObject* parent)
+    : QSortFilterProxyModel(parent)
+    , recipes_(recipes)
+{
+    setSourceModel(recipes_);
+
+    // the proxy filters inserted rows before this sees rowsInserted, so they get their place first
+    connect(recipes_, &QAbstractItemModel::rowsAboutToBeInserted, this, &RecipeFilterModel::recipesAboutToBeInserted);
+    connect(recipes_, &QAbstractItemModel::rowsInserted, this, &RecipeFilterModel::recipesChanged);
+    connect(recipes_, &QAbstractItemModel::rowsRemoved, this, &RecipeFilterModel::recipesRemoved);
+    connect(recipes_, &QAbstractItemModel::dataChanged, this, &RecipeFilterModel::recipeDataChanged);
+    connect(recipes_, &QAbstractItemModel::modelReset, this, &RecipeFilterModel::recipesChanged);
+
+    connect(this, &QAbstractItemModel::rowsInserted, this, &RecipeFilterModel::countChanged);
+    connect(this, &QAbstractItemModel::rowsRemoved, this, &RecipeFilterModel::countChanged);
+    connect(this, &QAbstractItemModel::modelReset, this, &RecipeFilterModel::countChanged);
+    connect(this, &QAbstractItemModel::layoutChanged, this, &RecipeFilterModel::countChanged);
+}
+
+// -------------------------------------------------------------------------------------------------
+void RecipeFilterModel::setSearchText(const QString& text)
+{
+    if (filter_.text == text) return;
+    filter_.text = text;
+    refilter();
+}
+
+// -------------------------------------------------------------------------------------------------
+void RecipeFilterModel::setMinBeansGram(int gram)
+{
+    if (filter_.minBeansGram == gram) return;
+    filter_.minBeansGram = gram;
+    refilter();
+}
+
+// -------------------------------------------------------------------------------------------------
+void RecipeFilterModel::setMaxBeansGram(int gram)
+{
+    if (filter_.maxBeansGram == gram) return;
+    filter_.maxBeansGram = gram;
+    refilter();
+}
+
+// -------------------------------------------------------------------------------------------------
+void RecipeFilterModel::setMinWaterMl(int ml)
+{
+    if (filter_.minWaterMl == ml) return;
+    filter_.minWaterMl = ml;
+    refilter();
+}
+
+// -------------------------------------------------------------------------------------------------
+void RecipeFilterModel::setMaxWaterMl(int ml)
+{
+    if (filter_.maxWaterMl == ml) return;
+    filter_.maxWaterMl = ml;
+    refilter();
+}
+
+// -------------------------------------------------------------------------------------------------
+void RecipeFilterModel::setMilk(MilkFilter milk)
+{
+    if (filter_.milk == RecipeIndex::Milk(milk)) return;
+    filter_.milk = RecipeIndex::Milk(milk);
+    refilter();
+}
+
+// -------------------------------------------------------------------------------------------------
+void RecipeFilterModel::resetFilter()
+{
+    filter_ = RecipeIndex::Filter();
+    refilter();
+}
+
+// -------------------------------------------------------------------------------------------------
+void RecipeFilterModel::updateIndex()
+{
+    if (!indexDirty_) return;
+    index_.build(recipes_->recipes());
+    indexDirty_ = false;
+}
+
+// -------------------------------------------------------------------------------------------------
+bool RecipeFilterModel::filterAcceptsRow(int sourceRow, const QModelIndex&) const
+{
+    if (sourceRow < int(accepted_.size())) return accepted_[size_t(sourceRow)];
+    // rows that arrived after the last query are shown until the pending refilter
+    return filter_.isEmpty();
+}
+
+// -------------------------------------------------------------------------------------------------
+void RecipeFilterModel::recipesChanged()
+{
+    indexDirty_ = true;
+    if (!filter_.isEmpty()) scheduleRefilter();
+}
+
+// -------------------------------------------------------------------------------------------------
+void RecipeFilterModel::recipeDataChanged(const QModelIndex&, const QModelIndex&, const QVector<int>& roles)
+{
+    // no roles means all of them, e.g. a recipe replaced by an update
+    static const int indexedRoles[] = {
+        Qt::DisplayRole, RecipeModel::NameRole, RecipeModel::BeansRole, RecipeModel::WaterRole,
+        RecipeModel::HasMilkRole, RecipeModel::RecipeRole,
+    };
+    const auto indexed = roles.isEmpty() || std::any_of(std::begin(indexedRoles), std::end(indexedRoles),
+                                                        [&roles](int role) { return roles.contains(role); });
+    if (indexed) recipesChanged();
+}
+
+// -------------------------------------------------------------------------------------------------
+void RecipeFilterModel::recipesAboutToBeInserted(const QModelIndex&, int first, int last)
+{
+    // with a filter the new rows are hidden until the pending refilter, like rows beyond accepted_
+    if (size_t(first) <= accepted_.size()) {
+        accepted_.insert(accepted_.begin() + first, size_t(last - first + 1), filter_.isEmpty());
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+void RecipeFilterModel::recipesRemoved(const QModelIndex&, int first, int last)
+{
+    // the other rows keep their result, only the rows of the index are outdated
+    if (size_t(first) < accepted_.size()) {
+        accepted_.erase(accepted_.begin() + first, accepted_.begin() + std::min(size_t(last) + 1, accepted_.size()));
+    }
+    indexDirty_ = true;
+}
+
+// -------------------------------------------------------------------------------------------------
+void RecipeFilterModel::scheduleRefilter()
+{
+    // coalesce the model changes of one event loop pass (e.g. streamed batches)
+    if (refilterPending_) return;
+    refilterPending_ = true;
+    QTimer::singleShot(0, this, [this]() {
+        refilterPending_ = false;
+        refilter();
+    });
+}
+
+// -------------------------------------------------------------------------------------------------
+void RecipeFilterModel::refilter()
+{
+    const auto count = size_t(recipes_->rowCount());
+    if (filter_.isEmpty()) {
+        accepted_.assign(count, true);
+    } else {
+        updateIndex();
+        accepted_.assign(count, false);
+        for (const auto row : index_.query(filter_)) accepted_[size_t(row)] = true;
+    }
+
+    emit filterChanged();
+    invalidateFilter();
+}
@@ -0,0 +1,76 @@
+// Bio-Hybrid Coffee Machine Example - Copyright (c) 2021 Bio-Hybrid GmbH
+#pragma once
+
+#include <coffeeweb/recipeindex.h>
+
+#include <QSortFilterProxyModel>
+
+#include <vector>
+
+class RecipeModel;
+
+/// Filters the recipe model for the menu, backed by a RecipeIndex.
+///
+/// The index is rebuilt lazily (at most once per event loop pass) when the indexed fields of the
+/// recipes change, each filter change is a single index query. Changes of other roles, e.g. the
+/// availability on supply updates, neither rebuild the index nor refilter, and removed rows keep
+/// the filter result of the others.
+class RecipeFilterModel : public QSortFilterProxyModel
+{
+    Q_OBJECT
+    Q_PROPERTY(QString searchText READ searchText WRITE setSearchText NOTIFY filterChanged)
+    Q_PROPERTY(int minBeansGram READ minBeansGram WRITE setMinBeansGram NOTIFY filterChanged)
+    Q_PROPERTY(int maxBeansGram READ maxBeansGram WRITE setMaxBeansGram NOTIFY filterChanged)
+    Q_PROPERTY(int minWaterMl READ minWaterMl WRITE setMinWaterMl NOTIFY filterChanged)
+    Q_PROPERTY(int maxWaterMl READ maxWaterMl WRITE setMaxWaterMl NOTIFY filterChanged)
+    Q_PROPERTY(MilkFilter milk READ milk WRITE setMilk NOTIFY filterChanged)
+    Q_PROPERTY(int count READ rowCount NOTIFY countChanged)
+
+public:
+    enum MilkFilter { AnyMilk, WithMilk, WithoutMilk };
+    Q_ENUM(MilkFilter)
+
+    explicit RecipeFilterModel(RecipeModel* recipes, QObject* parent = nullptr);
+
+    QString searchText() const { return filter_.text; }
+    int minBeansGram() const { return filter_.minBeansGram; }
+    int maxBeansGram() const { return filter_.maxBeansGram; }
+    int minWaterMl() const { return filter_.minWaterMl; }
+    int maxWaterMl() const { return filter_.maxWaterMl; }
+    MilkFilter milk() const { return MilkFilter(filter_.milk); }
+
+    void setSearchText(const QString& text);
+    void setMinBeansGram(int gram);
+    void setMaxBeansGram(int gram);
+    void setMinWaterMl(int ml);
+    void setMaxWaterMl(int ml);
+    void setMilk(MilkFilter milk);
+
+    /// Resets all filters
+    Q_INVOKABLE void resetFilter();
+
+    /// Rebuilds the search index right away if the recipes changed since the last build
+    void updateIndex();
+
+signals:
+    void filterChanged();
+    void countChanged();
+
+protected:
+    bool filterAcceptsRow(int sourceRow, const QModelIndex& sourceParent) const override;
+
+private:
+    void recipesChanged();
+    void recipeDataChanged(const QModelIndex& topLeft, const QModelIndex& bottomRight, const QVector<int>& roles);
+    void recipesAboutToBeInserted(const QModelIndex& parent, int first, int last);
+    void recipesRemoved(const QModelIndex& parent, int first, int last);
+    void scheduleRefilter();
+    void refilter();
+
+    RecipeModel* const recipes_;
+    RecipeIndex index_;
+    RecipeIndex::Filter filter_;
+    std::vector<bool> accepted_;
+    bool indexDirty_ = true;
+    bool refilterPending_ = false;
+};
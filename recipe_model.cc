@@ -0,0 +1,193 @@
+// Bio-Hybrid Coffee Machine Example - Copyright (c) 2021 Bio-Hybrid GmbH
+#include "recipe_model.h"
+
+#include <algorithm>
+
+// -------------------------------------------------------------------------------------------------
+RecipeModel::RecipeModel(QObject* parent)
+    : QAbstractListModel(parent)
+{
+}
+
+// -------------------------------------------------------------------------------------------------
+int RecipeModel::rowCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : recipes_.size();
+}
+
+// -------------------------------------------------------------------------------------------------
+QVariant RecipeModel::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid() || index.row() >= recipes_.size()) return {};
+
+    const auto& recipe = recipes_.at(index.row());
+    switch (role) {
+    case Qt::DisplayRole:
+    case NameRole: return recipe.name;
+    case BeansRole: return recipe.beansGram;
+    case GrindLevelRole: return recipe.grindLevel;
+    case WaterRole: return recipe.waterMl;
+    case WaterTempRole: return recipe.waterTemp;
+    case HasMilkRole: return recipe.hasMilk;
+    case MilkRole: return recipe.milkMl;
+    case MilkTempRole: return recipe.milkTemp;
+    case FoamRole: return recipe.foamMl;
+    case RecipeRole: return recipe.toJson().toVariantMap();
+    case CanMakeRole: return availability_.canMake(index.row());
+    case ServingsRole: return availability_.servings(index.row());
+    default: return {};
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+QHash<int, QByteArray> RecipeModel::roleNames() const
+{
+    return {
+        {NameRole, "name"},
+        {BeansRole, "beansGram"},
+        {GrindLevelRole, "grindLevel"},
+        {WaterRole, "waterMl"},
+        {WaterTempRole, "waterTemp"},
+        {HasMilkRole, "hasMilk"},
+        {MilkRole, "milkMl"},
+        {MilkTempRole, "milkTemp"},
+        {FoamRole, "foamMl"},
+        {RecipeRole, "recipe"},
+        {CanMakeRole, "canMake"},
+        {ServingsRole, "servings"},
+    };
+}
+
+// -------------------------------------------------------------------------------------------------
+void RecipeModel::beginUpdate(const QString& collectionVersion)
+{
+    ++generation_;
+    updating_ = true;
+    pendingVersion_ = collectionVersion;
+}
+
+// -------------------------------------------------------------------------------------------------
+void RecipeModel::updateRecipes(const QVector<Recipe>& recipes)
+{
+    if (!updating_) beginUpdate(QString());
+
+    const auto size = recipes_.size();
+    QVector<Recipe> added;
+    std::vector<int> changed;
+
+    for (const auto& recipe : recipes) {
+        const auto it = rows_.constFind(recipe.name);
+        if (it == rows_.constEnd()) {
+            rows_.insert(recipe.name, size + added.size());
+            added.append(recipe);
+            continue;
+        }
+
+        const auto row = it.value();
+        if (row >= size) { // duplicate name within this batch, last one wins
+            added[row - size] = recipe;
+            continue;
+        }
+        seenIn_[size_t(row)] = generation_;
+        if (recipes_.at(row) != recipe) {
+            recipes_[row] = recipe;
+            availability_.set(row, recipe);
+            changed.push_back(row);
+        }
+    }
+
+    std::sort(changed.begin(), changed.end());
+    changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+    emitDataChanged(changed, {});
+
+    if (!added.isEmpty()) {
+        beginInsertRows(QModelIndex(), size, size + added.size() - 1);
+        recipes_ += added;
+        for (int i = 0; i < added.size(); ++i) availability_.insert(size + i, added.at(i));
+        seenIn_.resize(size_t(recipes_.size()), generation_);
+        endInsertRows();
+        emit countChanged();
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+void RecipeModel::setSupply(RecipeAvailability::Supply supply, int amount)
+{
+    emitDataChanged(availability_.setSupply(supply, amount), {CanMakeRole, ServingsRole});
+}
+
+// -------------------------------------------------------------------------------------------------
+void RecipeModel::emitDataChanged(const std::vector<int>& rows, const QVector<int>& roles)
+{
+    // one dataChanged per run of adjacent rows
+    for (size_t i = 0; i < rows.size();) {
+        auto j = i;
+        while (j + 1 < rows.size() && rows[j + 1] == rows[j] + 1) ++j;
+        emit dataChanged(index(rows[i]), index(rows[j]), roles);
+        i = j + 1;
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+void RecipeModel::endUpdate()
+{
+    if (!updating_) return;
+    updating_ = false;
+    collectionVersion_ = pendingVersion_;
+
+    // remove runs of rows that were not part of the update, from the back to keep rows valid
+    bool removed = false;
+    for (int last = recipes_.size() - 1; last >= 0;) {
+        if (seenIn_[size_t(last)] == generation_) {
+            --last;
+            continue;
+        }
+        auto first = last;
+        while (first > 0 && seenIn_[size_t(first - 1)] != generation_) --first;
+
+        beginRemoveRows(QModelIndex(), first, last);
+        recipes_.erase(recipes_.begin() + first, recipes_.begin() + last + 1);
+        availability_.remove(first, last);
+        seenIn_.erase(seenIn_.begin() + first, seenIn_.begin() + last + 1);
+        endRemoveRows();
+        removed = true;
+        last = first - 1;
+    }
+
+    if (removed) {
+        rebuildRows();
+        emit countChanged();
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+void RecipeModel::abortUpdate()
+{
+    if (!updating_) return;
+    updating_ = false;
+    // the collection is only partially updated, so the next update must not be skipped
+    collectionVersion_.clear();
+}
+
+// -------------------------------------------------------------------------------------------------
+void RecipeModel::clear()
+{
+    updating_ = false;
+    collectionVersion_.clear();
+    if (recipes_.isEmpty()) return;
+    beginResetModel();
+    recipes_.clear();
+    availability_.clear();
+    rows_.clear();
+    seenIn_.clear();
+    endResetModel();
+    emit countChanged();
+}
+
+// -------------------------------------------------------------------------------------------------
+void RecipeModel::rebuildRows()
+{
+    rows_.clear();
+    rows_.reserve(recipes_.size());
+    for (int row = 0; row < recipes_.size(); ++row) rows_.insert(recipes_.at(row).name, row);
+}
@@ -0,0 +1,88 @@
+// Bio-Hybrid Coffee Machine Example - Copyright (c) 2021 Bio-Hybrid GmbH
+#pragma once
+
+#include "recipe_availability.h"
+
+#include <coffeeweb/recipe.h>
+
+#include <QAbstractListModel>
+#include <QHash>
+#include <QVector>
+
+#include <vector>
+
+/// List model of the recipes shown in the menu.
+///
+/// The recipes are updated as a delta keyed by recipe name: an update inserts new recipes,
+/// changes modified ones in place and removes missing ones, with fine-grained model
+/// notifications so views only touch the affected delegates. The can-make flag and servings
+/// remaining are maintained per recipe as the machine supplies change.
+class RecipeModel : public QAbstractListModel
+{
+    Q_OBJECT
+    Q_PROPERTY(int count READ rowCount NOTIFY countChanged)
+
+public:
+    enum Roles {
+        NameRole = Qt::UserRole + 1,
+        BeansRole,
+        GrindLevelRole,
+        WaterRole,
+        WaterTempRole,
+        HasMilkRole,
+        MilkRole,
+        MilkTempRole,
+        FoamRole,
+        RecipeRole, ///< the recipe as object in the recipes JSON layout
+        CanMakeRole,
+        ServingsRole, ///< servings remaining with the current machine supplies
+    };
+
+    explicit RecipeModel(QObject* parent = nullptr);
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+    /// Returns the recipe at the given row
+    const Recipe& recipe(int row) const { return recipes_.at(row); }
+    const QVector<Recipe>& recipes() const { return recipes_; }
+
+    /// Returns the collection version of the current recipes
+    QString collectionVersion() const { return collectionVersion_; }
+
+    /// Starts a delta update to the given collection version
+    void beginUpdate(const QString& collectionVersion);
+
+    /// Adds or changes the given recipes as part of the running update
+    void updateRecipes(const QVector<Recipe>& recipes);
+
+    /// Finishes the running update, removes all recipes that were not part of it
+    void endUpdate();
+
+    /// Stops the running update without removing any recipes (e.g. on request errors)
+    void abortUpdate();
+
+    /// Removes all recipes
+    void clear();
+
+    /// Sets the available amount of a machine supply, updates the availability of the
+    /// recipes that use it
+    void setSupply(RecipeAvailability::Supply supply, int amount);
+
+signals:
+    void countChanged();
+
+private:
+    void rebuildRows();
+    void emitDataChanged(const std::vector<int>& rows, const QVector<int>& roles);
+
+    QVector<Recipe> recipes_;
+    RecipeAvailability availability_;
+    QHash<QString, int> rows_;    // recipe name -> row
+    std::vector<quint32> seenIn_; // last update generation that contained the row
+    quint32 generation_ = 0;
+    bool updating_ = false;
+    QString collectionVersion_;
+    QString pendingVersion_;
+};
@@ -0,0 +1,228 @@
+// Bio-Hybrid Coffee Machine Example - Copyright (c) 2021 Bio-Hybrid GmbH
+#include "remote_control_server.h"
+
+#include <coffeemaker/coffeemaker.h>
+
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QTimer>
+#include <QDebug>
+
+using namespace RemoteProtocol;
+
+// -------------------------------------------------------------------------------------------------
+namespace {
+    /// Notifications are skipped for a subscriber that does not read, it gets the next one
+    constexpr qint64 maxPendingNotificationBytes = 1024 * 1024;
+
+    /// Number of arguments of each Op
+    constexpr int argumentCounts[int(Op::OpCount)] = {
+        0, 0, 0, 0,         // Ping, GetStatus, Subscribe, Unsubscribe
+        0, 0, 0, 0, 0,      // TurnOn, TurnOff, Start-, Cancel-, FinishCommandMode
+        2, 2, 3,            // Grind, Brew, MilkPrep
+        0, 0,               // PlaceCup, RemoveCup
+        1, 1, 1,            // AddWater, AddMilk, AddBeans
+        0, 0, 0,            // EmptyOverflow, EmptyRestBin, Clean
+        6                   // Service
+    };
+
+    /// Range of the water and milk temperatures, in °C: cold milk up to boiling water
+    constexpr int minTemperatureC = 0;
+    constexpr int maxTemperatureC = 100;
+
+    bool inRange(qint32 value, int min, int max)
+    {
+        return value >= min && value <= max;
+    }
+
+    /// Checks the amounts against the machine's capacities and the temperatures against sane
+    /// ranges, so that no client can drive a level below zero or beyond its maximum
+    bool validArguments(Op op, const qint32* args, const CoffeeMaker& maker)
+    {
+        switch (op) {
+        case Op::Grind:
+            return inRange(args[0], 0, maker.beansContainerMax())
+                && inRange(args[1], int(CoffeeMaker::GrindLevel::ExtraCourse), int(CoffeeMaker::GrindLevel::ExtraFine));
+        case Op::Brew:
+            return inRange(args[0], 0, maker.waterContainerMax()) && inRange(args[1], minTemperatureC, maxTemperatureC);
+        case Op::MilkPrep:
+            return inRange(args[0], 0, maker.milkContainerMax()) && inRange(args[1], minTemperatureC, maxTemperatureC);
+        case Op::AddWater:
+            return inRange(args[0], 0, maker.waterContainerMax());
+        case Op::AddMilk:
+            return inRange(args[0], 0, maker.milkContainerMax());
+        case Op::AddBeans:
+            return inRange(args[0], 0, maker.beansContainerMax());
+        case Op::Service:
+            return inRange(args[0], 0, maker.waterContainerMax()) && inRange(args[1], 0, maker.milkContainerMax())
+                && inRange(args[2], 0, maker.beansContainerMax());
+        default:
+            return true;
+        }
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+RemoteControlServer::RemoteControlServer(CoffeeMaker* maker)
+    : QObject(maker)
+    , maker_(maker)
+    , server_(new QLocalServer(this))
+{
+    connect(server_, &QLocalServer::newConnection, this, &RemoteControlServer::onNewConnection);
+
+    connect(maker, &CoffeeMaker::currentStateChanged, this, &RemoteControlServer::scheduleNotification);
+    connect(maker, &CoffeeMaker::cupDetectedChanged, this, &RemoteControlServer::scheduleNotification);
+    connect(maker, &CoffeeMaker::waterContainerLevelChanged, this, &RemoteControlServer::scheduleNotification);
+    connect(maker, &CoffeeMaker::milkContainerLevelChanged, this, &RemoteControlServer::scheduleNotification);
+    connect(maker, &CoffeeMaker::beansContainerLevelChanged, this, &RemoteControlServer::scheduleNotification);
+    connect(maker, &CoffeeMaker::restBinLevelChanged, this, &RemoteControlServer::scheduleNotification);
+    connect(maker, &CoffeeMaker::overflowContainerLevelChanged, this, &RemoteControlServer::scheduleNotification);
+    connect(maker, &CoffeeMaker::cupsProcessedChanged, this, &RemoteControlServer::scheduleNotification);
+    connect(maker, &CoffeeMaker::levelsChanged, this, &RemoteControlServer::scheduleNotification);
+}
+
+// -------------------------------------------------------------------------------------------------
+bool RemoteControlServer::listen(const QString& name)
+{
+    QLocalServer::removeServer(name);
+    if (!server_->listen(name)) {
+        qWarning() << "Remote control:" << server_->errorString();
+        return false;
+    }
+    qInfo() << "Remote control listening on" << server_->fullServerName();
+    return true;
+}
+
+// -------------------------------------------------------------------------------------------------
+void RemoteControlServer::onNewConnection()
+{
+    while (const auto socket = server_->nextPendingConnection()) {
+        connections_.insert(socket, Connection());
+        connect(socket, &QLocalSocket::readyRead, this, [this, socket]() { onReadyRead(socket); });
+        connect(socket, &QLocalSocket::disconnected, this, [this, socket]() {
+            if (connections_.take(socket).subscribed) --subscribers_;
+            socket->deleteLater();
+        });
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+void RemoteControlServer::onReadyRead(QLocalSocket* socket)
+{
+    auto it = connections_.find(socket);
+    if (it == connections_.end()) return;
+    auto& connection = it.value();
+    connection.in += socket->readAll();
+
+    // All complete frames are answered in order with a single write
+    QByteArray out;
+    Frame request;
+    bool valid = true;
+    int offset = 0;
+    while (take(connection.in, offset, request, valid)) {
+        if (!valid) {
+            appendStatus(out, request.id, Status::BadArguments);
+            continue;
+        }
+        const auto status = execute(request, connection, out);
+        if (status != Status::Ok) appendStatus(out, request.id, status);
+    }
+    connection.in.remove(0, offset);
+    if (!out.isEmpty()) socket->write(out);
+}
+
+// -------------------------------------------------------------------------------------------------
+Status RemoteControlServer::execute(const Frame& request, Connection& connection, QByteArray& out)
+{
+    if (request.code >= quint8(Op::OpCount)) return Status::UnknownOp;
+    const auto op = Op(request.code);
+    if (request.argumentCount != argumentCounts[request.code]) return Status::BadArguments;
+    const auto& args = request.arguments;
+    if (!validArguments(op, args, *maker_)) return Status::BadArguments;
+
+    switch (op) {
+    case Op::Ping: break;
+    case Op::GetStatus:
+        appendStatus(out, request.id, Status::Ok);
+        return Status::Ok;
+    case Op::Subscribe:
+        if (!connection.subscribed) ++subscribers_;
+        connection.subscribed = true;
+        break;
+    case Op::Unsubscribe:
+        if (connection.subscribed) --subscribers_;
+        connection.subscribed = false;
+        break;
+    case Op::TurnOn: maker_->turnOn(); break;
+    case Op::TurnOff: maker_->turnOff(); break;
+    case Op::StartCommandMode: maker_->startCommandMode(); break;
+    case Op::CancelCommandMode: maker_->cancelCommandMode(); break;
+    case Op::FinishCommandMode: maker_->finishCommandMode(); break;
+    case Op::Grind:
+        maker_->doGrinding(args[0], CoffeeMaker::GrindLevel(args[1]));
+        break;
+    case Op::Brew: maker_->doBrew(args[0], args[1]); break;
+    case Op::MilkPrep: maker_->doMilkPrep(args[0], args[1], args[2] != 0); break;
+    case Op::PlaceCup: maker_->placeCup(); break;
+    case Op::RemoveCup: maker_->removeCup(); break;
+    case Op::AddWater: maker_->addWatertoContainer(args[0]); break;
+    case Op::AddMilk: maker_->addMilkToContainer(args[0]); break;
+    case Op::AddBeans: maker_->addBeanstoContainer(args[0]); break;
+    case Op::EmptyOverflow: maker_->emptyOverflowContainer(); break;
+    case Op::EmptyRestBin: maker_->emptyRestBinContainer(); break;
+    case Op::Clean: maker_->cleanTheMachine(); break;
+    case Op::Service: {
+        CoffeeMaker::Maintenance maintenance;
+        maintenance.addWaterMl = args[0];
+        maintenance.addMilkMl = args[1];
+        maintenance.addBeansGram = args[2];
+        maintenance.emptyOverflow = args[3] != 0;
+        maintenance.emptyRestBin = args[4] != 0;
+        maintenance.clean = args[5] != 0;
+        maker_->applyMaintenance(maintenance);
+        break;
+    }
+    case Op::OpCount: return Status::UnknownOp;
+    }
+    append(out, request.id, quint8(Status::Ok));
+    return Status::Ok;
+}
+
+// -------------------------------------------------------------------------------------------------
+void RemoteControlServer::appendStatus(QByteArray& out, quint32 id, Status status) const
+{
+    if (status != Status::Ok && status != Status::StatusNotification) {
+        append(out, id, quint8(status));
+        return;
+    }
+    qint32 fields[StatusFieldCount];
+    fields[State] = qint32(maker_->currentState());
+    fields[Water] = maker_->waterContainerLevel();
+    fields[Milk] = maker_->milkContainerLevel();
+    fields[Beans] = maker_->beansContainerLevel();
+    fields[RestBin] = maker_->restBinLevel();
+    fields[Overflow] = maker_->overflowContainerLevel();
+    fields[CupsProcessed] = maker_->cupsProcessed();
+    fields[CupDetected] = maker_->cupDetected() ? 1 : 0;
+    append(out, id, quint8(status), fields, StatusFieldCount);
+}
+
+// -------------------------------------------------------------------------------------------------
+void RemoteControlServer::scheduleNotification()
+{
+    if (subscribers_ == 0 || notificationPending_) return;
+    notificationPending_ = true;
+    QTimer::singleShot(0, this, &RemoteControlServer::notify);
+}
+
+// -------------------------------------------------------------------------------------------------
+void RemoteControlServer::notify()
+{
+    notificationPending_ = false;
+    QByteArray frame;
+    appendStatus(frame, 0, Status::StatusNotification);
+    for (auto it = connections_.cbegin(); it != connections_.cend(); ++it) {
+        if (!it.value().subscribed || it.key()->bytesToWrite() > maxPendingNotificationBytes) continue;
+        it.key()->write(frame);
+    }
+}
@@ -0,0 +1,47 @@
+// Bio-Hybrid Coffee Machine Example - Copyright (c) 2021 Bio-Hybrid GmbH
+#pragma once
+
+#include "remote_protocol.h"
+
+#include <QHash>
+#include <QObject>
+
+class CoffeeMaker;
+class QLocalServer;
+class QLocalSocket;
+
+/// Serves the RemoteProtocol for a CoffeeMaker on a local socket.
+///
+/// Lives on the machine's thread as a child of the machine: requests call the machine directly
+/// and the responses of all frames received in one read are sent with one write. Notifications are
+/// coalesced, subscribers get at most one status per event loop pass.
+class RemoteControlServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit RemoteControlServer(CoffeeMaker* maker);
+
+    /// Listens on the local socket `name`, false if that fails
+    bool listen(const QString& name);
+
+private:
+    struct Connection {
+        QByteArray in;
+        bool subscribed = false;
+    };
+
+    void onNewConnection();
+    void onReadyRead(QLocalSocket* socket);
+    RemoteProtocol::Status execute(const RemoteProtocol::Frame& request, Connection& connection, QByteArray& out);
+    void appendStatus(QByteArray& out, quint32 id, RemoteProtocol::Status status) const;
+    void scheduleNotification();
+    void notify();
+
+private:
+    CoffeeMaker* maker_;
+    QLocalServer* server_;
+    QHash<QLocalSocket*, Connection> connections_;
+    int subscribers_ = 0;
+    bool notificationPending_ = false;
+};
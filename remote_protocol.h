@@ -0,0 +1,97 @@
+// Bio-Hybrid Coffee Machine Example - Copyright (c) 2021 Bio-Hybrid GmbH
+#pragma once
+
+#include <QByteArray>
+#include <QtEndian>
+
+/// Binary remote-control protocol of the CoffeeMaker, spoken over a local socket.
+///
+/// Every message is a frame of a 7 byte little-endian header and up to `maxArguments` signed
+/// 32-bit little-endian arguments:
+///
+///     quint16 argumentBytes | quint32 correlationId | quint8 code | qint32 arguments...
+///
+/// Requests carry an `Op` as code, responses echo the correlation id with a `Status`. Requests
+/// are answered in order, so a client may pipeline any number of them; a batch is simply several
+/// frames in one write and is answered with one write. Notifications use correlation id 0.
+namespace RemoteProtocol {
+
+    constexpr int headerSize = 7;
+    constexpr int maxArguments = 8;
+
+    enum class Op : quint8 {
+        Ping,
+        GetStatus,          ///< replies with the status arguments
+        Subscribe,          ///< status notifications after every change
+        Unsubscribe,
+        TurnOn,
+        TurnOff,
+        StartCommandMode,
+        CancelCommandMode,
+        FinishCommandMode,
+        Grind,              ///< beansGram, GrindLevel
+        Brew,               ///< waterMl, temperatureC
+        MilkPrep,           ///< milkMl, temperatureC, foam
+        PlaceCup,
+        RemoveCup,
+        AddWater,           ///< waterMl
+        AddMilk,            ///< milkMl
+        AddBeans,           ///< beansGram
+        EmptyOverflow,
+        EmptyRestBin,
+        Clean,
+        Service,            ///< waterMl, milkMl, beansGram, emptyOverflow, emptyRestBin, clean, at once
+        OpCount
+    };
+
+    enum class Status : quint8 {
+        Ok,
+        UnknownOp,
+        BadArguments,       ///< wrong count, negative amounts, beyond the capacities or 0-100 °C
+        StatusNotification = 0x80   ///< correlation id 0, status arguments
+    };
+
+    /// Arguments of GetStatus replies and status notifications
+    enum StatusField {
+        State, Water, Milk, Beans, RestBin, Overflow, CupsProcessed, CupDetected, StatusFieldCount
+    };
+
+    struct Frame {
+        quint32 id = 0;
+        quint8 code = 0;
+        int argumentCount = 0;
+        qint32 arguments[maxArguments] = {};
+    };
+
+    /// Appends a frame to `out`
+    inline void append(QByteArray& out, quint32 id, quint8 code, const qint32* arguments = nullptr, int count = 0)
+    {
+        const auto offset = out.size();
+        out.resize(offset + headerSize + count * 4);
+        auto data = reinterpret_cast<uchar*>(out.data()) + offset;
+        qToLittleEndian<quint16>(quint16(count * 4), data);
+        qToLittleEndian<quint32>(id, data + 2);
+        data[6] = code;
+        for (int i = 0; i < count; ++i) qToLittleEndian<qint32>(arguments[i], data + headerSize + i * 4);
+    }
+
+    /// Reads the frame at `offset` and advances it, false if the frame is incomplete.
+    /// `valid` is false for frames with more than `maxArguments` or a partial argument.
+    inline bool take(const QByteArray& in, int& offset, Frame& frame, bool& valid)
+    {
+        if (in.size() - offset < headerSize) return false;
+        const auto data = reinterpret_cast<const uchar*>(in.constData()) + offset;
+        const auto argumentBytes = int(qFromLittleEndian<quint16>(data));
+        if (in.size() - offset < headerSize + argumentBytes) return false;
+
+        frame.id = qFromLittleEndian<quint32>(data + 2);
+        frame.code = data[6];
+        valid = argumentBytes % 4 == 0 && argumentBytes / 4 <= maxArguments;
+        frame.argumentCount = valid ? argumentBytes / 4 : 0;
+        for (int i = 0; i < frame.argumentCount; ++i) {
+            frame.arguments[i] = qFromLittleEndian<qint32>(data + headerSize + i * 4);
+        }
+        offset += headerSize + argumentBytes;
+        return true;
+    }
+}
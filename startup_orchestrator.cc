@@ -0,0 +1,37 @@
+// Bio-Hybrid Coffee Machine Example - Copyright (c) 2021 Bio-Hybrid GmbH
+#include "startup_orchestrator.h"
+
+// -------------------------------------------------------------------------------------------------
+StartupOrchestrator::StartupOrchestrator(StartupTimeline* timeline, QObject* parent)
+    : QObject(parent)
+    , timeline_(timeline)
+{
+}
+
+// -------------------------------------------------------------------------------------------------
+void StartupOrchestrator::join(const QString& phase)
+{
+    const auto it = pending_.find(phase);
+    if (it == pending_.end() || !*it) return;
+
+    // Taken out first, applying the result may join again
+    const auto joinWorker = std::move(*it);
+    *it = nullptr;
+    joinWorker();
+    end(phase);
+}
+
+// -------------------------------------------------------------------------------------------------
+void StartupOrchestrator::begin(const QString& phase)
+{
+    pending_.insert(phase, nullptr);
+    timeline_->begin(phase);
+}
+
+// -------------------------------------------------------------------------------------------------
+void StartupOrchestrator::end(const QString& phase)
+{
+    if (!pending_.remove(phase)) return;
+    timeline_->end(phase);
+    if (pending_.isEmpty()) emit finished();
+}
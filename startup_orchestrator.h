@@ -0,0 +1,68 @@
+// Bio-Hybrid Coffee Machine Example - Copyright (c) 2021 Bio-Hybrid GmbH
+#pragma once
+
+#include "startup_timeline.h"
+
+#include <QFutureWatcher>
+#include <QHash>
+#include <QObject>
+#include <QtConcurrent>
+
+#include <functional>
+
+/// Runs independent startup phases concurrently and joins their results on the GUI thread.
+///
+/// Phases are either worker phases started with run(), or asynchronous phases (the machine
+/// thread, network replies, the first frame) marked with begin() and end(). finished() is
+/// emitted once all phases have ended.
+class StartupOrchestrator : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit StartupOrchestrator(StartupTimeline* timeline, QObject* parent = nullptr);
+
+    /// Runs `work` on a worker thread and `apply` with its result on the GUI thread, either when
+    /// the worker is done or when the phase is joined, whatever comes first
+    template<typename T>
+    void run(const QString& phase, std::function<T()> work, std::function<void(const T&)> apply);
+
+    /// Waits for the worker of `phase` and applies its result right away, ignored for phases
+    /// without a worker or whose result was applied already
+    void join(const QString& phase);
+
+    /// Marks the begin and end of an asynchronous phase, ending an unknown phase is ignored
+    void begin(const QString& phase);
+    void end(const QString& phase);
+
+    /// Returns if all phases have ended
+    bool isFinished() const { return pending_.isEmpty(); }
+
+signals:
+    void finished();
+
+private:
+    StartupTimeline* timeline_;
+    QHash<QString, std::function<void()>> pending_; ///< phase -> join of its worker, if any
+};
+
+// -------------------------------------------------------------------------------------------------
+template<typename T>
+void StartupOrchestrator::run(const QString& phase, std::function<T()> work, std::function<void(const T&)> apply)
+{
+    begin(phase);
+    const auto timeline = timeline_;
+    const auto watcher = new QFutureWatcher<T>(this);
+    pending_[phase] = [watcher, apply]() {
+        watcher->waitForFinished();
+        apply(watcher->result());
+        watcher->deleteLater();
+    };
+    connect(watcher, &QFutureWatcherBase::finished, this, [this, phase]() { join(phase); });
+    watcher->setFuture(QtConcurrent::run([timeline, phase, work]() {
+        timeline->begin(phase + " (worker)");
+        const auto result = work();
+        timeline->end(phase + " (worker)");
+        return result;
+    }));
+}
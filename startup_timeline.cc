@@ -0,0 +1,92 @@
+// Bio-Hybrid Coffee Machine Example - Copyright (c) 2021 Bio-Hybrid GmbH
+#include "startup_timeline.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QThread>
+#include <QDebug>
+
+#include <algorithm>
+
+// -------------------------------------------------------------------------------------------------
+namespace {
+    QElapsedTimer& startupClock() {
+        static QElapsedTimer clock;
+        return clock;
+    }
+
+    QString currentThreadName() {
+        const auto thread = QThread::currentThread();
+        if (thread == QCoreApplication::instance()->thread()) return "gui";
+        return thread->objectName().isEmpty() ? QString("worker") : thread->objectName();
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+void StartupTimeline::start()
+{
+    startupClock().start();
+}
+
+// -------------------------------------------------------------------------------------------------
+qint64 StartupTimeline::elapsedNs()
+{
+    return startupClock().isValid() ? startupClock().nsecsElapsed() : 0;
+}
+
+// -------------------------------------------------------------------------------------------------
+StartupTimeline::StartupTimeline(bool measuring, QObject* parent)
+    : QObject(parent)
+    , measuring_(measuring)
+{
+}
+
+// -------------------------------------------------------------------------------------------------
+void StartupTimeline::mark(const QString& name)
+{
+    {
+        QMutexLocker lock(&mutex_);
+        entries_.append({name, elapsedNs(), -1, currentThreadName()});
+    }
+    emit marked(name);
+}
+
+// -------------------------------------------------------------------------------------------------
+void StartupTimeline::begin(const QString& phase)
+{
+    QMutexLocker lock(&mutex_);
+    entries_.append({phase, elapsedNs(), elapsedNs(), currentThreadName()});
+}
+
+// -------------------------------------------------------------------------------------------------
+void StartupTimeline::end(const QString& phase)
+{
+    const auto now = elapsedNs();
+    QMutexLocker lock(&mutex_);
+    const auto it = std::find_if(entries_.rbegin(), entries_.rend(), [&phase](const Entry& e) {
+        return e.name == phase && e.endNs >= 0;
+    });
+    if (it != entries_.rend()) it->endNs = now;
+}
+
+// -------------------------------------------------------------------------------------------------
+void StartupTimeline::report() const
+{
+    QMutexLocker lock(&mutex_);
+    auto entries = entries_;
+    std::stable_sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+        return a.beginNs < b.beginNs;
+    });
+
+    qInfo() << "Startup timeline (ms since main):";
+    for (const auto& e : entries) {
+        if (e.endNs < 0) {
+            qInfo().noquote() << QString("  %1          %2  [%3]")
+                                 .arg(e.beginNs / 1e6, 8, 'f', 1).arg(e.name, -28).arg(e.thread);
+        } else {
+            qInfo().noquote() << QString("  %1 - %2  %3  [%4] %5 ms")
+                                 .arg(e.beginNs / 1e6, 8, 'f', 1).arg(e.endNs / 1e6, 8, 'f', 1)
+                                 .arg(e.name, -28).arg(e.thread).arg((e.endNs - e.beginNs) / 1e6, 0, 'f', 1);
+        }
+    }
+}
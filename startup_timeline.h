@@ -0,0 +1,53 @@
+// Bio-Hybrid Coffee Machine Example - Copyright (c) 2021 Bio-Hybrid GmbH
+#pragma once
+
+#include <QMutex>
+#include <QObject>
+#include <QString>
+#include <QVector>
+
+/// Records the startup phases of the application, relative to the start of main().
+///
+/// Phases can be begun and ended from any thread, report() logs them as a timeline.
+class StartupTimeline : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(bool measuring READ measuring CONSTANT)
+
+public:
+    /// Starts the startup clock, to be called first thing in main()
+    static void start();
+
+    /// Returns the nanoseconds since start()
+    static qint64 elapsedNs();
+
+    explicit StartupTimeline(bool measuring, QObject* parent = nullptr);
+
+    /// Returns if startup is measured (and the application quits once the menu is interactive)
+    bool measuring() const { return measuring_; }
+
+    /// Records a point in time
+    Q_INVOKABLE void mark(const QString& name);
+
+    /// Records the begin and end of a phase
+    void begin(const QString& phase);
+    void end(const QString& phase);
+
+    /// Logs the recorded timeline
+    void report() const;
+
+signals:
+    void marked(const QString& name);
+
+private:
+    struct Entry {
+        QString name;
+        qint64 beginNs = 0;
+        qint64 endNs = -1; ///< -1 for marks
+        QString thread;
+    };
+
+    const bool measuring_;
+    mutable QMutex mutex_;
+    QVector<Entry> entries_;
+};
@@ -0,0 +1,188 @@
+// Bio-Hybrid Coffee Machine Example - Copyright (c) 2021 Bio-Hybrid GmbH
+#include <coffeemaker/benchsupport.h>
+#include <coffeemaker/coffeemaker.h>
+
+#include <QSettings>
+#include <QtTest>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+// -------------------------------------------------------------------------------------------------
+namespace {
+    using State = CoffeeMaker::State;
+
+    CoffeeMaker::Levels levels(int beans, int water, int milk, int restBin, int overflow, int cupsProcessed)
+    {
+        CoffeeMaker::Levels levels;
+        levels.beans = beans;
+        levels.water = water;
+        levels.milk = milk;
+        levels.restBin = restBin;
+        levels.overflow = overflow;
+        levels.cupsProcessed = cupsProcessed;
+        return levels;
+    }
+
+    bool equal(const CoffeeMaker::Levels& a, const CoffeeMaker::Levels& b)
+    {
+        return a.beans == b.beans && a.water == b.water && a.milk == b.milk && a.restBin == b.restBin
+            && a.overflow == b.overflow && a.cupsProcessed == b.cupsProcessed;
+    }
+
+    QSettings* machineSettings(int machineId)
+    {
+        return new QSettings("MyCoffeeMachine", QString("MachineState-%1").arg(machineId));
+    }
+}
+
+/// The snapshot a machine resumes from and the maintenance transaction
+class CoffeeMakerTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void snapshotRoundTrip();
+    void damagedSnapshotStartsCold();
+    void snapshotOfAnotherModelStartsCold();
+    void maintenanceIsOneTransaction();
+    void maintenanceFillsUpToCapacity();
+
+private:
+    /// Runs a machine of `model` to stand by with a cup placed and saves its snapshot
+    void saveStandBy(int machineId, HardwareModel model, const CoffeeMaker::Levels& levels);
+
+    const SettingsSandbox settingsSandbox_;
+};
+
+// -------------------------------------------------------------------------------------------------
+void CoffeeMakerTest::saveStandBy(int machineId, HardwareModel model, const CoffeeMaker::Levels& levels)
+{
+    CoffeeMaker maker(model, levels);
+    maker.setMachineId(machineId);
+    maker.setTimeScale(0.001);
+    maker.turnOn();
+    QTRY_COMPARE(maker.currentState(), State::StandBy);
+    maker.placeCup();
+}
+
+// -------------------------------------------------------------------------------------------------
+void CoffeeMakerTest::snapshotRoundTrip()
+{
+    const auto saved = levels(300, 600, 400, 100, 50, 3);
+    saveStandBy(1, HardwareModel::Standard, saved);
+    if (QTest::currentTestFailed()) return;
+
+    const auto snapshot = CoffeeMaker::loadSnapshot(1);
+    QCOMPARE(snapshot.state, State::StandBy);
+    QCOMPARE(snapshot.model, HardwareModel::Standard);
+    QVERIFY(snapshot.cupDetected);
+    QVERIFY(equal(snapshot.checkedLevels, saved));
+
+    // Resumes in stand by, without the power-on self-check
+    CoffeeMaker resumed(snapshot);
+    std::vector<State> entered;
+    connect(&resumed, &CoffeeMaker::currentStateChanged, this, [&entered](State state) { entered.push_back(state); });
+    QTRY_COMPARE(resumed.currentState(), State::StandBy);
+    QVERIFY(resumed.cupDetected());
+    QVERIFY(std::find(entered.begin(), entered.end(), State::SelfCheck) == entered.end());
+}
+
+// -------------------------------------------------------------------------------------------------
+void CoffeeMakerTest::damagedSnapshotStartsCold()
+{
+    saveStandBy(2, HardwareModel::Standard, levels(300, 600, 400, 100, 50, 3));
+    if (QTest::currentTestFailed()) return;
+
+    const std::unique_ptr<QSettings> settings(machineSettings(2));
+    const auto intact = settings->value("snapshot").toByteArray();
+    QVERIFY(intact.size() > 8);
+    QCOMPARE(CoffeeMaker::loadSnapshot(2).state, State::StandBy);
+
+    auto flipped = intact;
+    flipped[flipped.size() / 2] = char(flipped[flipped.size() / 2] ^ 0x01);
+    const QByteArray damaged[] = {flipped, intact.left(intact.size() - 1), intact + '\0', QByteArray()};
+    for (const auto& data : damaged) {
+        settings->setValue("snapshot", data);
+        settings->sync();
+        QCOMPARE(CoffeeMaker::loadSnapshot(2).state, State::Off);
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+void CoffeeMakerTest::snapshotOfAnotherModelStartsCold()
+{
+    // More water than a standard machine holds
+    saveStandBy(3, HardwareModel::Cafe, levels(1000, 3000, 1500, 0, 0, 0));
+    if (QTest::currentTestFailed()) return;
+    QCOMPARE(CoffeeMaker::loadSnapshot(3).state, State::Off);
+
+    const std::unique_ptr<QSettings> settings(machineSettings(3));
+    settings->setValue("hardwareModel", "cafe");
+    settings->sync();
+    const auto snapshot = CoffeeMaker::loadSnapshot(3);
+    QCOMPARE(snapshot.model, HardwareModel::Cafe);
+    QCOMPARE(snapshot.state, State::StandBy);
+}
+
+// -------------------------------------------------------------------------------------------------
+void CoffeeMakerTest::maintenanceIsOneTransaction()
+{
+    // Bin full and due for cleaning
+    CoffeeMaker maker(levels(10, 100, 0, StandardProfile::restBinMax, 0, StandardProfile::maxCupsUntilCleanReq));
+    maker.setMachineId(4);
+    maker.setTimeScale(0.001);
+    maker.turnOn();
+    QTRY_COMPARE(maker.currentState(), State::BinFull);
+
+    int levelsChanged = 0, singleLevelChanged = 0;
+    std::vector<State> entered;
+    connect(&maker, &CoffeeMaker::levelsChanged, this, [&levelsChanged]() { ++levelsChanged; });
+    const auto countSingle = [&singleLevelChanged]() { ++singleLevelChanged; };
+    connect(&maker, &CoffeeMaker::beansContainerLevelChanged, this, countSingle);
+    connect(&maker, &CoffeeMaker::waterContainerLevelChanged, this, countSingle);
+    connect(&maker, &CoffeeMaker::restBinLevelChanged, this, countSingle);
+    connect(&maker, &CoffeeMaker::cupsProcessedChanged, this, countSingle);
+    connect(&maker, &CoffeeMaker::currentStateChanged, this, [&entered](State state) { entered.push_back(state); });
+
+    CoffeeMaker::Maintenance maintenance;
+    maintenance.addBeansGram = 200;
+    maintenance.addWaterMl = 500;
+    maintenance.emptyRestBin = true;
+    maintenance.clean = true;
+    maker.applyMaintenance(maintenance);
+
+    QCOMPARE(levelsChanged, 1);
+    QCOMPARE(singleLevelChanged, 0);
+    QVERIFY(equal(maker.levels(), levels(210, 600, 0, 0, 0, 0)));
+    QVERIFY(equal(CoffeeMaker::loadLevels(4), maker.levels()));
+
+    // Emptied and cleaned together: straight to stand by, never cleaning required in between
+    QTRY_COMPARE(maker.currentState(), State::StandBy);
+    QCOMPARE(entered, std::vector<State>({State::StandBy}));
+
+    // Nothing changes, nothing is written or signalled
+    maker.applyMaintenance(CoffeeMaker::Maintenance());
+    QCOMPARE(levelsChanged, 1);
+}
+
+// -------------------------------------------------------------------------------------------------
+void CoffeeMakerTest::maintenanceFillsUpToCapacity()
+{
+    CoffeeMaker maker(HardwareModel::Compact, levels(10, 100, 50, 0, 0, 0));
+    maker.setMachineId(5);
+
+    CoffeeMaker::Maintenance maintenance;
+    maintenance.addBeansGram = 10000;
+    maintenance.addWaterMl = 10000;
+    maintenance.addMilkMl = -50;
+    maker.applyMaintenance(maintenance);
+
+    QCOMPARE(maker.beansContainerLevel(), CompactProfile::beansMax);
+    QCOMPARE(maker.waterContainerLevel(), CompactProfile::waterMax);
+    QCOMPARE(maker.milkContainerLevel(), 50);
+}
+
+QTEST_GUILESS_MAIN(CoffeeMakerTest)
+#include "coffeemaker_test.moc"
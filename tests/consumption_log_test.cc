@@ -0,0 +1,258 @@
+// Bio-Hybrid Coffee Machine Example - Copyright (c) 2021 Bio-Hybrid GmbH
+#include <coffeemaker/consumptionlog.h>
+
+#include <QFileInfo>
+#include <QTemporaryDir>
+#include <QtEndian>
+#include <QtTest>
+
+#include <memory>
+
+// -------------------------------------------------------------------------------------------------
+namespace {
+    constexpr qint64 hourMs = 3600 * 1000;
+    constexpr qint64 startMs = 1599998400000;   ///< a whole hour since the epoch
+
+    /// Byte offsets of the first block of a log without dictionary entries
+    constexpr int firstBlockRows = 8 + 1;
+    constexpr int firstBlockMinMs = firstBlockRows + 4;
+    constexpr int firstBlockMaxMs = firstBlockMinMs + 8;
+
+    ConsumptionRow row(qint64 timestampMs, qint32 recipeId, qint32 milkMl)
+    {
+        ConsumptionRow row;
+        row.timestampMs = timestampMs;
+        row.recipeId = recipeId;
+        row.beansGram = 8 + recipeId;
+        row.waterMl = 40 + 10 * recipeId;
+        row.milkMl = milkMl;
+        row.grindMs = 2500;
+        row.brewMs = 3003 - recipeId;
+        row.milkPrepMs = milkMl > 0 ? 3500 : 0;
+        return row;
+    }
+
+    bool equal(const ConsumptionRow& a, const ConsumptionRow& b)
+    {
+        return a.timestampMs == b.timestampMs && a.recipeId == b.recipeId && a.beansGram == b.beansGram
+            && a.waterMl == b.waterMl && a.milkMl == b.milkMl && a.grindMs == b.grindMs
+            && a.brewMs == b.brewMs && a.milkPrepMs == b.milkPrepMs;
+    }
+
+    template <typename T>
+    bool patch(const QString& fileName, qint64 offset, T value)
+    {
+        QFile file(fileName);
+        if (!file.open(QIODevice::ReadWrite) || !file.seek(offset)) return false;
+        uchar bytes[sizeof(T)];
+        qToLittleEndian(value, bytes);
+        return file.write(reinterpret_cast<const char*>(bytes), qint64(sizeof(T))) == qint64(sizeof(T));
+    }
+}
+
+/// The column codec of the consumption log and the validation of its reader
+class ConsumptionLogTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void rowsRoundTrip();
+    void aggregatesPerHourAndRecipe();
+    void fullBlocksAreWrittenOnTheirOwn();
+    void reopenContinuesTheDictionary();
+    void truncatedBlockEndsTheLog();
+    void corruptBlockHeadersAreRejected();
+    void corruptBlockHeadersAreRejected_data();
+
+private:
+    QString writeLog(const std::vector<ConsumptionRow>& rows, bool withDictionary = true);
+
+    std::unique_ptr<QTemporaryDir> dir_;
+};
+
+// -------------------------------------------------------------------------------------------------
+void ConsumptionLogTest::init()
+{
+    dir_.reset(new QTemporaryDir);
+    QVERIFY(dir_->isValid());
+}
+
+// -------------------------------------------------------------------------------------------------
+QString ConsumptionLogTest::writeLog(const std::vector<ConsumptionRow>& rows, bool withDictionary)
+{
+    const auto fileName = dir_->filePath("consumption.log");
+    ConsumptionLog log;
+    if (!log.open(fileName)) return QString();
+    if (withDictionary) {
+        log.recipeId("espresso");
+        log.recipeId("latte macchiato");
+    }
+    for (const auto& row : rows) log.append(row);
+    return log.flush() ? fileName : QString();
+}
+
+// -------------------------------------------------------------------------------------------------
+void ConsumptionLogTest::rowsRoundTrip()
+{
+    // Decreasing values and large jumps take the negative and the long deltas
+    const std::vector<ConsumptionRow> rows = {
+        row(startMs, 1, 200), row(startMs + 1, 0, 0), row(startMs + 90000, 1, 150),
+        row(startMs + 90000, 0, 0), row(startMs + 40 * hourMs, 1, 2000),
+    };
+    const auto fileName = writeLog(rows);
+    QVERIFY(!fileName.isEmpty());
+
+    ConsumptionLogReader reader;
+    QVERIFY2(reader.open(fileName), qPrintable(reader.errorString()));
+    QCOMPARE(reader.recipes(), QStringList({"espresso", "latte macchiato"}));
+    QCOMPARE(reader.rowCount(), quint64(rows.size()));
+    QCOMPARE(reader.validBytes(), QFileInfo(fileName).size());
+
+    std::vector<ConsumptionRow> read;
+    reader.scan(startMs, startMs + 41 * hourMs, [&read](const ConsumptionRow& row) { read.push_back(row); });
+    QCOMPARE(read.size(), rows.size());
+    for (size_t i = 0; i < rows.size(); ++i) QVERIFY2(equal(read[i], rows[i]), qPrintable(QString("row %1").arg(i)));
+
+    // The range is half open
+    int inRange = 0;
+    reader.scan(startMs + 1, startMs + 90000, [&inRange](const ConsumptionRow&) { ++inRange; });
+    QCOMPARE(inRange, 1);
+}
+
+// -------------------------------------------------------------------------------------------------
+void ConsumptionLogTest::aggregatesPerHourAndRecipe()
+{
+    const auto fileName = writeLog({
+        row(startMs + 10, 0, 0), row(startMs + 20, 1, 200), row(startMs + 30, 0, 0),
+        row(startMs + hourMs + 5, 1, 150),
+    });
+    QVERIFY(!fileName.isEmpty());
+
+    ConsumptionLogReader reader;
+    QVERIFY(reader.open(fileName));
+    const auto buckets = reader.aggregate(startMs, startMs + 2 * hourMs);
+    QCOMPARE(buckets.size(), size_t(3));
+
+    QCOMPARE(buckets[0].startMs, startMs);
+    QCOMPARE(buckets[0].recipeId, 0);
+    QCOMPARE(buckets[0].totals.cups, quint64(2));
+    QCOMPARE(buckets[0].totals.beansGram, qint64(16));
+    QCOMPARE(buckets[0].totals.waterMl, qint64(80));
+
+    QCOMPARE(buckets[1].startMs, startMs);
+    QCOMPARE(buckets[1].recipeId, 1);
+    QCOMPARE(buckets[1].totals.milkMl, qint64(200));
+    QCOMPARE(buckets[1].totals.milkPrepMs, qint64(3500));
+
+    QCOMPARE(buckets[2].startMs, startMs + hourMs);
+    QCOMPARE(buckets[2].totals.cups, quint64(1));
+    QCOMPARE(buckets[2].totals.milkMl, qint64(150));
+}
+
+// -------------------------------------------------------------------------------------------------
+void ConsumptionLogTest::fullBlocksAreWrittenOnTheirOwn()
+{
+    std::vector<ConsumptionRow> rows;
+    for (int i = 0; i < ConsumptionLog::blockRows * 2 + 10; ++i) rows.push_back(row(startMs + i * 1000, i % 2, 0));
+    const auto fileName = writeLog(rows);
+    QVERIFY(!fileName.isEmpty());
+
+    ConsumptionLogReader reader;
+    QVERIFY(reader.open(fileName));
+    QCOMPARE(reader.rowCount(), quint64(rows.size()));
+
+    // Only the rows of the range are visited, from the last block only
+    qint64 firstMs = 0;
+    int visited = 0;
+    reader.scan(rows.back().timestampMs - 5000, rows.back().timestampMs + 1, [&](const ConsumptionRow& row) {
+        if (visited++ == 0) firstMs = row.timestampMs;
+    });
+    QCOMPARE(visited, 6);
+    QCOMPARE(firstMs, rows.back().timestampMs - 5000);
+}
+
+// -------------------------------------------------------------------------------------------------
+void ConsumptionLogTest::reopenContinuesTheDictionary()
+{
+    const auto fileName = writeLog({row(startMs, 1, 200)});
+    QVERIFY(!fileName.isEmpty());
+    {
+        ConsumptionLog log;
+        QVERIFY2(log.open(fileName), qPrintable(log.errorString()));
+        QCOMPARE(log.recipeId("latte macchiato"), 1);
+        QCOMPARE(log.recipeId("cappuccino"), 2);
+        log.append(row(startMs + 1000, 2, 100));
+    }
+
+    ConsumptionLogReader reader;
+    QVERIFY(reader.open(fileName));
+    QCOMPARE(reader.recipes(), QStringList({"espresso", "latte macchiato", "cappuccino"}));
+    QCOMPARE(reader.rowCount(), quint64(2));
+}
+
+// -------------------------------------------------------------------------------------------------
+void ConsumptionLogTest::truncatedBlockEndsTheLog()
+{
+    const auto fileName = writeLog({row(startMs, 0, 0), row(startMs + 1000, 1, 200)});
+    QVERIFY(!fileName.isEmpty());
+    {
+        ConsumptionLog log;
+        QVERIFY(log.open(fileName));
+        log.append(row(startMs + 2000, 0, 0));
+    }
+    ConsumptionLogReader intact;
+    QVERIFY(intact.open(fileName));
+    QCOMPARE(intact.rowCount(), quint64(3));
+
+    // A crash in the middle of writing the second block
+    const auto size = QFileInfo(fileName).size();
+    QVERIFY(QFile::resize(fileName, size - 3));
+
+    ConsumptionLogReader reader;
+    QVERIFY2(reader.open(fileName), qPrintable(reader.errorString()));
+    QCOMPARE(reader.rowCount(), quint64(2));
+    QVERIFY(reader.validBytes() < size - 3);
+
+    // Appending starts after the intact part
+    {
+        ConsumptionLog log;
+        QVERIFY(log.open(fileName));
+        log.append(row(startMs + 3000, 0, 0));
+    }
+    QVERIFY(reader.open(fileName));
+    QCOMPARE(reader.rowCount(), quint64(3));
+}
+
+// -------------------------------------------------------------------------------------------------
+void ConsumptionLogTest::corruptBlockHeadersAreRejected_data()
+{
+    QTest::addColumn<int>("offset");
+    QTest::addColumn<qint64>("value");
+    QTest::addColumn<int>("bytes");
+
+    QTest::newRow("no rows") << firstBlockRows << qint64(0) << 4;
+    QTest::newRow("too many rows") << firstBlockRows << qint64(ConsumptionLog::blockRows + 1) << 4;
+    QTest::newRow("min after max") << firstBlockMinMs << qint64(startMs + hourMs) << 8;
+    QTest::newRow("max before min") << firstBlockMaxMs << qint64(startMs - 1) << 8;
+}
+
+// -------------------------------------------------------------------------------------------------
+void ConsumptionLogTest::corruptBlockHeadersAreRejected()
+{
+    QFETCH(int, offset);
+    QFETCH(qint64, value);
+    QFETCH(int, bytes);
+
+    const auto fileName = writeLog({row(startMs, 0, 0), row(startMs + 1000, 0, 0)}, false);
+    QVERIFY(!fileName.isEmpty());
+    QVERIFY(ConsumptionLogReader().open(fileName));
+
+    QVERIFY(bytes == 4 ? patch(fileName, offset, quint32(value)) : patch(fileName, offset, value));
+    ConsumptionLogReader reader;
+    QVERIFY(!reader.open(fileName));
+    QVERIFY(reader.errorString().contains("Corrupt block"));
+}
+
+QTEST_GUILESS_MAIN(ConsumptionLogTest)
+#include "consumption_log_test.moc"
@@ -0,0 +1,143 @@
+// Bio-Hybrid Coffee Machine Example - Copyright (c) 2021 Bio-Hybrid GmbH
+#include "machine_dispatcher.h"
+
+#include <coffeemaker/benchsupport.h>
+
+#include <QtTest>
+
+// -------------------------------------------------------------------------------------------------
+namespace {
+    Recipe espresso()
+    {
+        Recipe recipe;
+        recipe.name = "espresso";
+        recipe.beansGram = 8;
+        recipe.grindLevel = "fine";
+        recipe.waterMl = 40;
+        recipe.waterTemp = 92;
+        return recipe;
+    }
+
+    /// Full containers and empty bins of a `model` machine
+    CoffeeMaker::Levels fullLevels(HardwareModel model)
+    {
+        return std::visit([](auto profile) {
+            using Profile = decltype(profile);
+            CoffeeMaker::Levels levels;
+            levels.beans = Profile::beansMax;
+            levels.water = Profile::waterMax;
+            levels.milk = Profile::milkMax;
+            return levels;
+        }, hardwareProfile(model));
+    }
+
+    CoffeeMaker* addMachine(MachineDispatcher& dispatcher, HardwareModel model, const CoffeeMaker::Levels& levels)
+    {
+        const auto maker = new CoffeeMaker(model, levels);
+        maker->setMachineId(dispatcher.machineCount() + 1);
+        maker->setTimeScale(0.001);
+        dispatcher.addMachine(maker);
+        return maker;
+    }
+
+    bool allOff(const MachineDispatcher& dispatcher)
+    {
+        for (int i = 0; i < dispatcher.machineCount(); ++i) {
+            if (dispatcher.machine(i)->currentState() != CoffeeMaker::State::Off) return false;
+        }
+        return true;
+    }
+}
+
+/// Routing of the dispatcher over its heap of machines
+class MachineDispatcherTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void withoutMachines();
+    void routesToTheFastestModel();
+    void avoidsMachinesThatRunOut();
+    void findsTheOnlyGoodMachineInALargeBank();
+    void roundRobin();
+
+private:
+    const SettingsSandbox settingsSandbox_;
+};
+
+// -------------------------------------------------------------------------------------------------
+void MachineDispatcherTest::withoutMachines()
+{
+    MachineDispatcher dispatcher;
+    QCOMPARE(dispatcher.route(espresso()), -1);
+    QCOMPARE(dispatcher.dispatch(espresso()), quint64(0));
+}
+
+// -------------------------------------------------------------------------------------------------
+void MachineDispatcherTest::routesToTheFastestModel()
+{
+    MachineDispatcher dispatcher;
+    for (const auto model : {HardwareModel::Standard, HardwareModel::Compact, HardwareModel::Cafe}) {
+        addMachine(dispatcher, model, fullLevels(model));
+    }
+    QTRY_VERIFY(allOff(dispatcher));
+
+    // All turned off: the café machine has the shortest self-check and brew step
+    QCOMPARE(dispatcher.route(espresso()), 2);
+}
+
+// -------------------------------------------------------------------------------------------------
+void MachineDispatcherTest::avoidsMachinesThatRunOut()
+{
+    MachineDispatcher dispatcher;
+    auto dry = fullLevels(HardwareModel::Standard);
+    dry.water = 10;
+    addMachine(dispatcher, HardwareModel::Standard, dry);
+    auto binAlmostFull = fullLevels(HardwareModel::Standard);
+    binAlmostFull.restBin = StandardProfile::restBinMax - espresso().beansGram;
+    addMachine(dispatcher, HardwareModel::Standard, binAlmostFull);
+    addMachine(dispatcher, HardwareModel::Standard, fullLevels(HardwareModel::Standard));
+    QTRY_VERIFY(allOff(dispatcher));
+
+    // The first needs a refill, the grounds of the order fill the bin of the second
+    QCOMPARE(dispatcher.route(espresso()), 2);
+}
+
+// -------------------------------------------------------------------------------------------------
+void MachineDispatcherTest::findsTheOnlyGoodMachineInALargeBank()
+{
+    MachineDispatcher dispatcher;
+    constexpr int machines = 31;
+    constexpr int good = 23;
+    for (int i = 0; i < machines; ++i) {
+        auto levels = fullLevels(HardwareModel::Standard);
+        if (i != good) levels.beans = 0;
+        addMachine(dispatcher, HardwareModel::Standard, levels);
+    }
+    QTRY_VERIFY(allOff(dispatcher));
+
+    // All are done at the same time, the stalls of the others only show in their costs
+    QCOMPARE(dispatcher.route(espresso()), good);
+}
+
+// -------------------------------------------------------------------------------------------------
+void MachineDispatcherTest::roundRobin()
+{
+    MachineDispatcher dispatcher(MachineDispatcher::Routing::RoundRobin);
+    addMachine(dispatcher, HardwareModel::Standard, fullLevels(HardwareModel::Standard));
+    addMachine(dispatcher, HardwareModel::Cafe, fullLevels(HardwareModel::Cafe));
+    QTRY_VERIFY(allOff(dispatcher));
+
+    QCOMPARE(dispatcher.route(espresso()), 0);
+    QVERIFY(dispatcher.dispatch(espresso()) != 0);
+    QCOMPARE(dispatcher.route(espresso()), 1);
+    QVERIFY(dispatcher.dispatch(espresso()) != 0);
+    QCOMPARE(dispatcher.route(espresso()), 0);
+
+    // Both were turned on for their orders
+    QVERIFY(dispatcher.expectedDoneMs(0) > dispatcher.nowMs());
+    QVERIFY(dispatcher.expectedDoneMs(1) > dispatcher.nowMs());
+}
+
+QTEST_GUILESS_MAIN(MachineDispatcherTest)
+#include "machine_dispatcher_test.moc"
@@ -0,0 +1,144 @@
+// Bio-Hybrid Coffee Machine Example - Copyright (c) 2021 Bio-Hybrid GmbH
+#include "order_queue.h"
+
+#include <QRandomGenerator>
+#include <QtTest>
+
+// -------------------------------------------------------------------------------------------------
+namespace {
+    Recipe recipe(const QString& name, int milkMl = 0)
+    {
+        Recipe recipe;
+        recipe.name = name;
+        recipe.beansGram = 8;
+        recipe.waterMl = 40;
+        recipe.hasMilk = milkMl > 0;
+        recipe.milkMl = milkMl;
+        return recipe;
+    }
+
+    Order order(quint64 id, double arrivalMs, double estimateMs)
+    {
+        Order order;
+        order.id = id;
+        order.recipe = recipe(QString("order %1").arg(id));
+        order.arrivalMs = arrivalMs;
+        order.estimateMs = estimateMs;
+        return order;
+    }
+
+    std::vector<quint64> popAll(OrderScheduler& scheduler)
+    {
+        std::vector<quint64> ids;
+        while (!scheduler.isEmpty()) ids.push_back(scheduler.pop().id);
+        return ids;
+    }
+}
+
+/// The stage time estimates and the scheduling policies of the order queue
+class OrderQueueTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void nominalStageTimesPerModel();
+    void measurementsMoveTheEstimate();
+    void fifoKeepsArrivalOrder();
+    void shortestJobFirst();
+    void agingLetsLongOrdersAhead();
+    void heapPopsInKeyOrder();
+};
+
+// -------------------------------------------------------------------------------------------------
+void OrderQueueTest::nominalStageTimesPerModel()
+{
+    const StageTimes standard(HardwareModel::Standard);
+    const StageTimes cafe(HardwareModel::Cafe);
+    QCOMPARE(standard.stageMs(StageTimes::Brew), double(StandardProfile::brewStepMs));
+    QCOMPARE(standard.stageMs(StageTimes::Milk), double(StandardProfile::milkStepMs));
+    QCOMPARE(cafe.stageMs(StageTimes::Brew), double(CafeProfile::brewStepMs));
+    QCOMPARE(standard.stageMs(StageTimes::Grind), double(StandardProfile::grindStepMs));
+    QCOMPARE(cafe.stageMs(StageTimes::Start), double(CafeProfile::startStepMs));
+    QCOMPARE(cafe.stageMs(StageTimes::Finish), double(CafeProfile::finishStepMs));
+
+    const auto steps = double(CafeProfile::startStepMs + CafeProfile::grindStepMs + CafeProfile::brewStepMs
+                              + CafeProfile::finishStepMs);
+    QCOMPARE(cafe.estimateMs(recipe("espresso")), steps);
+    QCOMPARE(cafe.estimateMs(recipe("latte", 150)), steps + CafeProfile::milkStepMs);
+    QVERIFY(cafe.estimateMs(recipe("latte", 150)) < standard.estimateMs(recipe("latte", 150)));
+}
+
+// -------------------------------------------------------------------------------------------------
+void OrderQueueTest::measurementsMoveTheEstimate()
+{
+    StageTimes times(HardwareModel::Standard);
+    const auto before = times.stageMs(StageTimes::Brew);
+    times.record(StageTimes::Brew, before + 1000);
+    const auto after = times.stageMs(StageTimes::Brew);
+    QVERIFY(after > before);
+    QVERIFY(after < before + 1000);
+
+    // Converges on a steady measurement, the other stages stay
+    for (int i = 0; i < 100; ++i) times.record(StageTimes::Brew, 5000);
+    QVERIFY(qAbs(times.stageMs(StageTimes::Brew) - 5000) < 1);
+    QCOMPARE(times.stageMs(StageTimes::Milk), double(StandardProfile::milkStepMs));
+}
+
+// -------------------------------------------------------------------------------------------------
+void OrderQueueTest::fifoKeepsArrivalOrder()
+{
+    OrderScheduler scheduler(SchedulingPolicy::Fifo);
+    scheduler.push(order(1, 0, 9000));
+    scheduler.push(order(2, 10, 1000));
+    scheduler.push(order(3, 20, 5000));
+    QCOMPARE(scheduler.size(), 3);
+    QCOMPARE(popAll(scheduler), std::vector<quint64>({1, 2, 3}));
+}
+
+// -------------------------------------------------------------------------------------------------
+void OrderQueueTest::shortestJobFirst()
+{
+    OrderScheduler scheduler(SchedulingPolicy::ShortestJobFirst);
+    scheduler.push(order(1, 0, 9000));
+    scheduler.push(order(2, 10, 1000));
+    scheduler.push(order(3, 20, 5000));
+    scheduler.push(order(4, 30, 1000));
+    // Equal estimates keep their arrival order
+    QCOMPARE(popAll(scheduler), std::vector<quint64>({2, 4, 3, 1}));
+}
+
+// -------------------------------------------------------------------------------------------------
+void OrderQueueTest::agingLetsLongOrdersAhead()
+{
+    // The long order waited 30 s, worth 15 s at a rate of 0.5, more than the 9 s it is longer
+    OrderScheduler aging(SchedulingPolicy::AgingShortestJobFirst, 0.5);
+    aging.push(order(1, 0, 10000));
+    aging.push(order(2, 30000, 1000));
+    QCOMPARE(popAll(aging), std::vector<quint64>({1, 2}));
+
+    OrderScheduler shortest(SchedulingPolicy::ShortestJobFirst);
+    shortest.push(order(1, 0, 10000));
+    shortest.push(order(2, 30000, 1000));
+    QCOMPARE(popAll(shortest), std::vector<quint64>({2, 1}));
+}
+
+// -------------------------------------------------------------------------------------------------
+void OrderQueueTest::heapPopsInKeyOrder()
+{
+    QRandomGenerator random(42);
+    OrderScheduler scheduler(SchedulingPolicy::ShortestJobFirst);
+    for (quint64 id = 1; id <= 500; ++id) {
+        scheduler.push(order(id, double(id), double(random.bounded(20)) * 500));
+    }
+
+    auto previous = scheduler.pop();
+    while (!scheduler.isEmpty()) {
+        const auto next = scheduler.pop();
+        QVERIFY(next.estimateMs >= previous.estimateMs);
+        if (next.estimateMs == previous.estimateMs) QVERIFY(next.id > previous.id);
+        previous = next;
+    }
+}
+
+QTEST_GUILESS_MAIN(OrderQueueTest)
+#include "order_queue_test.moc"
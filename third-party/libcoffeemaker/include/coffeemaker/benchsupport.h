@@ -0,0 +1,44 @@
+// Bio-Hybrid Coffee Machine Example - Copyright (c) 2021 Bio-Hybrid GmbH
+#pragma once
+
+#include <QSettings>
+#include <QTemporaryDir>
+
+#include <algorithm>
+#include <vector>
+
+/// Redirects the user settings of the process to an empty temporary directory while it lives.
+///
+/// Machines persist their levels and snapshots, so benchmarks and simulations create one before
+/// their first machine to start from the same state on every run, away from the real machine's
+/// settings.
+class SettingsSandbox
+{
+public:
+    SettingsSandbox()
+    {
+        QSettings::setPath(QSettings::NativeFormat, QSettings::UserScope, dir_.path());
+        QSettings::setPath(QSettings::IniFormat, QSettings::UserScope, dir_.path());
+    }
+
+    QString path() const { return dir_.path(); }
+
+private:
+    QTemporaryDir dir_;
+};
+
+/// Returns the nearest-rank `p`th percentile (0 to 100) of `values`, 0 if empty
+inline double percentile(std::vector<double> values, double p)
+{
+    if (values.empty()) return 0;
+    std::sort(values.begin(), values.end());
+    return values[std::min(values.size() - 1, size_t(p / 100.0 * double(values.size() - 1) + 0.5))];
+}
+
+/// Returns the mean of `values`, 0 if empty
+inline double mean(const std::vector<double>& values)
+{
+    double sum = 0;
+    for (const auto v : values) sum += v;
+    return values.empty() ? 0 : sum / double(values.size());
+}
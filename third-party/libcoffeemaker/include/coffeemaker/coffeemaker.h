@@ -1,14 +1,21 @@
 // Bio-Hybrid Coffee Machine Example - Copyright (c) 2021 Bio-Hybrid GmbH
 #pragma once
 
+#include "coffeemakermetrics.h"
+#include "hardwareprofile.h"
+#include "thermalmodel.h"
+
+#include <QElapsedTimer>
 #include <QObject>
 #include <QString>
 
 #include <memory>
+#include <vector>
 
 class QSettings;
 class QState;
 class QStateMachine;
+class QTimer;
 
 class CoffeeMaker : public QObject
 {
@@ -53,8 +60,129 @@ public:
         bool foam = false;
     };
 
+    /// Container levels and cups processed, as persisted in the machine settings
+    struct Levels {
+        int beans = 0;
+        int water = 0;
+        int milk = 0;
+        int restBin = 0;
+        int overflow = 0;
+        int cupsProcessed = 0;
+    };
+
+    /// Everything needed to resume the machine where it stopped
+    struct Snapshot {
+        Levels levels;                  ///< current levels
+        Levels checkedLevels;           ///< levels the saved state was valid for
+        State state = State::Off;       ///< Off for a cold start
+        bool cupDetected = false;
+        int coffeeGroundGram = 0;       ///< ground coffee still in the chamber
+        GrindOptions grindOptions;
+        WaterOptions waterOptions;
+        MilkOptions milkOptions;
+        HardwareModel model = HardwareModel::Standard; ///< installed hardware, not part of the state
+        qint64 restoreNs = 0;           ///< time taken by loadSnapshot()
+    };
+
+    /// Resumes the machine from the last snapshot, or starts it turned off with the levels of the
+    /// last run (random levels on first use)
     explicit CoffeeMaker(QObject* parent = nullptr);
 
+    /// Creates the machine turned off with the given levels, without reading the settings
+    explicit CoffeeMaker(const Levels& levels, QObject* parent = nullptr);
+
+    /// Creates a machine of `model` turned off with the given levels, without reading the settings
+    CoffeeMaker(HardwareModel model, const Levels& levels, QObject* parent = nullptr);
+
+    /// Resumes the machine in the snapshot's state, skipping the power-on self-check.
+    /// Only the levels that differ from `checkedLevels` are checked again.
+    explicit CoffeeMaker(const Snapshot& snapshot, QObject* parent = nullptr);
+
+    /// Saves the snapshot
+    ~CoffeeMaker() override;
+
+    /// Reads the persisted levels, thread-safe so it can run on a worker thread
+    static Levels loadLevels(int machineId = 0);
+
+    /// Reads the installed hardware model, the "hardwareModel" setting, standard if unset
+    static HardwareModel loadHardwareModel(int machineId = 0);
+
+    /// Reads and validates the last snapshot, thread-safe. Falls back to a cold start with
+    /// loadLevels() if there is none or it does not match this version of the machine.
+    static Snapshot loadSnapshot(int machineId = 0);
+
+    /// Persists the machine under `machineId`, to run several machines side by side.
+    /// Call it before the event loop runs, the first write happens on entering the first state.
+    void setMachineId(int machineId);
+    int machineId() const { return machineId_; }
+
+    /// Returns the hardware model, its profile sets the capacities and the step timings
+    HardwareModel hardwareModel() const;
+
+    /// Returns the current snapshot, which is also saved on every state change
+    Snapshot snapshot() const;
+
+    /// Allocations of state machine events on a thread
+    struct EventAllocations {
+        quint64 heap = 0;   ///< allocated from the heap, while the thread's pool was empty
+        quint64 pooled = 0; ///< reused from the pool
+    };
+
+    /// Returns the event allocations of the machines on the calling thread
+    static EventAllocations eventAllocations();
+
+    /// Scales the durations of the timed steps (self-check, grinding, brewing, milk) and the heating,
+    /// e.g. 0.001 to run a day of machine time in about a minute
+    void setTimeScale(double scale);
+
+    /// A cup dispensed in command mode, from starting to finishing or cancelling it
+    struct Cup {
+        QString recipe;             ///< as given to setRecipeName()
+        qint64 finishedMs = 0;      ///< ms since the epoch
+        int beansGram = 0;
+        int waterMl = 0;
+        int milkMl = 0;
+        int grindMs = 0;            ///< stage durations in machine time
+        int brewMs = 0;
+        int milkPrepMs = 0;
+    };
+
+    /// Temperatures, and what the predictive preheat of the boiler saved and cost
+    struct ThermalReport {
+        double boilerC = 0;
+        double milkHeaterC = 0;
+        bool preheating = false;        ///< boiler kept warm in stand by
+        double orderProbability = 0;    ///< forecast of an order within the preheat horizon
+        double heatUpWaitMs = 0;        ///< brewing and milk steps waited for the heaters
+        double latencySavedMs = 0;      ///< boiler wait avoided, compared to heating on demand only
+        double energyJ = 0;             ///< boiler and milk heater
+        double preheatEnergyJ = 0;      ///< extra boiler energy, compared to heating on demand only
+    };
+
+    /// Returns the thermal state as of now (machine time)
+    ThermalReport thermalReport() const;
+
+    /// Replaces the forecast of the predictive preheat, e.g. a threshold above 1 disables it
+    void setPreheatParameters(const PreheatForecast::Parameters& parameters);
+
+    /// Level changes of a service visit, applied together by applyMaintenance()
+    struct Maintenance {
+        int addBeansGram = 0;
+        int addWaterMl = 0;
+        int addMilkMl = 0;
+        bool emptyRestBin = false;
+        bool emptyOverflow = false;
+        bool clean = false;         ///< also resets the cups processed
+    };
+
+    /// Applies all changes of `maintenance` at once: one settings write, one levelsChanged()
+    /// instead of the signals of the single levels, and one self-check with the final levels, so no
+    /// state in between (e.g. BinFull while the bin is not emptied yet) is entered
+    void applyMaintenance(const Maintenance& maintenance);
+
+    /// Returns the current levels
+    Levels levels() const;
+
     /// Returns if the machine is powered
     Q_INVOKABLE bool isPoweredOn() const { return currentState() != State::Off && currentState() != State::Unknown; }
 
@@ -67,6 +195,9 @@ public:
     /// Start command mode
     Q_INVOKABLE void startCommandMode();
 
+    /// Names the recipe of the cup in command mode, for cupDispensed()
+    Q_INVOKABLE void setRecipeName(const QString& name);
+
     /// Cancel command mode, returns to stand by
     Q_INVOKABLE void cancelCommandMode();
 
@@ -151,6 +282,9 @@ public:
     /// Returns if a cup is detected in the output tray
     bool cupDetected() const;
 
+    /// Returns the machine's metrics, which may be read from any thread
+    std::shared_ptr<const CoffeeMakerMetrics> metrics() const { return metrics_; }
+
 signals:
     void cupDetectedChanged(bool cupInTray);
     void milkContainerLevelChanged(int milkMl);
@@ -162,6 +296,12 @@ signals:
 
     void currentStateChanged(State state);
 
+    /// All levels after applyMaintenance() changed at least one of them
+    void levelsChanged(const CoffeeMaker::Levels& levels);
+
+    /// A cup was finished or cancelled after something was dispensed
+    void cupDispensed(const CoffeeMaker::Cup& cup);
+
 private:
     void setBeansContainerLevel(int level);
     void setWaterContainerLevel(int level);
@@ -170,6 +310,16 @@ private:
     void setOverflowLevel(int level);
     void setCupsProcessed(int cups);
     void doSelfCheck();
+    void logLevels() const;
+    void updateLevelMetrics();
+    void saveSnapshot();
+    void incrementalSelfCheck();
+    double pendingMachineMs() const;
+    double advanceThermal();
+    void controlHeaters(State state);
+    double heatUp(HeaterModel& heater, double targetC, HeaterModel* onDemand = nullptr);
+    void updateThermalMetrics();
+    QSettings* settings();
 
     int getBeans(int amount);
     int getWater(int amount);
@@ -180,9 +330,14 @@ private:
     void addToCupsProcessed(int cups);
 
     void emptyCoffeeGrounds();
+    void timeStage(QState* state, int Cup::*durationMs);
+    void dispenseCup();
 
 private:
     QSettings* settings_ = nullptr;
+    int machineId_ = 0;
+    const HardwareProfile hardware_;
+    const std::shared_ptr<CoffeeMakerMetrics> metrics_;
     QStateMachine* stateMachine_ = nullptr;
 
     QState* stateOff_  = nullptr;
@@ -212,7 +367,37 @@ private:
     std::shared_ptr<MilkOptions> milkOptions_;
 
     int currentCoffeeGroundAmount_ = 0;
+
+    bool warmStarting_ = false; ///< until the restored state was entered
+    Levels checkedLevels_;
+
+    struct StepTimer {
+        QTimer* timer;
+        int durationMs;
+    };
+    std::vector<StepTimer> stepTimers_;   ///< single shot, scaled by setTimeScale()
+    QTimer* preheatTimer_ = nullptr;
+    double timeScale_ = 1.0;
+
+    // Heaters in machine time. The on-demand boiler follows the same orders without preheating,
+    // the difference of the two is what preheating saved and cost.
+    QElapsedTimer thermalClock_;
+    qint64 thermalNs_ = 0;
+    double machineMs_ = 0;
+    HeaterModel boiler_;
+    HeaterModel onDemandBoiler_;
+    HeaterModel milkHeater_;
+    PreheatForecast preheat_;
+    double keepWarmC_ = 92;         ///< temperature of the last brew
+    double brewHeatUpMs_ = 0;
+    double milkHeatUpMs_ = 0;
+    double heatUpWaitMs_ = 0;
+    double latencySavedMs_ = 0;
+
+    Cup cup_;                       ///< dispensed since command mode started
+    double stageStartedMs_ = 0;
 };
 
 Q_DECLARE_METATYPE(CoffeeMaker::State)
+Q_DECLARE_METATYPE(CoffeeMaker::Cup)
 Q_DECLARE_METATYPE(CoffeeMaker::GrindLevel)
\ No newline at end of file
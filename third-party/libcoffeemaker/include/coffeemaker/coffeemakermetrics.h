@@ -0,0 +1,41 @@
+// Bio-Hybrid Coffee Machine Example - Copyright (c) 2021 Bio-Hybrid GmbH
+#pragma once
+
+#include <QtGlobal>
+
+#include <array>
+#include <atomic>
+
+/// Counters and gauges of a CoffeeMaker.
+///
+/// Written by the machine's thread with relaxed atomics, readable from any thread without
+/// locking, e.g. by a metrics exporter.
+struct CoffeeMakerMetrics
+{
+    /// Number of CoffeeMaker::State values, including Unknown
+    static constexpr int stateCount = 14;
+
+    std::atomic<quint64> cupsMadeTotal {0};               ///< counter of finished cups, not reset by cleaning
+    std::array<std::atomic<quint64>, stateCount> stateEntries {}; ///< counters per state
+    std::atomic<qint32> state {stateCount - 1};           ///< current CoffeeMaker::State
+
+    std::atomic<qint32> waterMl {0};
+    std::atomic<qint32> milkMl {0};
+    std::atomic<qint32> beansGram {0};
+    std::atomic<qint32> restBinLevel {0};
+    std::atomic<qint32> overflowLevel {0};
+    std::atomic<qint32> cupsProcessed {0};                ///< since the last cleaning
+
+    std::atomic<qint32> warmStarted {0};                  ///< 1 if resumed from a snapshot
+    std::atomic<quint64> snapshotsSaved {0};              ///< counter
+    std::atomic<qint64> snapshotSaveNs {0};               ///< duration of the last save
+    std::atomic<qint64> snapshotRestoreNs {0};            ///< duration of loading the snapshot
+
+    std::atomic<qint32> boilerMilliC {0};                 ///< boiler temperature in m°C
+    std::atomic<qint32> milkHeaterMilliC {0};
+    std::atomic<qint32> preheating {0};                   ///< 1 while the boiler is kept warm
+    std::atomic<qint64> heatUpWaitMs {0};                 ///< counter, steps waiting for the heaters
+    std::atomic<qint64> preheatSavedMs {0};               ///< counter, boiler wait avoided by preheating
+    std::atomic<qint64> heaterEnergyJ {0};                ///< counter
+    std::atomic<qint64> preheatEnergyJ {0};               ///< counter, extra boiler energy of preheating
+};
@@ -0,0 +1,119 @@
+// Bio-Hybrid Coffee Machine Example - Copyright (c) 2021 Bio-Hybrid GmbH
+#pragma once
+
+#include "coffeemaker.h"
+
+#include <QObject>
+#include <QString>
+
+#include <atomic>
+
+/// Fixed layout of the telemetry shared-memory segment, version 1.
+///
+/// The header is written once before `magic` is published. The payload is guarded by a seqlock:
+/// `sequence` is odd while the machine writes, so a reader retries when it changed or was odd.
+/// Fields are only ever appended; readers accept any `size` of at least their own record.
+struct CoffeeMakerTelemetryRecord
+{
+    static constexpr quint32 magicValue = 0x4C544D43; ///< "CMTL"
+    static constexpr quint32 currentVersion = 1;
+
+    std::atomic<quint32> magic;
+    quint32 version;
+    quint32 size;
+    qint32 pid;         ///< process id of the machine
+
+    std::atomic<quint32> sequence;
+    std::atomic<qint32> state;      ///< CoffeeMaker::State
+    std::atomic<qint32> cupDetected;
+    std::atomic<qint32> water;
+    std::atomic<qint32> milk;
+    std::atomic<qint32> beans;
+    std::atomic<qint32> restBin;
+    std::atomic<qint32> overflow;
+    std::atomic<qint32> cupsProcessed;
+    std::atomic<qint32> waterMax;
+    std::atomic<qint32> milkMax;
+    std::atomic<qint32> beansMax;
+    std::atomic<qint32> restBinMax;
+    std::atomic<qint32> overflowMax;
+    std::atomic<qint32> cupsUntilCleaning;
+    std::atomic<quint64> cupsMadeTotal;
+    std::atomic<qint64> updatedNs;  ///< CLOCK_MONOTONIC of the last update
+};
+
+/// Publishes the state and levels of a CoffeeMaker into a POSIX shared-memory segment.
+///
+/// Created on the machine's thread, every change of the machine rewrites the record. Other
+/// processes map the segment with CoffeeMakerTelemetryReader and read it without syscalls.
+class CoffeeMakerTelemetry : public QObject
+{
+    Q_OBJECT
+
+public:
+    /// Name of the segment if none is given
+    static const char* const defaultName;
+
+    /// A consistent copy of the record
+    struct Sample {
+        quint32 sequence = 0;
+        qint32 pid = 0;
+        CoffeeMaker::State state = CoffeeMaker::State::Unknown;
+        bool cupDetected = false;
+        CoffeeMaker::Levels levels;
+        CoffeeMaker::Levels maxima; ///< cupsProcessed holds the cups until cleaning is required
+        quint64 cupsMadeTotal = 0;
+        qint64 updatedNs = 0;
+    };
+
+    /// Publishes `maker` as a child of it, call open() to create the segment
+    explicit CoffeeMakerTelemetry(CoffeeMaker* maker, const QString& name = QString(defaultName));
+    ~CoffeeMakerTelemetry() override;
+
+    /// Creates (or takes over) the segment and publishes the current state, false on error
+    bool open();
+
+    /// Returns the POSIX name of the segment, always starting with a slash
+    QString name() const { return name_; }
+
+    /// Returns the monotonic clock the records are stamped with, in ns
+    static qint64 monotonicNs();
+
+private:
+    void publish();
+
+private:
+    CoffeeMaker* maker_;
+    QString name_;
+    CoffeeMakerTelemetryRecord* record_ = nullptr;
+};
+
+/// Maps a telemetry segment read-only and takes consistent samples of it.
+class CoffeeMakerTelemetryReader
+{
+public:
+    CoffeeMakerTelemetryReader() = default;
+    ~CoffeeMakerTelemetryReader();
+    CoffeeMakerTelemetryReader(const CoffeeMakerTelemetryReader&) = delete;
+    CoffeeMakerTelemetryReader& operator=(const CoffeeMakerTelemetryReader&) = delete;
+
+    /// Maps the segment, false if it does not exist or has an unknown layout
+    bool open(const QString& name = QString(CoffeeMakerTelemetry::defaultName));
+
+    /// Returns the last error of open()
+    QString errorString() const { return error_; }
+
+    /// Returns the sequence number, which changes with every update
+    quint32 sequence() const;
+
+    /// Takes a consistent sample, false if the writer did not finish within `maxRetries`
+    bool read(CoffeeMakerTelemetry::Sample& sample, int maxRetries = 1000) const;
+
+    /// Returns the number of reads retried because of a concurrent write
+    quint64 retries() const { return retries_; }
+
+private:
+    const CoffeeMakerTelemetryRecord* record_ = nullptr;
+    QString error_;
+    mutable quint64 retries_ = 0;
+};
@@ -0,0 +1,140 @@
+// Bio-Hybrid Coffee Machine Example - Copyright (c) 2021 Bio-Hybrid GmbH
+#pragma once
+
+#include "coffeemaker.h"
+
+#include <QFile>
+#include <QHash>
+#include <QObject>
+#include <QStringList>
+
+#include <array>
+#include <functional>
+#include <vector>
+
+class QTimer;
+
+/// One dispensed cup of the consumption log
+struct ConsumptionRow
+{
+    qint64 timestampMs = 0;     ///< ms since the epoch
+    qint32 recipeId = 0;        ///< index into the log's recipe names
+    qint32 beansGram = 0;
+    qint32 waterMl = 0;
+    qint32 milkMl = 0;
+    qint32 grindMs = 0;
+    qint32 brewMs = 0;
+    qint32 milkPrepMs = 0;
+};
+
+/// Appends dispensed cups to a columnar, compressed log file.
+///
+/// Rows are collected in blocks of up to `blockRows`. Every column of a block is stored as the
+/// zigzag varint of the difference to the previous value, so increasing timestamps and repeating
+/// recipes and amounts take one or two bytes. A block header has the row count, the time range
+/// and the column sizes, so readers skip blocks and columns without decoding them. Recipe names
+/// are stored once, in dictionary entries between the blocks. A block is written when it is full,
+/// on flush(), and at the latest ten minutes after its first row.
+class ConsumptionLog : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int blockRows = 4096;
+
+    explicit ConsumptionLog(QObject* parent = nullptr);
+    ~ConsumptionLog() override;
+
+    /// Opens or creates the log for appending, false on error or an unknown format
+    bool open(const QString& fileName);
+
+    /// Returns the last error of open() or a write
+    QString errorString() const { return error_; }
+
+    /// Returns the id of `recipe`, adding it to the dictionary if it is new
+    qint32 recipeId(const QString& recipe);
+
+    void append(const ConsumptionRow& row);
+
+    /// Logs a cup of CoffeeMaker::cupDispensed
+    void record(const CoffeeMaker::Cup& cup);
+
+    /// Writes the collected rows as a block
+    bool flush();
+
+private:
+    bool write(const QByteArray& bytes);
+
+private:
+    QFile file_;
+    QString error_;
+    QHash<QString, qint32> recipeIds_;
+    QByteArray pendingDictionary_;
+    std::array<QByteArray, 8> columns_;
+    std::array<qint64, 8> previous_ {};
+    int rows_ = 0;
+    qint64 minMs_ = 0;
+    qint64 maxMs_ = 0;
+    QTimer* flushTimer_ = nullptr;
+};
+
+/// Reads a consumption log block by block and aggregates it, without loading the whole file.
+class ConsumptionLogReader
+{
+public:
+    struct Totals {
+        quint64 cups = 0;
+        qint64 beansGram = 0;
+        qint64 waterMl = 0;
+        qint64 milkMl = 0;
+        qint64 grindMs = 0;
+        qint64 brewMs = 0;
+        qint64 milkPrepMs = 0;
+    };
+
+    struct Bucket {
+        qint64 startMs = 0;
+        qint32 recipeId = 0;
+        Totals totals;
+    };
+
+    /// Indexes the blocks and reads the recipe names, false on error or an unknown format.
+    /// A block cut short by a crash ends the log.
+    bool open(const QString& fileName);
+
+    QString errorString() const { return error_; }
+
+    /// Returns the recipe names by id
+    const QStringList& recipes() const { return recipes_; }
+
+    quint64 rowCount() const { return rowCount_; }
+
+    /// Returns the size of the intact part of the file
+    qint64 validBytes() const { return validBytes_; }
+
+    /// Returns the sums of the rows in [fromMs, toMs) per bucket of `bucketMs` and recipe, ordered
+    /// by start and recipe. Blocks outside the range are skipped unread.
+    std::vector<Bucket> aggregate(qint64 fromMs, qint64 toMs, qint64 bucketMs = 3600 * 1000) const;
+
+    /// Calls `visit` for every row in [fromMs, toMs)
+    void scan(qint64 fromMs, qint64 toMs, const std::function<void(const ConsumptionRow&)>& visit) const;
+
+private:
+    struct Block {
+        qint64 offset;      ///< of the first column
+        quint32 rows;
+        qint64 minMs;
+        qint64 maxMs;
+        std::array<quint32, 8> sizes;
+    };
+
+    template <typename Visit>
+    void forEachBlock(qint64 fromMs, qint64 toMs, Visit visit) const;
+
+    QString fileName_;
+    QString error_;
+    QStringList recipes_;
+    std::vector<Block> blocks_;
+    quint64 rowCount_ = 0;
+    qint64 validBytes_ = 0;
+};
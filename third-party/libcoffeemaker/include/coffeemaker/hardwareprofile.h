@@ -0,0 +1,89 @@
+// Bio-Hybrid Coffee Machine Example - Copyright (c) 2021 Bio-Hybrid GmbH
+#pragma once
+
+#include <QString>
+
+#include <variant>
+
+/// The hardware models the machine is sold as, in the order of HardwareProfile
+enum class HardwareModel {
+    Standard,
+    Compact,
+    Cafe,
+};
+
+/// The counter-top machine, the original hardware
+struct StandardProfile
+{
+    static constexpr HardwareModel model = HardwareModel::Standard;
+
+    static constexpr int milkMax = 750;             ///< ml
+    static constexpr int waterMax = 1150;           ///< ml
+    static constexpr int beansMax = 550;            ///< gram
+    static constexpr int overflowMax = 700;
+    static constexpr int restBinMax = 600;
+    static constexpr int maxCupsUntilCleanReq = 25;
+
+    static constexpr int selfCheckMs = 1234;
+    static constexpr int startStepMs = 50;          ///< entering command mode, not timed
+    static constexpr int grindStepMs = 2500;
+    static constexpr int brewStepMs = 3003;
+    static constexpr int milkStepMs = 3500;
+    static constexpr int finishStepMs = 50;         ///< dispensing the cup, not timed
+};
+
+/// The narrow home machine: small containers and a slower pump
+struct CompactProfile
+{
+    static constexpr HardwareModel model = HardwareModel::Compact;
+
+    static constexpr int milkMax = 400;
+    static constexpr int waterMax = 800;
+    static constexpr int beansMax = 250;
+    static constexpr int overflowMax = 400;
+    static constexpr int restBinMax = 300;
+    static constexpr int maxCupsUntilCleanReq = 12;
+
+    static constexpr int selfCheckMs = 1234;
+    static constexpr int startStepMs = 50;
+    static constexpr int grindStepMs = 2500;
+    static constexpr int brewStepMs = 3600;
+    static constexpr int milkStepMs = 4200;
+    static constexpr int finishStepMs = 50;
+};
+
+/// The café machine: plumbed-in sized containers, a second pump and a stronger milk heater
+struct CafeProfile
+{
+    static constexpr HardwareModel model = HardwareModel::Cafe;
+
+    static constexpr int milkMax = 2000;
+    static constexpr int waterMax = 4000;
+    static constexpr int beansMax = 1200;
+    static constexpr int overflowMax = 1800;
+    static constexpr int restBinMax = 1500;
+    static constexpr int maxCupsUntilCleanReq = 80;
+
+    static constexpr int selfCheckMs = 800;
+    static constexpr int startStepMs = 50;
+    static constexpr int grindStepMs = 2500;
+    static constexpr int brewStepMs = 2400;
+    static constexpr int milkStepMs = 2600;
+    static constexpr int finishStepMs = 50;
+};
+
+/// The profile of a machine chosen at runtime. The machine dispatches every operation once with
+/// std::visit, the checks within are instantiated per profile with the limits as constants.
+using HardwareProfile = std::variant<StandardProfile, CompactProfile, CafeProfile>;
+
+/// Returns the profile of `model`
+HardwareProfile hardwareProfile(HardwareModel model);
+
+/// Returns the model of `profile`
+HardwareModel hardwareModel(const HardwareProfile& profile);
+
+/// Returns the name of `model` as in the settings and on the command line, e.g. "compact"
+QString hardwareModelName(HardwareModel model);
+
+/// Parses a model name, case-insensitive. Returns false for unknown names.
+bool parseHardwareModel(const QString& name, HardwareModel* model);
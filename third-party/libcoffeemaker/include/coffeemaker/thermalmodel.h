@@ -0,0 +1,87 @@
+// Bio-Hybrid Coffee Machine Example - Copyright (c) 2021 Bio-Hybrid GmbH
+#pragma once
+
+/// Lumped thermal model of a thermostat controlled heater, like the boiler or the milk heater.
+///
+/// While heating, dT/dt = (P - k (T - ambient)) / C until the setpoint is reached, which is then
+/// held by covering the loss. Switched off, the heater cools exponentially towards ambient. The
+/// curves are advanced in closed form, so the model may be stepped at any interval.
+class HeaterModel
+{
+public:
+    struct Parameters {
+        double ambientC = 22;
+        double capacityJPerK = 400;     ///< heater and its water
+        double powerW = 1400;           ///< heating power
+        double lossWPerK = 1.0;         ///< loss to the ambient
+    };
+
+    HeaterModel();
+    explicit HeaterModel(const Parameters& parameters);
+
+    /// Heats towards `setpointC` and holds it
+    void setSetpoint(double setpointC);
+
+    /// Lets the heater cool down
+    void switchOff();
+
+    bool isOn() const { return on_; }
+    double setpointC() const { return setpointC_; }
+    double temperatureC() const { return temperatureC_; }
+
+    /// Returns the energy put in, in J
+    double energyJ() const { return energyJ_; }
+
+    /// Advances the model by `ms` of machine time
+    void advance(double ms);
+
+    /// Returns the time at full power from the current temperature to `targetC`, 0 if it is there
+    double heatUpMs(double targetC) const;
+
+private:
+    double cooledC(double ms) const;
+
+    Parameters parameters_;
+    double temperatureC_;
+    double setpointC_ = 0;
+    bool on_ = false;
+    double energyJ_ = 0;
+};
+
+/// Forecasts the next order and decides if keeping the boiler warm pays off.
+///
+/// Orders are taken as a Poisson process. Its mean gap is an EWMA of the observed gaps, and while
+/// no order comes the time since the last one bounds it from below, so the forecast fades in
+/// long pauses. Preheat while an order within the horizon is at least `threshold` likely.
+class PreheatForecast
+{
+public:
+    struct Parameters {
+        double horizonMs = 5 * 60 * 1000;
+        double threshold = 0.5;         ///< above 1 never preheats
+        double smoothing = 0.3;         ///< weight of the latest gap
+        double priorGapMs = 15 * 60 * 1000; ///< assumed before the second order
+    };
+
+    PreheatForecast();
+    explicit PreheatForecast(const Parameters& parameters);
+
+    const Parameters& parameters() const { return parameters_; }
+
+    /// Adds an order at machine time `nowMs`
+    void recordOrder(double nowMs);
+
+    /// Returns the expected gap between orders as of `nowMs`
+    double meanGapMs(double nowMs) const;
+
+    /// Returns the probability of an order within the horizon after `nowMs`
+    double orderProbability(double nowMs) const;
+
+    bool shouldPreheat(double nowMs) const { return orderProbability(nowMs) >= parameters_.threshold; }
+
+private:
+    Parameters parameters_;
+    double meanGapMs_;
+    double lastOrderMs_ = -1;
+    int gaps_ = 0;
+};
@@ -1,6 +1,9 @@
 // Bio-Hybrid Coffee Machine Example - Copyright (c) 2021 Bio-Hybrid GmbH
 #include "coffeemaker.h"
 
+#include <QDataStream>
+#include <QDateTime>
+#include <QElapsedTimer>
 #include <QEventTransition>
 #include <QSettings>
 #include <QRandomGenerator>
@@ -14,15 +17,32 @@
 
 // -------------------------------------------------------------------------------------------------
 namespace {
-    constexpr auto milkMax = 750;
-    constexpr auto waterMax = 1150;
-    constexpr auto beansMax = 550;
-    constexpr auto overflowMax = 700;
-    constexpr auto restBinMax = 600;
-    constexpr auto maxCupsUntilCleanReq = 25;
+    constexpr auto preheatCheckMs = 10000;
+
+    /// Returns the timer interval of `ms` machine time
+    int scaledMs(double ms, double scale)
+    {
+        return int(qMax(0.0, ms * scale) + 0.5);
+    }
+
+    /// A small, fast boiler: from cold to 92 °C in about 20 s, cools off in minutes
+    HeaterModel::Parameters boilerParameters()
+    {
+        return HeaterModel::Parameters();
+    }
+
+    /// A thermoblock for the milk, warmer than the fridge in a few seconds
+    HeaterModel::Parameters milkHeaterParameters()
+    {
+        HeaterModel::Parameters parameters;
+        parameters.capacityJPerK = 150;
+        parameters.powerW = 1000;
+        parameters.lossWPerK = 0.5;
+        return parameters;
+    }
 
     enum CustomTypes {
-        CustomString = QEvent::User+1,
+        CustomCommand = QEvent::User+1,
 
         CustomInteger,
         CustomRestBin,
@@ -37,7 +57,7 @@ namespace {
         CustomGrind,
     };
 
-    constexpr auto StringEventType = QEvent::Type(CustomString);
+    constexpr auto CommandEventType = QEvent::Type(CustomCommand);
     constexpr auto IntegerEventType = QEvent::Type(CustomInteger);
 
     constexpr auto RestBinEventType = QEvent::Type(CustomRestBin);
@@ -53,50 +73,130 @@ namespace {
 }
 
 // -------------------------------------------------------------------------------------------------
-struct StringEvent : public QEvent
+namespace {
+    /// Commands of the state machine, compared as integers instead of strings
+    enum class Command : quint8 {
+        TurnOn, TurnOff, CheckOk, Start, Cancel, Finish
+    };
+
+    /// Recycles the memory of the state machine events of a thread.
+    ///
+    /// Every call posts an event that QStateMachine deletes after processing, so in steady state
+    /// each allocation is served by the block the previous event gave back. Events are posted and
+    /// deleted on the machine's thread, a block deleted on another thread just joins that pool.
+    class EventPool
+    {
+    public:
+        static constexpr std::size_t blockSize = 64;
+        static constexpr int maxPooled = 256;
+
+        ~EventPool()
+        {
+            while (free_) {
+                const auto next = free_->next;
+                ::operator delete(free_);
+                free_ = next;
+            }
+        }
+
+        void* allocate(std::size_t size)
+        {
+            if (size <= blockSize && free_) {
+                const auto block = free_;
+                free_ = block->next;
+                --pooled_;
+                ++allocations_.pooled;
+                return block;
+            }
+            ++allocations_.heap;
+            return ::operator new(size > blockSize ? size : std::size_t(blockSize));
+        }
+
+        void release(void* memory, std::size_t size) noexcept
+        {
+            if (size > blockSize || pooled_ >= maxPooled) {
+                ::operator delete(memory);
+                return;
+            }
+            const auto block = static_cast<Block*>(memory);
+            block->next = free_;
+            free_ = block;
+            ++pooled_;
+        }
+
+        CoffeeMaker::EventAllocations allocations() const { return allocations_; }
+
+    private:
+        struct Block {
+            Block* next;
+        };
+        Block* free_ = nullptr;
+        int pooled_ = 0;
+        CoffeeMaker::EventAllocations allocations_;
+    };
+
+    EventPool& eventPool()
+    {
+        thread_local EventPool pool;
+        return pool;
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+/// Base of the state machine events, allocated from the thread's EventPool
+struct PooledEvent : public QEvent
+{
+    using QEvent::QEvent;
+
+    static void* operator new(std::size_t size) { return eventPool().allocate(size); }
+    static void operator delete(void* memory, std::size_t size) { eventPool().release(memory, size); }
+};
+
+// -------------------------------------------------------------------------------------------------
+struct CommandEvent : public PooledEvent
 {
-    StringEvent(const QString &val)
-    : QEvent(StringEventType),
+    CommandEvent(Command val)
+    : PooledEvent(CommandEventType),
       value(val) {}
 
-    const QString value;
+    const Command value;
 };
 
 // -------------------------------------------------------------------------------------------------
-struct IntegerEvent : public QEvent
+struct IntegerEvent : public PooledEvent
 {
     IntegerEvent(int val, QEvent::Type t = IntegerEventType)
-    : QEvent(t),
+    : PooledEvent(t),
       value(val) {}
 
     const int value;
 };
 
 // -------------------------------------------------------------------------------------------------
-struct PrepMilkEvent : public QEvent
+struct PrepMilkEvent : public PooledEvent
 {
     PrepMilkEvent(const CoffeeMaker::MilkOptions& options)
-    : QEvent(PrepMilkEventType),
+    : PooledEvent(PrepMilkEventType),
       value(options) {}
 
     const CoffeeMaker::MilkOptions value;
 };
 
 // -------------------------------------------------------------------------------------------------
-struct BrewEvent : public QEvent
+struct BrewEvent : public PooledEvent
 {
     BrewEvent(const CoffeeMaker::WaterOptions& options)
-    : QEvent(BrewEventType),
+    : PooledEvent(BrewEventType),
       value(options) {}
 
     const CoffeeMaker::WaterOptions value;
 };
 
 // -------------------------------------------------------------------------------------------------
-struct GrindEvent : public QEvent
+struct GrindEvent : public PooledEvent
 {
     GrindEvent(const CoffeeMaker::GrindOptions& options)
-    : QEvent(GrindEventType),
+    : PooledEvent(GrindEventType),
       value(options) {}
 
     const CoffeeMaker::GrindOptions value;
@@ -169,24 +269,28 @@ private:
     const std::shared_ptr<CoffeeMaker::WaterOptions> m_options;
 };
 
+static_assert(sizeof(CommandEvent) <= EventPool::blockSize && sizeof(IntegerEvent) <= EventPool::blockSize
+              && sizeof(PrepMilkEvent) <= EventPool::blockSize && sizeof(BrewEvent) <= EventPool::blockSize
+              && sizeof(GrindEvent) <= EventPool::blockSize, "all events fit into the pooled blocks");
+
 // -------------------------------------------------------------------------------------------------
-class StringTransition : public QAbstractTransition
+class CommandTransition : public QAbstractTransition
 {
 public:
-    StringTransition(const QString &value) : m_value(value) {}
+    CommandTransition(Command value) : m_value(value) {}
 
 protected:
     bool eventTest(QEvent *e) override
     {
-        if (e->type() != StringEventType) return false;
-        const auto ce = static_cast<StringEvent*>(e);
+        if (e->type() != CommandEventType) return false;
+        const auto ce = static_cast<CommandEvent*>(e);
         return (m_value == ce->value);
     }
 
     void onTransition(QEvent*) override {}
 
 private:
-    const QString m_value;
+    const Command m_value;
 };
 
 // -------------------------------------------------------------------------------------------------
@@ -255,10 +359,188 @@ private:
     const QEvent::Type m_type;
 };
 
+// -------------------------------------------------------------------------------------------------
+namespace {
+    using State = CoffeeMaker::State;
+
+    constexpr quint32 snapshotMagic = 0x53534D43; // "CMSS"
+    constexpr quint16 snapshotVersion = 1;
+
+    /// Returns the state a snapshot resumes in, Unknown if it can't be resumed.
+    /// Timed steps already took their ingredients, the machine waits for the next command.
+    State resumableState(State state)
+    {
+        switch (state) {
+        case State::Grinding:
+        case State::Brewing:
+        case State::PrepMilk:
+            return State::CommandMode;
+        case State::SelfCheck:
+        case State::Unknown:
+            return State::Unknown;
+        default:
+            return state;
+        }
+    }
+
+    /// Machine 0 keeps the settings of the single machine
+    QString settingsName(int machineId)
+    {
+        return machineId == 0 ? QString("MachineState") : QString("MachineState-%1").arg(machineId);
+    }
+
+    // The checks below are instantiated per hardware profile, its limits are constants in them.
+    // The machine picks the instance once per operation with std::visit on its HardwareProfile.
+
+    template <typename Profile>
+    bool isValid(const CoffeeMaker::Levels& levels)
+    {
+        return levels.beans >= 0 && levels.beans <= Profile::beansMax
+            && levels.water >= 0 && levels.water <= Profile::waterMax
+            && levels.milk >= 0 && levels.milk <= Profile::milkMax
+            && levels.restBin >= 0 && levels.restBin <= Profile::restBinMax
+            && levels.overflow >= 0 && levels.overflow <= Profile::overflowMax
+            && levels.cupsProcessed >= 0;
+    }
+
+    bool isValid(const CoffeeMaker::Levels& levels, const HardwareProfile& hardware)
+    {
+        return std::visit([&](auto profile) { return isValid<decltype(profile)>(levels); }, hardware);
+    }
+
+    /// True if the self-check passes: nothing to empty and no cleaning due
+    template <typename Profile>
+    bool checkOk(const CoffeeMaker::Levels& levels)
+    {
+        return levels.restBin < Profile::restBinMax
+            && levels.cupsProcessed < Profile::maxCupsUntilCleanReq
+            && levels.overflow < Profile::overflowMax;
+    }
+
+    /// Returns the levels after `maintenance`, the containers filled up to their capacity
+    template <typename Profile>
+    CoffeeMaker::Levels maintained(CoffeeMaker::Levels levels, const CoffeeMaker::Maintenance& maintenance)
+    {
+        levels.beans = qMin(Profile::beansMax, levels.beans + qMax(0, maintenance.addBeansGram));
+        levels.water = qMin(Profile::waterMax, levels.water + qMax(0, maintenance.addWaterMl));
+        levels.milk = qMin(Profile::milkMax, levels.milk + qMax(0, maintenance.addMilkMl));
+        if (maintenance.emptyRestBin) levels.restBin = 0;
+        if (maintenance.emptyOverflow) levels.overflow = 0;
+        if (maintenance.clean) levels.cupsProcessed = 0;
+        return levels;
+    }
+
+    /// Reads the persisted levels, random ones within the capacities on first use
+    template <typename Profile>
+    CoffeeMaker::Levels persistedLevels(const QSettings& settings)
+    {
+        const auto random = QRandomGenerator::global();
+        CoffeeMaker::Levels levels;
+        levels.beans = settings.value("beansContainerLevel", random->bounded(0, Profile::beansMax)).toInt();
+        levels.milk = settings.value("milkContainerLevel", random->bounded(0, Profile::milkMax)).toInt();
+        levels.water = settings.value("waterContainerLevel", random->bounded(0, Profile::waterMax)).toInt();
+        levels.restBin = settings.value("restBinLevel", random->bounded(0, Profile::restBinMax)).toInt();
+        levels.overflow = settings.value("overflowLevel", random->bounded(0, Profile::overflowMax)).toInt();
+        levels.cupsProcessed = settings.value("cupsProcessed", 0).toInt();
+        return levels;
+    }
+
+    QDataStream& operator<<(QDataStream& out, const CoffeeMaker::Levels& levels)
+    {
+        return out << qint32(levels.beans) << qint32(levels.water) << qint32(levels.milk)
+                   << qint32(levels.restBin) << qint32(levels.overflow) << qint32(levels.cupsProcessed);
+    }
+
+    QDataStream& operator>>(QDataStream& in, CoffeeMaker::Levels& levels)
+    {
+        return in >> levels.beans >> levels.water >> levels.milk
+                  >> levels.restBin >> levels.overflow >> levels.cupsProcessed;
+    }
+
+    QByteArray encodeSnapshot(const CoffeeMaker::Snapshot& snapshot)
+    {
+        QByteArray data;
+        QDataStream out(&data, QIODevice::WriteOnly);
+        out.setVersion(QDataStream::Qt_5_12);
+        out << snapshotMagic << snapshotVersion << qint32(snapshot.state) << snapshot.checkedLevels
+            << snapshot.cupDetected << qint32(snapshot.coffeeGroundGram)
+            << qint32(snapshot.grindOptions.beansInGram) << qint32(snapshot.grindOptions.grindLevel)
+            << qint32(snapshot.waterOptions.waterMl) << qint32(snapshot.waterOptions.temperatureC)
+            << qint32(snapshot.milkOptions.milkMl) << qint32(snapshot.milkOptions.temperatureC)
+            << snapshot.milkOptions.foam;
+        out << qChecksum(data.constData(), uint(data.size()));
+        return data;
+    }
+
+    /// Decodes and validates a snapshot of a `snapshot.model` machine, the levels are left to the caller
+    bool decodeSnapshot(const QByteArray& data, CoffeeMaker::Snapshot& snapshot)
+    {
+        if (data.size() < int(sizeof(quint16))) return false;
+        const auto payloadSize = data.size() - int(sizeof(quint16));
+        QDataStream in(data);
+        in.setVersion(QDataStream::Qt_5_12);
+
+        quint32 magic = 0;
+        quint16 version = 0;
+        qint32 state = 0, grindLevel = 0;
+        in >> magic >> version;
+        if (magic != snapshotMagic || version != snapshotVersion) return false;
+        in >> state >> snapshot.checkedLevels >> snapshot.cupDetected >> snapshot.coffeeGroundGram
+           >> snapshot.grindOptions.beansInGram >> grindLevel
+           >> snapshot.waterOptions.waterMl >> snapshot.waterOptions.temperatureC
+           >> snapshot.milkOptions.milkMl >> snapshot.milkOptions.temperatureC >> snapshot.milkOptions.foam;
+        quint16 checksum = 0;
+        in >> checksum;
+        if (in.status() != QDataStream::Ok || !in.atEnd()
+            || checksum != qChecksum(data.constData(), uint(payloadSize))) {
+            return false;
+        }
+
+        if (state < int(State::Off) || state > int(State::Unknown)) return false;
+        if (grindLevel < int(CoffeeMaker::GrindLevel::ExtraCourse)
+            || grindLevel > int(CoffeeMaker::GrindLevel::ExtraFine)) {
+            return false;
+        }
+        snapshot.state = resumableState(State(state));
+        snapshot.grindOptions.grindLevel = CoffeeMaker::GrindLevel(grindLevel);
+        return snapshot.state != State::Unknown && isValid(snapshot.checkedLevels, hardwareProfile(snapshot.model))
+            && snapshot.coffeeGroundGram >= 0 && snapshot.grindOptions.beansInGram >= 0
+            && snapshot.waterOptions.waterMl >= 0 && snapshot.milkOptions.milkMl >= 0;
+    }
+
+    CoffeeMaker::Snapshot coldSnapshot(const CoffeeMaker::Levels& levels, HardwareModel model)
+    {
+        CoffeeMaker::Snapshot snapshot;
+        snapshot.levels = levels;
+        snapshot.checkedLevels = levels;
+        snapshot.model = model;
+        return snapshot;
+    }
+}
+
 // -------------------------------------------------------------------------------------------------
 CoffeeMaker::CoffeeMaker(QObject* parent)
+    : CoffeeMaker(loadSnapshot(), parent)
+{
+}
+
+// -------------------------------------------------------------------------------------------------
+CoffeeMaker::CoffeeMaker(const Levels& levels, QObject* parent)
+    : CoffeeMaker(HardwareModel::Standard, levels, parent)
+{
+}
+
+// -------------------------------------------------------------------------------------------------
+CoffeeMaker::CoffeeMaker(HardwareModel model, const Levels& levels, QObject* parent)
+    : CoffeeMaker(coldSnapshot(levels, model), parent)
+{
+}
+
+// -------------------------------------------------------------------------------------------------
+CoffeeMaker::CoffeeMaker(const Snapshot& snapshot, QObject* parent)
     : QObject(parent)
-    , settings_(new QSettings("MyCoffeeMachine", "MachineState", this))
+    , hardware_(hardwareProfile(snapshot.model))
+    , metrics_(std::make_shared<CoffeeMakerMetrics>())
     , stateMachine_(new QStateMachine(this))
     , stateOff_(new QState(stateMachine_))
     , stateSelfCheck_(new QState(stateMachine_))
@@ -276,40 +558,72 @@ CoffeeMaker::CoffeeMaker(QObject* parent)
     , grindOptions_(std::make_shared<GrindOptions>())
     , waterOptions_(std::make_shared<WaterOptions>())
     , milkOptions_(std::make_shared<MilkOptions>())
+    , boiler_(boilerParameters())
+    , onDemandBoiler_(boilerParameters())
+    , milkHeater_(milkHeaterParameters())
 {
-    // Initialize from last state or assign randomly within max values
-    beansContainerLevel_ = settings_->value("beansContainerLevel", QRandomGenerator::global()->bounded(0, beansMax)).toInt();
-    milkContainerLevel_ = settings_->value("milkContainerLevel", QRandomGenerator::global()->bounded(0, waterMax)).toInt();
-    waterContainerLevel_ = settings_->value("waterContainerLevel", QRandomGenerator::global()->bounded(0, milkMax)).toInt();
-    restBinLevel_ = settings_->value("restBinLevel", QRandomGenerator::global()->bounded(0, restBinMax)).toInt();
-    overflowContainerLevel_ = settings_->value("overflowLevel", QRandomGenerator::global()->bounded(0, overflowMax)).toInt();
-    cupsProcessed_ = settings_->value("cupsProcessed", 0).toInt();
-
-    stateMachine_->setInitialState(stateOff_);
-
-    qDebug() << qPrintable(QString("beans: %1/%2").arg(beansContainerLevel_).arg(beansMax));
-    qDebug() << qPrintable(QString("water: %1/%2").arg(waterContainerLevel_).arg(waterMax));
-    qDebug() << qPrintable(QString("milk : %1/%2").arg(milkContainerLevel_).arg(milkMax));
-    qDebug() << qPrintable(QString("restbin: %1/%2").arg(restBinLevel_).arg(restBinMax));
-    qDebug() << qPrintable(QString("overflow: %1/%2").arg(overflowContainerLevel_).arg(overflowMax));
-    qDebug() << qPrintable(QString("cups: %1/%2").arg(cupsProcessed_).arg(maxCupsUntilCleanReq));
-
+    thermalClock_.start();
+
+    const auto& levels = snapshot.levels;
+    beansContainerLevel_ = levels.beans;
+    milkContainerLevel_ = levels.milk;
+    waterContainerLevel_ = levels.water;
+    restBinLevel_ = levels.restBin;
+    overflowContainerLevel_ = levels.overflow;
+    cupsProcessed_ = levels.cupsProcessed;
+    updateLevelMetrics();
+
+    cupDetected_ = snapshot.cupDetected;
+    currentCoffeeGroundAmount_ = snapshot.coffeeGroundGram;
+    *grindOptions_ = snapshot.grindOptions;
+    *waterOptions_ = snapshot.waterOptions;
+    *milkOptions_ = snapshot.milkOptions;
+    checkedLevels_ = snapshot.checkedLevels;
+
+    logLevels();
+
+    // The limits of the transitions and the step timings of the hardware
+    const auto restBinMax = restBinLevelMax();
+    const auto overflowMax = overflowContainerMax();
+    const auto maxCupsUntilCleanReq = maxCupsProcessedUntilCleanMode();
+    int selfCheckMs = 0, grindStepMs = 0, brewStepMs = 0, milkStepMs = 0;
+    std::visit([&](auto profile) {
+        selfCheckMs = decltype(profile)::selfCheckMs;
+        grindStepMs = decltype(profile)::grindStepMs;
+        brewStepMs = decltype(profile)::brewStepMs;
+        milkStepMs = decltype(profile)::milkStepMs;
+    }, hardware_);
+
+    static_assert(CoffeeMakerMetrics::stateCount == int(State::Unknown) + 1, "one counter per state");
+
+    // In the order of State
     std::array<QState*, 13> allStates = {
         stateOff_, stateSelfCheck_, stateBinFull_, stateOverflowFull1_, stateCleaningReq_, stateStandBy_,
         stateCommandMode_, stateGrinding_, stateBeansEmpty_, stateBrewing_, stateWaterEmpty_, statePrepMilk_,
         stateMilkEmpty_
     };
 
+    // A snapshot resumes in its state directly, without the power-on self-check
+    const auto resumed = resumableState(snapshot.state);
+    warmStarting_ = resumed != State::Off && resumed != State::Unknown;
+    stateMachine_->setInitialState(warmStarting_ ? allStates[size_t(resumed)] : stateOff_);
+    metrics_->warmStarted.store(warmStarting_ ? 1 : 0, std::memory_order_relaxed);
+    metrics_->snapshotRestoreNs.store(snapshot.restoreNs, std::memory_order_relaxed);
+    if (warmStarting_) {
+        qDebug() << "Resuming in state" << int(resumed) << "from the snapshot, loaded in" << snapshot.restoreNs / 1000 << "us";
+    }
+
     { // Start transition
-        const auto startTransition = new StringTransition("turn_on");
+        const auto startTransition = new CommandTransition(Command::TurnOn);
         startTransition->setTargetState(stateSelfCheck_);
         stateOff_->addTransition(startTransition);
     }
 
     { // Self-check timer
         const auto selfCheckTimer = new QTimer(stateSelfCheck_);
-        selfCheckTimer->setInterval(1234);
+        selfCheckTimer->setInterval(selfCheckMs);
         selfCheckTimer->setSingleShot(true);
+        stepTimers_.push_back({selfCheckTimer, selfCheckMs});
         const auto selfCheckSubState = new QState(stateSelfCheck_);
         connect(selfCheckSubState, &QState::entered, selfCheckTimer, QOverload<>::of(&QTimer::start));
         const auto selfCheckDone = new QFinalState(stateSelfCheck_);
@@ -318,7 +632,7 @@ CoffeeMaker::CoffeeMaker(QObject* parent)
     }
 
     { // Self check ok transition, and others
-        const auto chkOkTransition = new StringTransition("check_ok");
+        const auto chkOkTransition = new CommandTransition(Command::CheckOk);
         chkOkTransition->setTargetState(stateStandBy_);
         stateSelfCheck_->addTransition(chkOkTransition);
 
@@ -336,9 +650,12 @@ CoffeeMaker::CoffeeMaker(QObject* parent)
     }
 
     { // Standby Transitions outgoing
-        const auto startTransition = new StringTransition("start");
+        const auto startTransition = new CommandTransition(Command::Start);
         startTransition->setTargetState(stateCommandMode_);
         stateStandBy_->addTransition(startTransition);
+        connect(startTransition, &CommandTransition::triggered, this, [this]() {
+            preheat_.recordOrder(advanceThermal());
+        });
 
         const auto toBinFull = new IntLargerThanTransition(restBinMax -1, RestBinEventType);
         toBinFull->setTargetState(stateBinFull_);
@@ -372,19 +689,23 @@ CoffeeMaker::CoffeeMaker(QObject* parent)
         };
 
         for (const auto s : someStates) {
-            const auto cancelTransition = new StringTransition("cancel");
+            const auto cancelTransition = new CommandTransition(Command::Cancel);
             cancelTransition->setTargetState(stateStandBy_);
             s->addTransition(cancelTransition);
-            connect(cancelTransition, &StringTransition::triggered, this, [this](){
+            connect(cancelTransition, &CommandTransition::triggered, this, [this](){
                 addToCupsProcessed(1);
+                dispenseCup();
             });
         }
 
-        const auto finishTransition = new StringTransition("finish");
+        const auto finishTransition = new CommandTransition(Command::Finish);
         finishTransition->setTargetState(stateStandBy_);
         stateCommandMode_->addTransition(finishTransition);
-        connect(finishTransition, &StringTransition::triggered, this, [this](){
+        connect(finishTransition, &CommandTransition::triggered, this, [this](){
+            // Cancelled cups use the machine too, but only finished ones are made
+            metrics_->cupsMadeTotal.fetch_add(1, std::memory_order_relaxed);
             addToCupsProcessed(1);
+            dispenseCup();
         });
     }
 
@@ -405,17 +726,19 @@ CoffeeMaker::CoffeeMaker(QObject* parent)
     // on grinding state
     connect(stateGrinding_, &QState::entered, this, [this]()
     {
-        qDebug() << qPrintable(QString("current beans: %1/%2").arg(beansContainerLevel_).arg(beansMax));
+        qDebug() << qPrintable(QString("current beans: %1/%2").arg(beansContainerLevel_).arg(beansContainerMax()));
         qDebug() << "Start grinding: beans: " << grindOptions_->beansInGram << static_cast<int>(grindOptions_->grindLevel);
         const auto beans = getBeans(grindOptions_->beansInGram);
+        cup_.beansGram += beans;
         currentCoffeeGroundAmount_ += beans;
         grindOptions_->beansInGram -= beans;
     });
 
     { // Grinding timer
         const auto timer = new QTimer(stateGrinding_);
-        timer->setInterval(2500);
+        timer->setInterval(grindStepMs);
         timer->setSingleShot(true);
+        stepTimers_.push_back({timer, grindStepMs});
         const auto timingState = new QState(stateGrinding_);
         connect(timingState, &QState::entered, timer, QOverload<>::of(&QTimer::start));
         const auto done = new QFinalState(stateGrinding_);
@@ -438,9 +761,12 @@ CoffeeMaker::CoffeeMaker(QObject* parent)
     // on brewing state ---------------------
     connect(stateBrewing_, &QState::entered, this, [this]()
     {
-        qDebug() << qPrintable(QString("current water: %1/%2").arg(waterContainerLevel_).arg(waterMax));
+        qDebug() << qPrintable(QString("current water: %1/%2").arg(waterContainerLevel_).arg(waterContainerMax()));
         qDebug() << "Start brewing: water: " << waterOptions_->waterMl << ", temp:"<< waterOptions_->temperatureC;
+        keepWarmC_ = qBound(40, waterOptions_->temperatureC, 98);
+        brewHeatUpMs_ = heatUp(boiler_, keepWarmC_, &onDemandBoiler_);
         const auto water = getWater(waterOptions_->waterMl);
+        cup_.waterMl += water;
         waterOptions_->waterMl -= water;
         if (!cupDetected()) {
             addToOverflow(water);
@@ -449,9 +775,14 @@ CoffeeMaker::CoffeeMaker(QObject* parent)
 
     { // Brewing timer
         const auto timer = new QTimer(stateBrewing_);
-        timer->setInterval(3003);
+        timer->setInterval(brewStepMs);
         timer->setSingleShot(true);
+        stepTimers_.push_back({timer, brewStepMs});
         const auto timingState = new QState(stateBrewing_);
+        // The water has to reach its temperature first
+        connect(timingState, &QState::entered, timer, [this, timer, brewStepMs]() {
+            timer->setInterval(scaledMs(brewStepMs + brewHeatUpMs_, timeScale_));
+        });
         connect(timingState, &QState::entered, timer, QOverload<>::of(&QTimer::start));
         const auto done = new QFinalState(stateBrewing_);
         timingState->addTransition(timer, &QTimer::timeout, done);
@@ -473,10 +804,12 @@ CoffeeMaker::CoffeeMaker(QObject* parent)
     // on prep milk state ----------------
     connect(statePrepMilk_, &QState::entered, this, [this]()
     {
-        qDebug() << qPrintable(QString("current milk: %1/%2").arg(milkContainerLevel_).arg(milkMax));
+        qDebug() << qPrintable(QString("current milk: %1/%2").arg(milkContainerLevel_).arg(milkContainerMax()));
         qDebug() << "Start prepping milk: amount: " << milkOptions_->milkMl
                  << ", temp:"<< milkOptions_->temperatureC << ", foam: " << milkOptions_->foam;
+        milkHeatUpMs_ = heatUp(milkHeater_, qBound(5, milkOptions_->temperatureC, 80));
         const auto milk = getMilk(milkOptions_->milkMl);
+        cup_.milkMl += milk;
         milkOptions_->milkMl -= milk;
         if (!cupDetected()) {
             addToOverflow(milk);
@@ -485,9 +818,13 @@ CoffeeMaker::CoffeeMaker(QObject* parent)
 
     { // Milk prepare timer
         const auto timer = new QTimer(statePrepMilk_);
-        timer->setInterval(3500);
+        timer->setInterval(milkStepMs);
         timer->setSingleShot(true);
+        stepTimers_.push_back({timer, milkStepMs});
         const auto timingState = new QState(statePrepMilk_);
+        connect(timingState, &QState::entered, timer, [this, timer, milkStepMs]() {
+            timer->setInterval(scaledMs(milkStepMs + milkHeatUpMs_, timeScale_));
+        });
         connect(timingState, &QState::entered, timer, QOverload<>::of(&QTimer::start));
         const auto done = new QFinalState(statePrepMilk_);
         timingState->addTransition(timer, &QTimer::timeout, done);
@@ -515,16 +852,27 @@ CoffeeMaker::CoffeeMaker(QObject* parent)
 
     // Emit state changed signals for the coffee maker
     for (const auto s : allStates) {
-        connect(s, &QState::entered, this, [this](){ emit currentStateChanged(currentState()); });
-        if (s != stateOff_)
-            connect(s, &QState::entered, this, [this](){ doSelfCheck(); });
+        connect(s, &QState::entered, this, [this](){
+            const auto state = currentState();
+            metrics_->state.store(int(state), std::memory_order_relaxed);
+            metrics_->stateEntries[size_t(state)].fetch_add(1, std::memory_order_relaxed);
+            controlHeaters(state);
+            emit currentStateChanged(state);
+            saveSnapshot();
+        });
+        if (s != stateOff_) {
+            connect(s, &QState::entered, this, [this]() {
+                if (warmStarting_) incrementalSelfCheck();
+                else doSelfCheck();
+            });
+        }
     }
 
     // Turn off transistion from every state (but the off state itself)
     for (const auto s : allStates)
     {
         if (s == stateOff_) continue;
-        const auto offTransition = new StringTransition("turn_off");
+        const auto offTransition = new CommandTransition(Command::TurnOff);
         offTransition->setTargetState(stateOff_);
         s->addTransition(offTransition);
 
@@ -532,8 +880,9 @@ CoffeeMaker::CoffeeMaker(QObject* parent)
             || s == stateGrinding_ || s == stateBrewing_ || s == statePrepMilk_
             || s == stateCommandMode_ )
         {
-            connect(offTransition, &StringTransition::triggered, this, [this](){
+            connect(offTransition, &CommandTransition::triggered, this, [this](){
                 addToCupsProcessed(1);
+                dispenseCup();
             });
         }
 
@@ -544,9 +893,27 @@ CoffeeMaker::CoffeeMaker(QObject* parent)
         emptyCoffeeGrounds(); // coffee ground that might be in the chamber to bin
     });
 
+    timeStage(stateGrinding_, &Cup::grindMs);
+    timeStage(stateBrewing_, &Cup::brewMs);
+    timeStage(statePrepMilk_, &Cup::milkPrepMs);
+
+    { // The preheat forecast fades while the machine waits, check it again from time to time
+        preheatTimer_ = new QTimer(this);
+        preheatTimer_->setInterval(preheatCheckMs);
+        connect(preheatTimer_, &QTimer::timeout, this, [this]() { controlHeaters(currentState()); });
+        preheatTimer_->start();
+    }
+
     stateMachine_->start();
 }
 
+// -------------------------------------------------------------------------------------------------
+CoffeeMaker::~CoffeeMaker()
+{
+    // Before the state machine started there is no state to save, the last snapshot stays valid
+    if (stateMachine_->isRunning()) saveSnapshot();
+}
+
 // -------------------------------------------------------------------------------------------------
 CoffeeMaker::State CoffeeMaker::currentState() const
 {
@@ -567,28 +934,349 @@ CoffeeMaker::State CoffeeMaker::currentState() const
 }
 
 // -------------------------------------------------------------------------------------------------
-int CoffeeMaker::beansContainerMax() const { return beansMax; }
-int CoffeeMaker::waterContainerMax() const { return waterMax; }
-int CoffeeMaker::milkContainerMax() const { return milkMax; }
-int CoffeeMaker::restBinLevelMax() const { return restBinMax; }
-int CoffeeMaker::overflowContainerMax() const { return overflowMax; }
+int CoffeeMaker::beansContainerMax() const
+{
+    return std::visit([](auto profile) { return decltype(profile)::beansMax; }, hardware_);
+}
+
+// -------------------------------------------------------------------------------------------------
+int CoffeeMaker::waterContainerMax() const
+{
+    return std::visit([](auto profile) { return decltype(profile)::waterMax; }, hardware_);
+}
+
+// -------------------------------------------------------------------------------------------------
+int CoffeeMaker::milkContainerMax() const
+{
+    return std::visit([](auto profile) { return decltype(profile)::milkMax; }, hardware_);
+}
+
+// -------------------------------------------------------------------------------------------------
+int CoffeeMaker::restBinLevelMax() const
+{
+    return std::visit([](auto profile) { return decltype(profile)::restBinMax; }, hardware_);
+}
+
+// -------------------------------------------------------------------------------------------------
+int CoffeeMaker::overflowContainerMax() const
+{
+    return std::visit([](auto profile) { return decltype(profile)::overflowMax; }, hardware_);
+}
 
 // -------------------------------------------------------------------------------------------------
 void CoffeeMaker::addMilkToContainer(int milkMl)
 {
-    setMilkContainerLevel(qMin(milkMax, milkContainerLevel_ + milkMl));
+    setMilkContainerLevel(qMin(milkContainerMax(), milkContainerLevel_ + milkMl));
 }
 
 // -------------------------------------------------------------------------------------------------
 void CoffeeMaker::addWatertoContainer(int waterMl)
 {
-    setWaterContainerLevel(qMin(waterMax, waterContainerLevel_ + waterMl));
+    setWaterContainerLevel(qMin(waterContainerMax(), waterContainerLevel_ + waterMl));
 }
 
 // -------------------------------------------------------------------------------------------------
 void CoffeeMaker::addBeanstoContainer(int beansGram)
 {
-    setBeansContainerLevel(qMin(beansMax, beansContainerLevel_ + beansGram));
+    setBeansContainerLevel(qMin(beansContainerMax(), beansContainerLevel_ + beansGram));
+}
+
+// -------------------------------------------------------------------------------------------------
+CoffeeMaker::Levels CoffeeMaker::loadLevels(int machineId)
+{
+    // Initialize from last state or assign randomly within max values
+    const QSettings settings("MyCoffeeMachine", settingsName(machineId));
+    return std::visit([&](auto profile) { return persistedLevels<decltype(profile)>(settings); },
+                      hardwareProfile(loadHardwareModel(machineId)));
+}
+
+// -------------------------------------------------------------------------------------------------
+HardwareModel CoffeeMaker::loadHardwareModel(int machineId)
+{
+    const QSettings settings("MyCoffeeMachine", settingsName(machineId));
+    auto model = HardwareModel::Standard;
+    const auto name = settings.value("hardwareModel").toString();
+    if (!name.isEmpty() && !parseHardwareModel(name, &model)) {
+        qWarning() << "Unknown hardware model" << name << "in the settings, using the standard model";
+    }
+    return model;
+}
+
+// -------------------------------------------------------------------------------------------------
+CoffeeMaker::Snapshot CoffeeMaker::loadSnapshot(int machineId)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    auto snapshot = coldSnapshot(loadLevels(machineId), loadHardwareModel(machineId));
+    Snapshot saved;
+    saved.model = snapshot.model;
+    const QSettings settings("MyCoffeeMachine", settingsName(machineId));
+    if (decodeSnapshot(settings.value("snapshot").toByteArray(), saved)) {
+        // The levels are persisted on every change, so they may be newer than the snapshot
+        saved.levels = snapshot.levels;
+        snapshot = saved;
+    }
+    snapshot.restoreNs = timer.nsecsElapsed();
+    return snapshot;
+}
+
+// -------------------------------------------------------------------------------------------------
+CoffeeMaker::Snapshot CoffeeMaker::snapshot() const
+{
+    Snapshot snapshot;
+    snapshot.levels = levels();
+    snapshot.checkedLevels = snapshot.levels;
+    snapshot.state = currentState();
+    snapshot.cupDetected = cupDetected_;
+    snapshot.coffeeGroundGram = currentCoffeeGroundAmount_;
+    snapshot.grindOptions = *grindOptions_;
+    snapshot.waterOptions = *waterOptions_;
+    snapshot.milkOptions = *milkOptions_;
+    snapshot.model = hardwareModel();
+    return snapshot;
+}
+
+// -------------------------------------------------------------------------------------------------
+CoffeeMaker::EventAllocations CoffeeMaker::eventAllocations()
+{
+    return eventPool().allocations();
+}
+
+// -------------------------------------------------------------------------------------------------
+void CoffeeMaker::setTimeScale(double scale)
+{
+    advanceThermal();
+    timeScale_ = scale;
+    for (const auto& step : stepTimers_) {
+        step.timer->setInterval(scaledMs(step.durationMs, scale));
+    }
+    // Repeating, a 0 ms interval would run it on every event loop iteration
+    preheatTimer_->setInterval(qMax(1, scaledMs(preheatCheckMs, scale)));
+}
+
+// -------------------------------------------------------------------------------------------------
+void CoffeeMaker::setPreheatParameters(const PreheatForecast::Parameters& parameters)
+{
+    preheat_ = PreheatForecast(parameters);
+    controlHeaters(currentState());
+}
+
+// -------------------------------------------------------------------------------------------------
+CoffeeMaker::ThermalReport CoffeeMaker::thermalReport() const
+{
+    const auto ms = pendingMachineMs();
+    auto boiler = boiler_;
+    auto onDemandBoiler = onDemandBoiler_;
+    auto milkHeater = milkHeater_;
+    boiler.advance(ms);
+    onDemandBoiler.advance(ms);
+    milkHeater.advance(ms);
+
+    ThermalReport report;
+    report.boilerC = boiler.temperatureC();
+    report.milkHeaterC = milkHeater.temperatureC();
+    report.preheating = boiler.isOn() && !onDemandBoiler.isOn();
+    report.orderProbability = preheat_.orderProbability(machineMs_ + ms);
+    report.heatUpWaitMs = heatUpWaitMs_;
+    report.latencySavedMs = latencySavedMs_;
+    report.energyJ = boiler.energyJ() + milkHeater.energyJ();
+    report.preheatEnergyJ = boiler.energyJ() - onDemandBoiler.energyJ();
+    return report;
+}
+
+// -------------------------------------------------------------------------------------------------
+double CoffeeMaker::pendingMachineMs() const
+{
+    return double(thermalClock_.nsecsElapsed() - thermalNs_) / 1e6 / qMax(timeScale_, 1e-9);
+}
+
+// -------------------------------------------------------------------------------------------------
+double CoffeeMaker::advanceThermal()
+{
+    const auto ms = pendingMachineMs();
+    thermalNs_ = thermalClock_.nsecsElapsed();
+    machineMs_ += ms;
+    boiler_.advance(ms);
+    onDemandBoiler_.advance(ms);
+    milkHeater_.advance(ms);
+    return machineMs_;
+}
+
+// -------------------------------------------------------------------------------------------------
+double CoffeeMaker::heatUp(HeaterModel& heater, double targetC, HeaterModel* onDemand)
+{
+    advanceThermal();
+    const auto ms = heater.heatUpMs(targetC);
+    heater.setSetpoint(targetC);
+    if (onDemand) {
+        latencySavedMs_ += onDemand->heatUpMs(targetC) - ms;
+        onDemand->setSetpoint(targetC);
+    }
+    heatUpWaitMs_ += ms;
+    updateThermalMetrics();
+    return ms;
+}
+
+// -------------------------------------------------------------------------------------------------
+void CoffeeMaker::controlHeaters(State state)
+{
+    const auto nowMs = advanceThermal();
+    switch (state) {
+    case State::Off:
+    case State::Unknown:
+        boiler_.switchOff();
+        onDemandBoiler_.switchOff();
+        break;
+    case State::SelfCheck:
+    case State::CommandMode:
+    case State::Grinding:
+    case State::BeansEmpty:
+        // Powered on or an order is running, heating is on demand
+        boiler_.setSetpoint(keepWarmC_);
+        onDemandBoiler_.setSetpoint(keepWarmC_);
+        break;
+    case State::Brewing:
+    case State::WaterEmpty:
+    case State::PrepMilk:
+    case State::MilkEmpty:
+        break; // heatUp() set the temperatures of the step
+    default:
+        // Waiting for an order, a cleaning or an emptied container
+        if (preheat_.shouldPreheat(nowMs)) boiler_.setSetpoint(keepWarmC_);
+        else boiler_.switchOff();
+        onDemandBoiler_.switchOff();
+        break;
+    }
+    if (state != State::PrepMilk && state != State::MilkEmpty) milkHeater_.switchOff();
+    updateThermalMetrics();
+}
+
+// -------------------------------------------------------------------------------------------------
+void CoffeeMaker::updateThermalMetrics()
+{
+    constexpr auto relaxed = std::memory_order_relaxed;
+    metrics_->boilerMilliC.store(qRound(boiler_.temperatureC() * 1000), relaxed);
+    metrics_->milkHeaterMilliC.store(qRound(milkHeater_.temperatureC() * 1000), relaxed);
+    metrics_->preheating.store(boiler_.isOn() && !onDemandBoiler_.isOn() ? 1 : 0, relaxed);
+    metrics_->heatUpWaitMs.store(qint64(heatUpWaitMs_), relaxed);
+    metrics_->preheatSavedMs.store(qint64(latencySavedMs_), relaxed);
+    metrics_->heaterEnergyJ.store(qint64(boiler_.energyJ() + milkHeater_.energyJ()), relaxed);
+    metrics_->preheatEnergyJ.store(qint64(boiler_.energyJ() - onDemandBoiler_.energyJ()), relaxed);
+}
+
+// -------------------------------------------------------------------------------------------------
+void CoffeeMaker::saveSnapshot()
+{
+    QElapsedTimer timer;
+    timer.start();
+    settings()->setValue("snapshot", encodeSnapshot(snapshot()));
+    metrics_->snapshotSaveNs.store(timer.nsecsElapsed(), std::memory_order_relaxed);
+    metrics_->snapshotsSaved.fetch_add(1, std::memory_order_relaxed);
+}
+
+// -------------------------------------------------------------------------------------------------
+void CoffeeMaker::incrementalSelfCheck()
+{
+    // The resumed state was valid for the checked levels, only the changed ones can leave it
+    warmStarting_ = false;
+    const auto check = [this](int level, int checked, QEvent::Type type) {
+        if (level != checked) stateMachine_->postEvent(new IntegerEvent(level, type));
+    };
+    check(waterContainerLevel_, checkedLevels_.water, WaterEventType);
+    check(beansContainerLevel_, checkedLevels_.beans, BeansEventType);
+    check(milkContainerLevel_, checkedLevels_.milk, MilkEventType);
+    check(restBinLevel_, checkedLevels_.restBin, RestBinEventType);
+    check(overflowContainerLevel_, checkedLevels_.overflow, OverflowEventType);
+    check(cupsProcessed_, checkedLevels_.cupsProcessed, CupCountEventType);
+}
+
+// -------------------------------------------------------------------------------------------------
+CoffeeMaker::Levels CoffeeMaker::levels() const
+{
+    Levels levels;
+    levels.beans = beansContainerLevel_;
+    levels.water = waterContainerLevel_;
+    levels.milk = milkContainerLevel_;
+    levels.restBin = restBinLevel_;
+    levels.overflow = overflowContainerLevel_;
+    levels.cupsProcessed = cupsProcessed_;
+    return levels;
+}
+
+// -------------------------------------------------------------------------------------------------
+void CoffeeMaker::applyMaintenance(const Maintenance& maintenance)
+{
+    // The members change without the setters, their signals would each start a self-check with
+    // the levels of that moment
+    const auto before = levels();
+    const auto after = std::visit([&](auto profile) {
+        return maintained<decltype(profile)>(before, maintenance);
+    }, hardware_);
+    if (after.beans == before.beans && after.water == before.water && after.milk == before.milk
+        && after.restBin == before.restBin && after.overflow == before.overflow
+        && after.cupsProcessed == before.cupsProcessed) {
+        return;
+    }
+    beansContainerLevel_ = after.beans;
+    waterContainerLevel_ = after.water;
+    milkContainerLevel_ = after.milk;
+    restBinLevel_ = after.restBin;
+    overflowContainerLevel_ = after.overflow;
+    cupsProcessed_ = after.cupsProcessed;
+
+    updateLevelMetrics();
+    // One write of the levels and the snapshot, the file never holds half a service visit
+    settings()->setValue("beansContainerLevel", after.beans);
+    settings()->setValue("waterContainerLevel", after.water);
+    settings()->setValue("milkContainerLevel", after.milk);
+    settings()->setValue("restBinLevel", after.restBin);
+    settings()->setValue("overflowLevel", after.overflow);
+    settings()->setValue("cupsProcessed", after.cupsProcessed);
+    saveSnapshot();
+    settings()->sync();
+
+    emit levelsChanged(after);
+    doSelfCheck();
+}
+
+// -------------------------------------------------------------------------------------------------
+void CoffeeMaker::updateLevelMetrics()
+{
+    metrics_->waterMl.store(waterContainerLevel_, std::memory_order_relaxed);
+    metrics_->milkMl.store(milkContainerLevel_, std::memory_order_relaxed);
+    metrics_->beansGram.store(beansContainerLevel_, std::memory_order_relaxed);
+    metrics_->restBinLevel.store(restBinLevel_, std::memory_order_relaxed);
+    metrics_->overflowLevel.store(overflowContainerLevel_, std::memory_order_relaxed);
+    metrics_->cupsProcessed.store(cupsProcessed_, std::memory_order_relaxed);
+}
+
+// -------------------------------------------------------------------------------------------------
+void CoffeeMaker::logLevels() const
+{
+    qDebug() << qPrintable(QString("beans: %1/%2").arg(beansContainerLevel_).arg(beansContainerMax()));
+    qDebug() << qPrintable(QString("water: %1/%2").arg(waterContainerLevel_).arg(waterContainerMax()));
+    qDebug() << qPrintable(QString("milk : %1/%2").arg(milkContainerLevel_).arg(milkContainerMax()));
+    qDebug() << qPrintable(QString("restbin: %1/%2").arg(restBinLevel_).arg(restBinLevelMax()));
+    qDebug() << qPrintable(QString("overflow: %1/%2").arg(overflowContainerLevel_).arg(overflowContainerMax()));
+    qDebug() << qPrintable(QString("cups: %1/%2").arg(cupsProcessed_).arg(maxCupsProcessedUntilCleanMode()));
+}
+
+// -------------------------------------------------------------------------------------------------
+QSettings* CoffeeMaker::settings()
+{
+    // Created on first write, the levels are read by loadLevels()
+    if (!settings_) settings_ = new QSettings("MyCoffeeMachine", settingsName(machineId_), this);
+    return settings_;
+}
+
+// -------------------------------------------------------------------------------------------------
+void CoffeeMaker::setMachineId(int machineId)
+{
+    if (machineId_ == machineId) return;
+    machineId_ = machineId;
+    delete settings_;
+    settings_ = nullptr;
 }
 
 // -------------------------------------------------------------------------------------------------
@@ -596,7 +1284,8 @@ void CoffeeMaker::setBeansContainerLevel(int level)
 {
     if (beansContainerLevel_ == level) return;
     beansContainerLevel_ = level;
-    settings_->setValue("beansContainerLevel", beansContainerLevel_);
+    metrics_->beansGram.store(beansContainerLevel_, std::memory_order_relaxed);
+    settings()->setValue("beansContainerLevel", beansContainerLevel_);
     emit beansContainerLevelChanged(beansContainerLevel_);
 }
 
@@ -605,7 +1294,8 @@ void CoffeeMaker::setWaterContainerLevel(int level)
 {
     if (waterContainerLevel_ == level) return;
     waterContainerLevel_ = level;
-    settings_->setValue("waterContainerLevel", waterContainerLevel_);
+    metrics_->waterMl.store(waterContainerLevel_, std::memory_order_relaxed);
+    settings()->setValue("waterContainerLevel", waterContainerLevel_);
     emit waterContainerLevelChanged(waterContainerLevel_);
 }
 
@@ -614,7 +1304,8 @@ void CoffeeMaker::setMilkContainerLevel(int level)
 {
     if (milkContainerLevel_ == level) return;
     milkContainerLevel_ = level;
-    settings_->setValue("milkContainerLevel", milkContainerLevel_);
+    metrics_->milkMl.store(milkContainerLevel_, std::memory_order_relaxed);
+    settings()->setValue("milkContainerLevel", milkContainerLevel_);
     emit milkContainerLevelChanged(milkContainerLevel_);
 }
 
@@ -623,7 +1314,8 @@ void CoffeeMaker::setOverflowLevel(int level)
 {
     if (overflowContainerLevel_ == level) return;
     overflowContainerLevel_ = level;
-    settings_->setValue("overflowLevel", overflowContainerLevel_);
+    metrics_->overflowLevel.store(overflowContainerLevel_, std::memory_order_relaxed);
+    settings()->setValue("overflowLevel", overflowContainerLevel_);
     emit overflowContainerLevelChanged(overflowContainerLevel_);
 }
 
@@ -632,7 +1324,8 @@ void CoffeeMaker::setRestBinLevel(int level)
 {
     if (restBinLevel_ == level) return;
     restBinLevel_ = level;
-    settings_->setValue("restBinLevel", restBinLevel_);
+    metrics_->restBinLevel.store(restBinLevel_, std::memory_order_relaxed);
+    settings()->setValue("restBinLevel", restBinLevel_);
     emit restBinLevelChanged(restBinLevel_);
 }
 
@@ -641,7 +1334,8 @@ void CoffeeMaker::setCupsProcessed(int cups)
 {
     if (cupsProcessed_ == cups) return;
     cupsProcessed_ = cups;
-    settings_->setValue("cupsProcessed", cupsProcessed_);
+    metrics_->cupsProcessed.store(cupsProcessed_, std::memory_order_relaxed);
+    settings()->setValue("cupsProcessed", cupsProcessed_);
     emit cupsProcessedChanged(cupsProcessed_);
 }
 
@@ -664,47 +1358,76 @@ void CoffeeMaker::removeCup()
 // -------------------------------------------------------------------------------------------------
 void CoffeeMaker::turnOn()
 {
-    stateMachine_->postEvent(new StringEvent("turn_on"));
+    stateMachine_->postEvent(new CommandEvent(Command::TurnOn));
 }
 
 // -------------------------------------------------------------------------------------------------
 void CoffeeMaker::turnOff()
 {
-    stateMachine_->postEvent(new StringEvent("turn_off"));
+    stateMachine_->postEvent(new CommandEvent(Command::TurnOff));
 }
 
 // -------------------------------------------------------------------------------------------------
 void CoffeeMaker::startCommandMode()
 {
-    stateMachine_->postEvent(new StringEvent("start"));
+    stateMachine_->postEvent(new CommandEvent(Command::Start));
 }
 
 // -------------------------------------------------------------------------------------------------
 void CoffeeMaker::cancelCommandMode()
 {
-    stateMachine_->postEvent(new StringEvent("cancel"));
+    stateMachine_->postEvent(new CommandEvent(Command::Cancel));
+}
+
+// -------------------------------------------------------------------------------------------------
+void CoffeeMaker::setRecipeName(const QString& name)
+{
+    cup_.recipe = name;
+}
+
+// -------------------------------------------------------------------------------------------------
+void CoffeeMaker::timeStage(QState* state, int Cup::*durationMs)
+{
+    connect(state, &QState::entered, this, [this]() { stageStartedMs_ = advanceThermal(); });
+    connect(state, &QState::exited, this, [this, durationMs]() {
+        cup_.*durationMs += qRound(advanceThermal() - stageStartedMs_);
+    });
+}
+
+// -------------------------------------------------------------------------------------------------
+void CoffeeMaker::dispenseCup()
+{
+    if (cup_.beansGram > 0 || cup_.waterMl > 0 || cup_.milkMl > 0) {
+        cup_.finishedMs = QDateTime::currentMSecsSinceEpoch();
+        emit cupDispensed(cup_);
+    }
+    cup_ = Cup();
 }
 
 // -------------------------------------------------------------------------------------------------
 void CoffeeMaker::finishCommandMode()
 {
-    stateMachine_->postEvent(new StringEvent("finish"));
+    stateMachine_->postEvent(new CommandEvent(Command::Finish));
 }
 
 // -------------------------------------------------------------------------------------------------
 int CoffeeMaker::maxCupsProcessedUntilCleanMode() const
 {
-    return maxCupsUntilCleanReq;
+    return std::visit([](auto profile) { return decltype(profile)::maxCupsUntilCleanReq; }, hardware_);
+}
+
+// -------------------------------------------------------------------------------------------------
+HardwareModel CoffeeMaker::hardwareModel() const
+{
+    return ::hardwareModel(hardware_);
 }
 
 // -------------------------------------------------------------------------------------------------
 void CoffeeMaker::doSelfCheck()
 {
-    if (restBinLevel() < restBinMax
-        && cupsProcessed() < maxCupsUntilCleanReq
-        && overflowContainerLevel() < overflowMax)
-    {
-        stateMachine_->postEvent(new StringEvent("check_ok"));
+    const auto current = levels();
+    if (std::visit([&](auto profile) { return checkOk<decltype(profile)>(current); }, hardware_)) {
+        stateMachine_->postEvent(new CommandEvent(Command::CheckOk));
     }
 
     // internally post all current container levels as events
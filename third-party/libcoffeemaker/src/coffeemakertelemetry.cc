@@ -0,0 +1,245 @@
+// Bio-Hybrid Coffee Machine Example - Copyright (c) 2021 Bio-Hybrid GmbH
+#include "coffeemakertelemetry.h"
+
+#include <QDebug>
+
+#ifdef Q_OS_UNIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
+#include <new>
+#include <thread>
+
+static_assert(ATOMIC_INT_LOCK_FREE == 2 && ATOMIC_LLONG_LOCK_FREE == 2,
+              "the record is shared between processes, its atomics must not use locks");
+
+const char* const CoffeeMakerTelemetry::defaultName = "/coffeemaker-telemetry";
+
+// -------------------------------------------------------------------------------------------------
+namespace {
+    constexpr auto relaxed = std::memory_order_relaxed;
+
+    QString posixName(const QString& name)
+    {
+        return name.startsWith(QLatin1Char('/')) ? name : QLatin1Char('/') + name;
+    }
+
+#ifdef Q_OS_UNIX
+    QString systemError(const char* call)
+    {
+        return QString("%1: %2").arg(call, QString::fromLocal8Bit(std::strerror(errno)));
+    }
+#endif
+}
+
+// -------------------------------------------------------------------------------------------------
+CoffeeMakerTelemetry::CoffeeMakerTelemetry(CoffeeMaker* maker, const QString& name)
+    : QObject(maker)
+    , maker_(maker)
+    , name_(posixName(name))
+{
+    connect(maker, &CoffeeMaker::currentStateChanged, this, &CoffeeMakerTelemetry::publish);
+    connect(maker, &CoffeeMaker::cupDetectedChanged, this, &CoffeeMakerTelemetry::publish);
+    connect(maker, &CoffeeMaker::waterContainerLevelChanged, this, &CoffeeMakerTelemetry::publish);
+    connect(maker, &CoffeeMaker::milkContainerLevelChanged, this, &CoffeeMakerTelemetry::publish);
+    connect(maker, &CoffeeMaker::beansContainerLevelChanged, this, &CoffeeMakerTelemetry::publish);
+    connect(maker, &CoffeeMaker::restBinLevelChanged, this, &CoffeeMakerTelemetry::publish);
+    connect(maker, &CoffeeMaker::overflowContainerLevelChanged, this, &CoffeeMakerTelemetry::publish);
+    connect(maker, &CoffeeMaker::cupsProcessedChanged, this, &CoffeeMakerTelemetry::publish);
+    connect(maker, &CoffeeMaker::levelsChanged, this, &CoffeeMakerTelemetry::publish);
+}
+
+// -------------------------------------------------------------------------------------------------
+CoffeeMakerTelemetry::~CoffeeMakerTelemetry()
+{
+#ifdef Q_OS_UNIX
+    if (!record_) return;
+    munmap(record_, sizeof(CoffeeMakerTelemetryRecord));
+    shm_unlink(name_.toLocal8Bit().constData());
+#endif
+}
+
+// -------------------------------------------------------------------------------------------------
+bool CoffeeMakerTelemetry::open()
+{
+#ifdef Q_OS_UNIX
+    if (record_) return true;
+
+    const auto name = name_.toLocal8Bit();
+    const auto fd = shm_open(name.constData(), O_CREAT | O_RDWR, 0644);
+    if (fd < 0) {
+        qWarning() << "Telemetry" << name_ << systemError("shm_open");
+        return false;
+    }
+    const auto size = sizeof(CoffeeMakerTelemetryRecord);
+    void* memory = MAP_FAILED;
+    if (ftruncate(fd, off_t(size)) == 0) {
+        memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    if (memory == MAP_FAILED) {
+        qWarning() << "Telemetry" << name_ << systemError("mmap");
+        close(fd);
+        shm_unlink(name.constData());
+        return false;
+    }
+    close(fd);
+
+    // A segment left behind by a previous run is reset, readers see it invalid until magic is set
+    record_ = new (memory) CoffeeMakerTelemetryRecord;
+    record_->magic.store(0, relaxed);
+    record_->version = CoffeeMakerTelemetryRecord::currentVersion;
+    record_->size = quint32(size);
+    record_->pid = qint32(getpid());
+    record_->sequence.store(0, relaxed);
+    publish();
+    record_->magic.store(CoffeeMakerTelemetryRecord::magicValue, std::memory_order_release);
+    return true;
+#else
+    qWarning() << "Telemetry" << name_ << "needs POSIX shared memory";
+    return false;
+#endif
+}
+
+// -------------------------------------------------------------------------------------------------
+void CoffeeMakerTelemetry::publish()
+{
+    if (!record_) return;
+    const auto metrics = maker_->metrics();
+
+    // Single writer seqlock: odd while writing, the release fence orders the odd value before the
+    // payload and the final release store orders the payload before the even value
+    const auto sequence = record_->sequence.load(relaxed);
+    record_->sequence.store(sequence + 1, relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    record_->state.store(metrics->state.load(relaxed), relaxed);
+    record_->cupDetected.store(maker_->cupDetected() ? 1 : 0, relaxed);
+    record_->water.store(maker_->waterContainerLevel(), relaxed);
+    record_->milk.store(maker_->milkContainerLevel(), relaxed);
+    record_->beans.store(maker_->beansContainerLevel(), relaxed);
+    record_->restBin.store(maker_->restBinLevel(), relaxed);
+    record_->overflow.store(maker_->overflowContainerLevel(), relaxed);
+    record_->cupsProcessed.store(maker_->cupsProcessed(), relaxed);
+    record_->waterMax.store(maker_->waterContainerMax(), relaxed);
+    record_->milkMax.store(maker_->milkContainerMax(), relaxed);
+    record_->beansMax.store(maker_->beansContainerMax(), relaxed);
+    record_->restBinMax.store(maker_->restBinLevelMax(), relaxed);
+    record_->overflowMax.store(maker_->overflowContainerMax(), relaxed);
+    record_->cupsUntilCleaning.store(maker_->maxCupsProcessedUntilCleanMode(), relaxed);
+    record_->cupsMadeTotal.store(metrics->cupsMadeTotal.load(relaxed), relaxed);
+    record_->updatedNs.store(monotonicNs(), relaxed);
+
+    record_->sequence.store(sequence + 2, std::memory_order_release);
+}
+
+// -------------------------------------------------------------------------------------------------
+qint64 CoffeeMakerTelemetry::monotonicNs()
+{
+#ifdef Q_OS_UNIX
+    timespec now {};
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return qint64(now.tv_sec) * 1000000000 + now.tv_nsec;
+#else
+    return 0;
+#endif
+}
+
+// -------------------------------------------------------------------------------------------------
+CoffeeMakerTelemetryReader::~CoffeeMakerTelemetryReader()
+{
+#ifdef Q_OS_UNIX
+    if (record_) munmap(const_cast<CoffeeMakerTelemetryRecord*>(record_), sizeof(CoffeeMakerTelemetryRecord));
+#endif
+}
+
+// -------------------------------------------------------------------------------------------------
+bool CoffeeMakerTelemetryReader::open(const QString& name)
+{
+#ifdef Q_OS_UNIX
+    if (record_) return true;
+
+    const auto fd = shm_open(posixName(name).toLocal8Bit().constData(), O_RDONLY, 0);
+    if (fd < 0) {
+        error_ = systemError("shm_open");
+        return false;
+    }
+    struct stat info {};
+    if (fstat(fd, &info) != 0 || size_t(info.st_size) < sizeof(CoffeeMakerTelemetryRecord)) {
+        error_ = "The segment is too small for telemetry version 1";
+        close(fd);
+        return false;
+    }
+    const auto memory = mmap(nullptr, sizeof(CoffeeMakerTelemetryRecord), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED) {
+        error_ = systemError("mmap");
+        return false;
+    }
+
+    const auto record = static_cast<const CoffeeMakerTelemetryRecord*>(memory);
+    if (record->magic.load(std::memory_order_acquire) != CoffeeMakerTelemetryRecord::magicValue
+        || record->version < CoffeeMakerTelemetryRecord::currentVersion) {
+        error_ = "The segment is not initialized or has an unknown layout";
+        munmap(memory, sizeof(CoffeeMakerTelemetryRecord));
+        return false;
+    }
+    record_ = record;
+    return true;
+#else
+    error_ = "POSIX shared memory is not available";
+    Q_UNUSED(name)
+    return false;
+#endif
+}
+
+// -------------------------------------------------------------------------------------------------
+quint32 CoffeeMakerTelemetryReader::sequence() const
+{
+    return record_ ? record_->sequence.load(std::memory_order_acquire) : 0;
+}
+
+// -------------------------------------------------------------------------------------------------
+bool CoffeeMakerTelemetryReader::read(CoffeeMakerTelemetry::Sample& sample, int maxRetries) const
+{
+    if (!record_) return false;
+
+    for (int attempt = 0; attempt <= maxRetries; ++attempt) {
+        const auto before = record_->sequence.load(std::memory_order_acquire);
+        if (before & 1) {
+            ++retries_;
+            std::this_thread::yield();
+            continue;
+        }
+
+        sample.sequence = before;
+        sample.pid = record_->pid;
+        sample.state = CoffeeMaker::State(record_->state.load(relaxed));
+        sample.cupDetected = record_->cupDetected.load(relaxed) != 0;
+        sample.levels.water = record_->water.load(relaxed);
+        sample.levels.milk = record_->milk.load(relaxed);
+        sample.levels.beans = record_->beans.load(relaxed);
+        sample.levels.restBin = record_->restBin.load(relaxed);
+        sample.levels.overflow = record_->overflow.load(relaxed);
+        sample.levels.cupsProcessed = record_->cupsProcessed.load(relaxed);
+        sample.maxima.water = record_->waterMax.load(relaxed);
+        sample.maxima.milk = record_->milkMax.load(relaxed);
+        sample.maxima.beans = record_->beansMax.load(relaxed);
+        sample.maxima.restBin = record_->restBinMax.load(relaxed);
+        sample.maxima.overflow = record_->overflowMax.load(relaxed);
+        sample.maxima.cupsProcessed = record_->cupsUntilCleaning.load(relaxed);
+        sample.cupsMadeTotal = record_->cupsMadeTotal.load(relaxed);
+        sample.updatedNs = record_->updatedNs.load(relaxed);
+
+        // The acquire fence orders the payload loads before the second sequence load
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (record_->sequence.load(relaxed) == before) return true;
+        ++retries_;
+    }
+    return false;
+}
@@ -0,0 +1,368 @@
+// Bio-Hybrid Coffee Machine Example - Copyright (c) 2021 Bio-Hybrid GmbH
+#include "consumptionlog.h"
+
+#include <QDateTime>
+#include <QFileInfo>
+#include <QTimer>
+#include <QtEndian>
+
+#include <algorithm>
+
+// -------------------------------------------------------------------------------------------------
+namespace {
+    constexpr quint32 fileMagic = 0x4C434D43; // "CMCL"
+    constexpr quint16 fileVersion = 1;
+    constexpr int fileHeaderBytes = 8;
+    constexpr char dictionaryEntry = 'D';
+    constexpr char blockEntry = 'B';
+    constexpr int columnCount = 8;
+    constexpr int blockHeaderBytes = 4 + 8 + 8 + 4 * columnCount;
+    constexpr int flushAfterMs = 10 * 60 * 1000;
+
+    enum Column { Timestamp, RecipeId, Beans, Water, Milk, GrindMs, BrewMs, MilkPrepMs };
+
+    template <typename T>
+    void appendLittleEndian(QByteArray& bytes, T value)
+    {
+        uchar buffer[sizeof(T)];
+        qToLittleEndian(value, buffer);
+        bytes.append(reinterpret_cast<const char*>(buffer), int(sizeof(T)));
+    }
+
+    /// Appends the difference to the previous value, zigzag so that small negative numbers stay short
+    void appendDelta(QByteArray& bytes, qint64 value, qint64 previous)
+    {
+        const auto delta = quint64(value) - quint64(previous);
+        auto zigzag = (delta << 1) ^ quint64(qint64(delta) >> 63);
+        while (zigzag >= 0x80) {
+            bytes.append(char(zigzag | 0x80));
+            zigzag >>= 7;
+        }
+        bytes.append(char(zigzag));
+    }
+
+    /// Decodes `rows` deltas, false if the column is cut short or malformed
+    bool decodeColumn(const uchar* p, const uchar* end, qint64* out, quint32 rows)
+    {
+        quint64 value = 0;
+        for (quint32 i = 0; i < rows; ++i) {
+            quint64 zigzag = 0;
+            for (int shift = 0;; shift += 7) {
+                if (p == end || shift > 63) return false;
+                const auto byte = *p++;
+                zigzag |= quint64(byte & 0x7f) << shift;
+                if (!(byte & 0x80)) break;
+            }
+            value += (zigzag >> 1) ^ (0 - (zigzag & 1));
+            out[i] = qint64(value);
+        }
+        return true;
+    }
+
+    qint64 bucketStart(qint64 ms, qint64 bucketMs)
+    {
+        const auto start = ms / bucketMs * bucketMs;
+        return start > ms ? start - bucketMs : start;
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+ConsumptionLog::ConsumptionLog(QObject* parent)
+    : QObject(parent)
+    , flushTimer_(new QTimer(this))
+{
+    flushTimer_->setSingleShot(true);
+    flushTimer_->setInterval(flushAfterMs);
+    connect(flushTimer_, &QTimer::timeout, this, &ConsumptionLog::flush);
+}
+
+// -------------------------------------------------------------------------------------------------
+ConsumptionLog::~ConsumptionLog()
+{
+    flush();
+}
+
+// -------------------------------------------------------------------------------------------------
+bool ConsumptionLog::open(const QString& fileName)
+{
+    qint64 validBytes = 0;
+    if (QFileInfo(fileName).size() > 0) {
+        // Continues the ids of the existing recipes, after the last intact block
+        ConsumptionLogReader reader;
+        if (!reader.open(fileName)) {
+            error_ = reader.errorString();
+            return false;
+        }
+        recipeIds_.clear();
+        for (int id = 0; id < reader.recipes().size(); ++id) recipeIds_.insert(reader.recipes()[id], id);
+        validBytes = reader.validBytes();
+    }
+
+    file_.setFileName(fileName);
+    if (!file_.open(QIODevice::ReadWrite)) {
+        error_ = file_.errorString();
+        return false;
+    }
+    if (validBytes == 0) {
+        QByteArray header;
+        appendLittleEndian(header, fileMagic);
+        appendLittleEndian(header, fileVersion);
+        appendLittleEndian(header, quint16(0));
+        file_.resize(0);
+        return write(header);
+    }
+    if (file_.size() > validBytes) file_.resize(validBytes);
+    return file_.seek(validBytes);
+}
+
+// -------------------------------------------------------------------------------------------------
+qint32 ConsumptionLog::recipeId(const QString& recipe)
+{
+    const auto found = recipeIds_.constFind(recipe);
+    if (found != recipeIds_.constEnd()) return found.value();
+
+    const auto id = qint32(recipeIds_.size());
+    recipeIds_.insert(recipe, id);
+    const auto name = recipe.toUtf8();
+    pendingDictionary_.append(dictionaryEntry);
+    appendLittleEndian(pendingDictionary_, quint32(id));
+    appendLittleEndian(pendingDictionary_, quint32(name.size()));
+    pendingDictionary_.append(name);
+    return id;
+}
+
+// -------------------------------------------------------------------------------------------------
+void ConsumptionLog::append(const ConsumptionRow& row)
+{
+    const std::array<qint64, columnCount> values = {
+        row.timestampMs, row.recipeId, row.beansGram, row.waterMl, row.milkMl,
+        row.grindMs, row.brewMs, row.milkPrepMs
+    };
+    for (size_t c = 0; c < values.size(); ++c) {
+        appendDelta(columns_[c], values[c], previous_[c]);
+        previous_[c] = values[c];
+    }
+
+    if (rows_ == 0) {
+        minMs_ = maxMs_ = row.timestampMs;
+        flushTimer_->start();
+    }
+    minMs_ = qMin(minMs_, row.timestampMs);
+    maxMs_ = qMax(maxMs_, row.timestampMs);
+    if (++rows_ == blockRows) flush();
+}
+
+// -------------------------------------------------------------------------------------------------
+void ConsumptionLog::record(const CoffeeMaker::Cup& cup)
+{
+    ConsumptionRow row;
+    row.timestampMs = cup.finishedMs;
+    row.recipeId = recipeId(cup.recipe);
+    row.beansGram = cup.beansGram;
+    row.waterMl = cup.waterMl;
+    row.milkMl = cup.milkMl;
+    row.grindMs = cup.grindMs;
+    row.brewMs = cup.brewMs;
+    row.milkPrepMs = cup.milkPrepMs;
+    append(row);
+}
+
+// -------------------------------------------------------------------------------------------------
+bool ConsumptionLog::flush()
+{
+    flushTimer_->stop();
+    if (rows_ == 0 && pendingDictionary_.isEmpty()) return true;
+
+    // The recipe names go first, a reader knows them before their rows
+    auto bytes = pendingDictionary_;
+    if (rows_ > 0) {
+        bytes.append(blockEntry);
+        appendLittleEndian(bytes, quint32(rows_));
+        appendLittleEndian(bytes, minMs_);
+        appendLittleEndian(bytes, maxMs_);
+        for (const auto& column : columns_) appendLittleEndian(bytes, quint32(column.size()));
+        for (const auto& column : columns_) bytes.append(column);
+    }
+
+    // Every block starts from zero, so blocks decode on their own
+    for (auto& column : columns_) column.clear();
+    previous_.fill(0);
+    rows_ = 0;
+    pendingDictionary_.clear();
+    return write(bytes);
+}
+
+// -------------------------------------------------------------------------------------------------
+bool ConsumptionLog::write(const QByteArray& bytes)
+{
+    if (!file_.isOpen()) {
+        error_ = "The log is not open";
+        return false;
+    }
+    if (file_.write(bytes) != bytes.size() || !file_.flush()) {
+        error_ = file_.errorString();
+        return false;
+    }
+    return true;
+}
+
+// -------------------------------------------------------------------------------------------------
+bool ConsumptionLogReader::open(const QString& fileName)
+{
+    fileName_ = fileName;
+    recipes_.clear();
+    blocks_.clear();
+    rowCount_ = 0;
+    validBytes_ = 0;
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        error_ = file.errorString();
+        return false;
+    }
+    uchar header[fileHeaderBytes];
+    if (file.read(reinterpret_cast<char*>(header), fileHeaderBytes) != fileHeaderBytes
+        || qFromLittleEndian<quint32>(header) != fileMagic
+        || qFromLittleEndian<quint16>(header + 4) != fileVersion) {
+        error_ = QString("%1 is not a consumption log of version %2").arg(fileName).arg(fileVersion);
+        return false;
+    }
+    validBytes_ = fileHeaderBytes;
+
+    // Entries are appended whole, an entry cut short can only be at the end
+    const auto size = file.size();
+    char type = 0;
+    while (file.getChar(&type)) {
+        if (type == dictionaryEntry) {
+            uchar entry[8];
+            if (file.read(reinterpret_cast<char*>(entry), 8) != 8) break;
+            const auto id = qFromLittleEndian<quint32>(entry);
+            const auto length = qFromLittleEndian<quint32>(entry + 4);
+            if (length > size - file.pos()) break;
+            if (id != quint32(recipes_.size())) {
+                error_ = QString("Recipe %1 out of order at byte %2").arg(id).arg(file.pos());
+                return false;
+            }
+            recipes_.append(QString::fromUtf8(file.read(length)));
+        } else if (type == blockEntry) {
+            uchar entry[blockHeaderBytes];
+            if (file.read(reinterpret_cast<char*>(entry), blockHeaderBytes) != blockHeaderBytes) break;
+            Block block;
+            block.rows = qFromLittleEndian<quint32>(entry);
+            block.minMs = qFromLittleEndian<qint64>(entry + 4);
+            block.maxMs = qFromLittleEndian<qint64>(entry + 12);
+            if (block.rows == 0 || block.rows > quint32(ConsumptionLog::blockRows) || block.minMs > block.maxMs) {
+                error_ = QString("Corrupt block at byte %1").arg(file.pos() - blockHeaderBytes - 1);
+                return false;
+            }
+            qint64 bytes = 0;
+            for (int c = 0; c < columnCount; ++c) {
+                block.sizes[size_t(c)] = qFromLittleEndian<quint32>(entry + 20 + 4 * c);
+                bytes += block.sizes[size_t(c)];
+            }
+            block.offset = file.pos();
+            if (bytes > size - block.offset) break;
+            file.seek(block.offset + bytes);
+            blocks_.push_back(block);
+            rowCount_ += block.rows;
+        } else {
+            error_ = QString("Unknown entry at byte %1").arg(file.pos() - 1);
+            return false;
+        }
+        validBytes_ = file.pos();
+    }
+    return true;
+}
+
+// -------------------------------------------------------------------------------------------------
+template <typename Visit>
+void ConsumptionLogReader::forEachBlock(qint64 fromMs, qint64 toMs, Visit visit) const
+{
+    QFile file(fileName_);
+    if (!file.open(QIODevice::ReadOnly)) return;
+
+    // One block at a time, the buffers are reused
+    QByteArray bytes;
+    std::array<std::vector<qint64>, columnCount> columns;
+    for (const auto& block : blocks_) {
+        if (block.maxMs < fromMs || block.minMs >= toMs) continue;
+        qint64 size = 0;
+        for (const auto columnSize : block.sizes) size += columnSize;
+        bytes.resize(int(size));
+        if (!file.seek(block.offset) || file.read(bytes.data(), size) != size) return;
+
+        auto p = reinterpret_cast<const uchar*>(bytes.constData());
+        for (int c = 0; c < columnCount; ++c) {
+            auto& column = columns[size_t(c)];
+            column.resize(block.rows);
+            const auto end = p + block.sizes[size_t(c)];
+            if (!decodeColumn(p, end, column.data(), block.rows)) return;
+            p = end;
+        }
+        visit(columns, block.rows);
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+std::vector<ConsumptionLogReader::Bucket> ConsumptionLogReader::aggregate(qint64 fromMs, qint64 toMs, qint64 bucketMs) const
+{
+    bucketMs = qMax<qint64>(1, bucketMs);
+    QHash<qint64, std::vector<Totals>> buckets; // by start, then by recipe id
+
+    forEachBlock(fromMs, toMs, [&](const std::array<std::vector<qint64>, columnCount>& c, quint32 rows) {
+        // Rows come in time order, the bucket is only looked up when it changes
+        std::vector<Totals>* bucket = nullptr;
+        qint64 start = 0;
+        for (quint32 i = 0; i < rows; ++i) {
+            const auto timestampMs = c[Timestamp][i];
+            const auto recipe = c[RecipeId][i];
+            if (timestampMs < fromMs || timestampMs >= toMs || recipe < 0 || recipe >= recipes_.size()) continue;
+            const auto rowStart = bucketStart(timestampMs, bucketMs);
+            if (!bucket || rowStart != start) {
+                start = rowStart;
+                bucket = &buckets[start];
+                if (bucket->size() < size_t(recipes_.size())) bucket->resize(size_t(recipes_.size()));
+            }
+            auto& totals = (*bucket)[size_t(recipe)];
+            ++totals.cups;
+            totals.beansGram += c[Beans][i];
+            totals.waterMl += c[Water][i];
+            totals.milkMl += c[Milk][i];
+            totals.grindMs += c[GrindMs][i];
+            totals.brewMs += c[BrewMs][i];
+            totals.milkPrepMs += c[MilkPrepMs][i];
+        }
+    });
+
+    std::vector<Bucket> result;
+    for (auto it = buckets.cbegin(); it != buckets.cend(); ++it) {
+        for (size_t recipe = 0; recipe < it.value().size(); ++recipe) {
+            if (it.value()[recipe].cups == 0) continue;
+            result.push_back({it.key(), qint32(recipe), it.value()[recipe]});
+        }
+    }
+    std::sort(result.begin(), result.end(), [](const Bucket& a, const Bucket& b) {
+        return a.startMs < b.startMs || (a.startMs == b.startMs && a.recipeId < b.recipeId);
+    });
+    return result;
+}
+
+// -------------------------------------------------------------------------------------------------
+void ConsumptionLogReader::scan(qint64 fromMs, qint64 toMs, const std::function<void(const ConsumptionRow&)>& visit) const
+{
+    forEachBlock(fromMs, toMs, [&](const std::array<std::vector<qint64>, columnCount>& c, quint32 rows) {
+        ConsumptionRow row;
+        for (quint32 i = 0; i < rows; ++i) {
+            row.timestampMs = c[Timestamp][i];
+            if (row.timestampMs < fromMs || row.timestampMs >= toMs) continue;
+            row.recipeId = qint32(c[RecipeId][i]);
+            row.beansGram = qint32(c[Beans][i]);
+            row.waterMl = qint32(c[Water][i]);
+            row.milkMl = qint32(c[Milk][i]);
+            row.grindMs = qint32(c[GrindMs][i]);
+            row.brewMs = qint32(c[BrewMs][i]);
+            row.milkPrepMs = qint32(c[MilkPrepMs][i]);
+            visit(row);
+        }
+    });
+}
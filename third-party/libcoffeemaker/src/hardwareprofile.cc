@@ -0,0 +1,54 @@
+// Bio-Hybrid Coffee Machine Example - Copyright (c) 2021 Bio-Hybrid GmbH
+#include "hardwareprofile.h"
+
+// -------------------------------------------------------------------------------------------------
+namespace {
+    const char* const modelNames[] = {"standard", "compact", "cafe"};
+
+    static_assert(std::variant_size<HardwareProfile>::value == sizeof(modelNames) / sizeof(modelNames[0]),
+                  "one name per profile");
+    static_assert(std::variant_alternative_t<size_t(HardwareModel::Standard), HardwareProfile>::model
+                  == HardwareModel::Standard, "profiles in the order of HardwareModel");
+    static_assert(std::variant_alternative_t<size_t(HardwareModel::Compact), HardwareProfile>::model
+                  == HardwareModel::Compact, "profiles in the order of HardwareModel");
+    static_assert(std::variant_alternative_t<size_t(HardwareModel::Cafe), HardwareProfile>::model
+                  == HardwareModel::Cafe, "profiles in the order of HardwareModel");
+}
+
+// -------------------------------------------------------------------------------------------------
+HardwareProfile hardwareProfile(HardwareModel model)
+{
+    switch (model) {
+    case HardwareModel::Compact:
+        return CompactProfile();
+    case HardwareModel::Cafe:
+        return CafeProfile();
+    case HardwareModel::Standard:
+        break;
+    }
+    return StandardProfile();
+}
+
+// -------------------------------------------------------------------------------------------------
+HardwareModel hardwareModel(const HardwareProfile& profile)
+{
+    return std::visit([](auto hardware) { return decltype(hardware)::model; }, profile);
+}
+
+// -------------------------------------------------------------------------------------------------
+QString hardwareModelName(HardwareModel model)
+{
+    return QString(modelNames[size_t(model)]);
+}
+
+// -------------------------------------------------------------------------------------------------
+bool parseHardwareModel(const QString& name, HardwareModel* model)
+{
+    for (size_t i = 0; i < sizeof(modelNames) / sizeof(modelNames[0]); ++i) {
+        if (name.compare(QLatin1String(modelNames[i]), Qt::CaseInsensitive) == 0) {
+            *model = HardwareModel(i);
+            return true;
+        }
+    }
+    return false;
+}
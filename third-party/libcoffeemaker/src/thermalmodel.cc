@@ -0,0 +1,118 @@
+// Bio-Hybrid Coffee Machine Example - Copyright (c) 2021 Bio-Hybrid GmbH
+#include "thermalmodel.h"
+
+#include <cmath>
+#include <limits>
+
+// -------------------------------------------------------------------------------------------------
+HeaterModel::HeaterModel()
+    : HeaterModel(Parameters())
+{
+}
+
+// -------------------------------------------------------------------------------------------------
+HeaterModel::HeaterModel(const Parameters& parameters)
+    : parameters_(parameters)
+    , temperatureC_(parameters.ambientC)
+{
+}
+
+// -------------------------------------------------------------------------------------------------
+void HeaterModel::setSetpoint(double setpointC)
+{
+    setpointC_ = setpointC;
+    on_ = true;
+}
+
+// -------------------------------------------------------------------------------------------------
+void HeaterModel::switchOff()
+{
+    on_ = false;
+}
+
+// -------------------------------------------------------------------------------------------------
+double HeaterModel::cooledC(double ms) const
+{
+    const auto tauS = parameters_.capacityJPerK / parameters_.lossWPerK;
+    return parameters_.ambientC + (temperatureC_ - parameters_.ambientC) * std::exp(-ms / 1000 / tauS);
+}
+
+// -------------------------------------------------------------------------------------------------
+void HeaterModel::advance(double ms)
+{
+    if (ms <= 0) return;
+    const auto& p = parameters_;
+    const auto tauS = p.capacityJPerK / p.lossWPerK;
+    const auto holdW = p.lossWPerK * (setpointC_ - p.ambientC);
+
+    if (!on_ || temperatureC_ > setpointC_) {
+        // Cooling, for a heater that is on only until it reaches the setpoint
+        auto coolMs = ms;
+        if (on_ && setpointC_ > p.ambientC) {
+            coolMs = std::fmin(ms, tauS * 1000 * std::log((temperatureC_ - p.ambientC) / (setpointC_ - p.ambientC)));
+        }
+        temperatureC_ = cooledC(coolMs);
+        if (coolMs < ms) {
+            temperatureC_ = setpointC_;
+            energyJ_ += holdW * (ms - coolMs) / 1000;
+        }
+        return;
+    }
+
+    const auto heatMs = std::fmin(ms, heatUpMs(setpointC_));
+    const auto equilibriumC = p.ambientC + p.powerW / p.lossWPerK;
+    temperatureC_ = equilibriumC + (temperatureC_ - equilibriumC) * std::exp(-heatMs / 1000 / tauS);
+    energyJ_ += p.powerW * heatMs / 1000;
+    if (heatMs < ms) {
+        temperatureC_ = setpointC_;
+        energyJ_ += holdW * (ms - heatMs) / 1000;
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+double HeaterModel::heatUpMs(double targetC) const
+{
+    if (temperatureC_ >= targetC) return 0;
+    const auto& p = parameters_;
+    const auto equilibriumC = p.ambientC + p.powerW / p.lossWPerK;
+    if (targetC >= equilibriumC) return std::numeric_limits<double>::infinity();
+    const auto tauS = p.capacityJPerK / p.lossWPerK;
+    return tauS * 1000 * std::log((equilibriumC - temperatureC_) / (equilibriumC - targetC));
+}
+
+// -------------------------------------------------------------------------------------------------
+PreheatForecast::PreheatForecast()
+    : PreheatForecast(Parameters())
+{
+}
+
+// -------------------------------------------------------------------------------------------------
+PreheatForecast::PreheatForecast(const Parameters& parameters)
+    : parameters_(parameters)
+    , meanGapMs_(parameters.priorGapMs)
+{
+}
+
+// -------------------------------------------------------------------------------------------------
+void PreheatForecast::recordOrder(double nowMs)
+{
+    if (lastOrderMs_ >= 0) {
+        const auto gapMs = nowMs - lastOrderMs_;
+        // The first gap replaces the prior
+        meanGapMs_ = gaps_++ == 0 ? gapMs : meanGapMs_ + parameters_.smoothing * (gapMs - meanGapMs_);
+    }
+    lastOrderMs_ = nowMs;
+}
+
+// -------------------------------------------------------------------------------------------------
+double PreheatForecast::meanGapMs(double nowMs) const
+{
+    const auto sinceLastMs = lastOrderMs_ >= 0 ? nowMs - lastOrderMs_ : 0;
+    return std::fmax(1.0, std::fmax(meanGapMs_, sinceLastMs));
+}
+
+// -------------------------------------------------------------------------------------------------
+double PreheatForecast::orderProbability(double nowMs) const
+{
+    return 1 - std::exp(-parameters_.horizonMs / meanGapMs(nowMs));
+}
@@ -0,0 +1,156 @@
+// Bio-Hybrid Coffee Machine Example - Copyright (c) 2021 Bio-Hybrid GmbH
+#include <coffeemaker/consumptionlog.h>
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QRandomGenerator>
+#include <QTextStream>
+
+#include <limits>
+
+// -------------------------------------------------------------------------------------------------
+namespace {
+    struct SyntheticRecipe {
+        const char* name;
+        qint32 beansGram;
+        qint32 waterMl;
+        qint32 milkMl;
+    };
+
+    const SyntheticRecipe syntheticRecipes[] = {
+        {"Espresso", 9, 40, 0}, {"Americano", 9, 150, 0}, {"Cappuccino", 9, 40, 120},
+        {"Latte Macchiato", 9, 40, 200}, {"Flat White", 18, 60, 110},
+    };
+
+    /// Appends `count` cups of a busy office, one every few minutes during the day
+    bool generate(const QString& fileName, int count, quint32 seed, QTextStream& out, QTextStream& err)
+    {
+        ConsumptionLog log;
+        if (!log.open(fileName)) {
+            err << fileName << ": " << log.errorString() << endl;
+            return false;
+        }
+        const auto sizeBefore = QFileInfo(fileName).size();
+
+        QRandomGenerator random(seed);
+        auto timestampMs = QDateTime::currentMSecsSinceEpoch() - qint64(count) * 150000;
+        QElapsedTimer timer;
+        timer.start();
+        for (int i = 0; i < count; ++i) {
+            const auto& recipe = syntheticRecipes[random.bounded(quint32(sizeof(syntheticRecipes) / sizeof(syntheticRecipes[0])))];
+            timestampMs += random.bounded(30000, 270000);
+            ConsumptionRow row;
+            row.timestampMs = timestampMs;
+            row.recipeId = log.recipeId(recipe.name);
+            row.beansGram = recipe.beansGram;
+            row.waterMl = recipe.waterMl;
+            row.milkMl = recipe.milkMl;
+            row.grindMs = 3000 + int(random.bounded(-40, 40));
+            row.brewMs = 3003 + int(random.bounded(0, 2000));
+            row.milkPrepMs = recipe.milkMl > 0 ? 3500 + int(random.bounded(0, 1500)) : 0;
+            log.append(row);
+        }
+        if (!log.flush()) {
+            err << fileName << ": " << log.errorString() << endl;
+            return false;
+        }
+        const auto elapsedS = double(timer.nsecsElapsed()) / 1e9;
+        const auto bytes = QFileInfo(fileName).size() - sizeBefore;
+        out << count << " rows in " << bytes << " bytes: " << double(bytes) / count << " bytes/row, "
+            << count / elapsedS << " rows/s written" << endl;
+        return true;
+    }
+
+    qint64 parseDate(const QString& text, qint64 fallback)
+    {
+        if (text.isEmpty()) return fallback;
+        const auto date = QDateTime::fromString(text, Qt::ISODate);
+        return date.isValid() ? date.toMSecsSinceEpoch() : fallback;
+    }
+}
+
+// Generates and aggregates consumption logs written with CoffeeMachine --consumption-log, e.g.:
+//   coffeemaker-consumption --log cups.log --generate 1000000
+//   coffeemaker-consumption --log cups.log --from 2021-06-01 --to 2021-06-08 --bucket 24
+int main(int argc, char** argv)
+{
+  QCoreApplication app(argc, argv);
+
+  QCommandLineParser parser;
+  parser.setApplicationDescription("Aggregates the consumption log of a CoffeeMaker");
+  parser.addHelpOption();
+  parser.addOption({"log", "Consumption log file.", "file"});
+  parser.addOption({"generate", "Append <n> synthetic cups first and report the log size.", "n"});
+  parser.addOption({"seed", "Random seed of --generate (default: 1).", "seed", "1"});
+  parser.addOption({"from", "First day or time of the report, ISO 8601 (default: everything).", "date"});
+  parser.addOption({"to", "End of the report, ISO 8601, exclusive.", "date"});
+  parser.addOption({"bucket", "Hours per row of the report (default: 1).", "hours", "1"});
+  parser.addOption({"summary", "Only print the totals per recipe and the scan rate."});
+  parser.process(app);
+
+  QTextStream out(stdout);
+  QTextStream err(stderr);
+
+  const auto fileName = parser.value("log");
+  if (fileName.isEmpty()) {
+    err << "No --log given" << endl;
+    return 1;
+  }
+  if (parser.isSet("generate")
+      && !generate(fileName, qMax(1, parser.value("generate").toInt()), parser.value("seed").toUInt(), out, err)) {
+    return 1;
+  }
+
+  ConsumptionLogReader reader;
+  if (!reader.open(fileName)) {
+    err << fileName << ": " << reader.errorString() << endl;
+    return 1;
+  }
+
+  const auto fromMs = parseDate(parser.value("from"), std::numeric_limits<qint64>::min());
+  const auto toMs = parseDate(parser.value("to"), std::numeric_limits<qint64>::max());
+  const auto bucketMs = qMax<qint64>(1, qint64(parser.value("bucket").toDouble() * 3600000));
+
+  QElapsedTimer timer;
+  timer.start();
+  const auto buckets = reader.aggregate(fromMs, toMs, bucketMs);
+  const auto elapsedS = double(timer.nsecsElapsed()) / 1e9;
+
+  std::vector<ConsumptionLogReader::Totals> totals(size_t(reader.recipes().size()));
+  for (const auto& bucket : buckets) {
+    auto& sum = totals[size_t(bucket.recipeId)];
+    sum.cups += bucket.totals.cups;
+    sum.beansGram += bucket.totals.beansGram;
+    sum.waterMl += bucket.totals.waterMl;
+    sum.milkMl += bucket.totals.milkMl;
+    sum.brewMs += bucket.totals.brewMs;
+  }
+
+  const auto header = [&](const char* first) {
+    out << qSetFieldWidth(18) << left << first << "recipe" << qSetFieldWidth(10) << "cups" << "beans g"
+        << "water ml" << "milk ml" << "brew s" << qSetFieldWidth(0) << '\n';
+  };
+  const auto row = [&](const QString& first, qint32 recipe, const ConsumptionLogReader::Totals& t) {
+    out << qSetFieldWidth(18) << left << first << reader.recipes().value(recipe) << qSetFieldWidth(10)
+        << t.cups << t.beansGram << t.waterMl << t.milkMl << t.brewMs / 1000 << qSetFieldWidth(0) << '\n';
+  };
+
+  if (!parser.isSet("summary")) {
+    header("from");
+    for (const auto& bucket : buckets) {
+      row(QDateTime::fromMSecsSinceEpoch(bucket.startMs).toString("yyyy-MM-dd hh:mm"), bucket.recipeId, bucket.totals);
+    }
+    out << '\n';
+  }
+  header("");
+  for (size_t recipe = 0; recipe < totals.size(); ++recipe) {
+    if (totals[recipe].cups > 0) row("total", qint32(recipe), totals[recipe]);
+  }
+
+  out << '\n' << reader.rowCount() << " rows, " << QFileInfo(fileName).size() << " bytes, aggregated in "
+      << elapsedS * 1000 << " ms: " << double(reader.rowCount()) / elapsedS << " rows/s" << endl;
+  return 0;
+}
@@ -0,0 +1,102 @@
+// Bio-Hybrid Coffee Machine Example - Copyright (c) 2021 Bio-Hybrid GmbH
+#include <coffeemaker/benchsupport.h>
+#include <coffeemaker/coffeemaker.h>
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QTextStream>
+
+// Runs complete brew cycles (start, grind, brew, milk, finish, clean and refill) with instant
+// steps and checks that after warm-up no state machine event comes from the heap, e.g.:
+//   coffeemaker-event-bench --cycles 10000
+int main(int argc, char** argv)
+{
+  QCoreApplication app(argc, argv);
+
+  QCommandLineParser parser;
+  parser.setApplicationDescription("Event allocations of the CoffeeMaker brew cycle");
+  parser.addHelpOption();
+  parser.addOption({"cycles", "Measured brew cycles (default: 10000).", "n", "10000"});
+  parser.addOption({"warm-up", "Brew cycles before measuring (default: 10).", "n", "10"});
+  parser.process(app);
+
+  const auto warmUpCycles = qMax(1, parser.value("warm-up").toInt());
+  const auto cycles = qMax(1, parser.value("cycles").toInt());
+
+  // The machine persists its levels and snapshots, keep them away from the real machine's settings
+  const SettingsSandbox settingsSandbox;
+
+  CoffeeMaker::Levels levels;
+  CoffeeMaker maker(levels);
+  maker.setTimeScale(0);
+
+  const auto refill = [&maker]() {
+    maker.cleanTheMachine();
+    maker.emptyRestBinContainer();
+    maker.emptyOverflowContainer();
+    maker.addBeanstoContainer(maker.beansContainerMax());
+    maker.addWatertoContainer(maker.waterContainerMax());
+    maker.addMilkToContainer(maker.milkContainerMax());
+  };
+  refill();
+  maker.placeCup();
+
+  QTextStream out(stdout);
+  QElapsedTimer timer;
+  CoffeeMaker::EventAllocations before;
+  int cycle = 0;
+  int step = 0;
+
+  // One cycle: StandBy -> CommandMode -> Grinding -> CommandMode -> Brewing -> CommandMode
+  //            -> PrepMilk -> CommandMode -> StandBy
+  QObject::connect(&maker, &CoffeeMaker::currentStateChanged, &maker, [&](CoffeeMaker::State state) {
+    switch (state) {
+    case CoffeeMaker::State::Off:
+      maker.turnOn();
+      break;
+    case CoffeeMaker::State::StandBy:
+      if (cycle == warmUpCycles) {
+        before = CoffeeMaker::eventAllocations();
+        timer.start();
+      }
+      if (cycle == warmUpCycles + cycles) {
+        app.quit();
+        return;
+      }
+      ++cycle;
+      step = 0;
+      refill();
+      maker.startCommandMode();
+      break;
+    case CoffeeMaker::State::CommandMode:
+      switch (step++) {
+      case 0: maker.doGrinding(14, CoffeeMaker::GrindLevel::Fine); break;
+      case 1: maker.doBrew(40, 92); break;
+      case 2: maker.doMilkPrep(100, 65, true); break;
+      default: maker.finishCommandMode(); break;
+      }
+      break;
+    case CoffeeMaker::State::SelfCheck:
+    case CoffeeMaker::State::Grinding:
+    case CoffeeMaker::State::Brewing:
+    case CoffeeMaker::State::PrepMilk:
+      break;
+    default:
+      out << "Unexpected state " << int(state) << " in cycle " << cycle << endl;
+      app.exit(2);
+      break;
+    }
+  });
+
+  if (app.exec() != 0) return 2;
+
+  const auto after = CoffeeMaker::eventAllocations();
+  const auto heap = after.heap - before.heap;
+  const auto pooled = after.pooled - before.pooled;
+  const auto seconds = double(timer.nsecsElapsed()) / 1e9;
+  out << cycles << " cycles in " << seconds << " s (" << double(cycles) / seconds << " cycles/s)\n"
+      << "events per cycle " << double(heap + pooled) / cycles << ", from the pool " << pooled
+      << ", from the heap " << heap << endl;
+  return heap == 0 ? 0 : 1;
+}
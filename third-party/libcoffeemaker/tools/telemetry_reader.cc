@@ -0,0 +1,99 @@
+// Bio-Hybrid Coffee Machine Example - Copyright (c) 2021 Bio-Hybrid GmbH
+#include <coffeemaker/coffeemakertelemetry.h>
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QMetaEnum>
+#include <QTextStream>
+#include <QThread>
+
+// -------------------------------------------------------------------------------------------------
+namespace {
+    const char* stateName(CoffeeMaker::State state) {
+        const auto& meta = CoffeeMaker::staticMetaObject;
+        const auto name = meta.enumerator(meta.indexOfEnumerator("State")).valueToKey(int(state));
+        return name ? name : "?";
+    }
+
+    void print(QTextStream& out, const CoffeeMakerTelemetry::Sample& s) {
+        const auto ageMs = (CoffeeMakerTelemetry::monotonicNs() - s.updatedNs) / 1000000;
+        out << "seq " << s.sequence << "  pid " << s.pid << "  age " << ageMs << " ms  "
+            << stateName(s.state) << (s.cupDetected ? "  cup" : "") << '\n'
+            << "  water " << s.levels.water << '/' << s.maxima.water
+            << "  milk " << s.levels.milk << '/' << s.maxima.milk
+            << "  beans " << s.levels.beans << '/' << s.maxima.beans
+            << "  rest bin " << s.levels.restBin << '/' << s.maxima.restBin
+            << "  overflow " << s.levels.overflow << '/' << s.maxima.overflow << '\n'
+            << "  cups " << s.levels.cupsProcessed << '/' << s.maxima.cupsProcessed
+            << " until cleaning, " << s.cupsMadeTotal << " total" << endl;
+    }
+}
+
+// Reads the telemetry segment of a running CoffeeMachine (started with --telemetry), e.g.:
+//   coffeemaker-telemetry --watch
+//   coffeemaker-telemetry --spin 5
+int main(int argc, char** argv)
+{
+  QCoreApplication app(argc, argv);
+
+  QCommandLineParser parser;
+  parser.setApplicationDescription("Reads the CoffeeMaker telemetry from shared memory");
+  parser.addHelpOption();
+  parser.addOption({"name", "Name of the segment.", "name", CoffeeMakerTelemetry::defaultName});
+  parser.addOption({"watch", "Print every update until interrupted."});
+  parser.addOption({"interval", "Poll interval for --watch in ms (default: 20).", "ms", "20"});
+  parser.addOption({"spin", "Read in a tight loop for <seconds> and report the read rate.", "seconds"});
+  parser.process(app);
+
+  QTextStream out(stdout);
+  QTextStream err(stderr);
+
+  CoffeeMakerTelemetryReader reader;
+  if (!reader.open(parser.value("name"))) {
+    err << "Cannot open " << parser.value("name") << ": " << reader.errorString() << endl;
+    return 1;
+  }
+
+  CoffeeMakerTelemetry::Sample sample;
+  if (parser.isSet("spin")) {
+    const auto durationNs = qint64(parser.value("spin").toDouble() * 1e9);
+    QElapsedTimer timer;
+    timer.start();
+    quint64 reads = 0;
+    quint64 failed = 0;
+    quint64 updates = 0;
+    auto lastSequence = reader.sequence();
+    while (timer.nsecsElapsed() < durationNs) {
+      for (int i = 0; i < 1024; ++i) {
+        if (!reader.read(sample)) ++failed;
+        if (sample.sequence != lastSequence) {
+          lastSequence = sample.sequence;
+          ++updates;
+        }
+      }
+      reads += 1024;
+    }
+    const auto elapsedNs = double(timer.nsecsElapsed());
+    out << reads << " reads in " << elapsedNs / 1e9 << " s: " << elapsedNs / double(reads) << " ns/read, "
+        << updates << " updates seen, " << reader.retries() << " retries, " << failed << " failed" << endl;
+    return 0;
+  }
+
+  if (!reader.read(sample)) {
+    err << "The writer did not finish an update" << endl;
+    return 1;
+  }
+  print(out, sample);
+  if (!parser.isSet("watch")) return 0;
+
+  const auto interval = qMax(1, parser.value("interval").toInt());
+  auto lastSequence = sample.sequence;
+  for (;;) {
+    QThread::msleep(quint32(interval));
+    if (reader.sequence() == lastSequence) continue;
+    if (!reader.read(sample)) continue;
+    lastSequence = sample.sequence;
+    print(out, sample);
+  }
+}
@@ -0,0 +1,77 @@
+// Bio-Hybrid Coffee Machine Example - Copyright (c) 2021 Bio-Hybrid GmbH
+#pragma once
+
+#include <QString>
+
+#include <memory>
+#include <vector>
+
+/// Distribution of the reply delays of the simulated backend
+class LatencyModel
+{
+public:
+    virtual ~LatencyModel() = default;
+
+    /// Returns the next reply delay in milliseconds
+    virtual quint32 sampleMs() = 0;
+};
+
+/// Uniformly distributed delays in [minMs, maxMs)
+class UniformLatency : public LatencyModel
+{
+public:
+    UniformLatency(quint32 minMs, quint32 maxMs);
+    quint32 sampleMs() override;
+
+private:
+    const quint32 minMs_;
+    const quint32 maxMs_;
+};
+
+/// Log-normally distributed delays (long tail), given by median and shape sigma
+class LogNormalLatency : public LatencyModel
+{
+public:
+    LogNormalLatency(double medianMs, double sigma);
+    quint32 sampleMs() override;
+
+private:
+    const double mu_;
+    const double sigma_;
+};
+
+/// Delays drawn from a set of recorded delays
+class RecordedLatency : public LatencyModel
+{
+public:
+    explicit RecordedLatency(std::vector<quint32> samplesMs);
+
+    /// Reads recorded delays from a text file with one delay in milliseconds per line,
+    /// returns nullptr if the file can not be read or has no delays
+    static std::unique_ptr<RecordedLatency> fromFile(const QString& fileName);
+
+    quint32 sampleMs() override;
+
+private:
+    const std::vector<quint32> samplesMs_;
+};
+
+/// Behavior of the simulated CoffeeWeb backend
+struct BackendModel
+{
+    /// Reply delays, nullptr: uniform between a quarter and 9/8 of the request timeout
+    std::shared_ptr<LatencyModel> latency;
+
+    /// Probability of a reply with return code 408 (request timed out)
+    double timeoutErrorRate = 0.0;
+
+    /// Probability of a reply with return code 500 (server error)
+    double serverErrorRate = 0.0;
+
+    /// The recipes of the collection are repeated this many times in every reply
+    int payloadScale = 1;
+
+    /// Reply delays and request timeouts are multiplied by this factor, e.g. 0.001 to simulate
+    /// hours of traffic in seconds
+    double timeScale = 1.0;
+};
@@ -1,7 +1,13 @@
 // Bio-Hybrid Coffee Machine Example - Copyright (c) 2021 Bio-Hybrid GmbH
 #pragma once
 
+#include "backendmodel.h"
+#include "coffeewebmetrics.h"
+#include "recipe.h"
+
 #include <QObject>
+#include <QUrl>
+#include <QVector>
 #include <memory>
 
 class CoffeeWeb : public QObject
@@ -15,12 +21,47 @@ public:
     /// Request recipes, returns a request id.
     quint32 requestRecipes(quint32 timeoutMs = 4000, bool forceTimeout = false);
 
+    /// Request recipes as a stream, returns a request id.
+    /// Recipes are delivered in batches via recipesChunkReceived as soon as they are
+    /// decoded, followed by a single recipesStreamFinished.
+    quint32 requestRecipesStreamed(quint32 timeoutMs = 4000, bool forceTimeout = false);
+
+    /// Cancels a pending request, no further signals are emitted for it
+    void cancelRequest(quint32 id);
+
+    /// Sets the JSON file the recipes are served from (default: the bundled recipes)
+    void setRecipesSource(const QString& fileName);
+
+    /// Sets latency, error rates and payload size of the simulated backend
+    void setBackendModel(const BackendModel& model);
+    BackendModel backendModel() const;
+
+    /// Fetches the recipes via HTTP from the given url instead of the simulated backend,
+    /// an empty url switches back to the simulation. With forceTimeout set, HTTP requests
+    /// time out immediately.
+    void setBackendUrl(const QUrl& url);
+    QUrl backendUrl() const;
+
+    /// Returns the request metrics, which may be read from any thread
+    std::shared_ptr<const CoffeeWebMetrics> metrics() const;
+
 signals:
     /// Emitted when results are ready for a request id,
     /// when an error occured this is visible in the 'return_code' and
     /// 'error_message' properties in the json object.
     void recipesRequestReply(quint32 id, const QString& recipesJson);
 
+    /// Emitted for a streamed request before its first recipe batch, with the collection
+    /// properties that precede the recipes in the reply (empty if they follow them)
+    void recipesCollectionReceived(quint32 id, const QString& collectionName, const QString& collectionVersion);
+
+    /// Emitted for every batch of recipes decoded for a streamed request
+    void recipesChunkReceived(quint32 id, const QVector<Recipe>& recipes);
+
+    /// Emitted when a streamed request is complete, 'returnCode' and 'errorMessage'
+    /// have the same meaning as in the json object.
+    void recipesStreamFinished(quint32 id, int returnCode, const QString& errorMessage);
+
 private:
   struct Impl;
   std::unique_ptr<Impl> impl_;
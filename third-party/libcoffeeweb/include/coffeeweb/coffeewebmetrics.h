@@ -0,0 +1,29 @@
+// Bio-Hybrid Coffee Machine Example - Copyright (c) 2021 Bio-Hybrid GmbH
+#pragma once
+
+#include <QtGlobal>
+
+#include <array>
+#include <atomic>
+
+/// Counters of the recipe requests of a CoffeeWeb.
+///
+/// Written on the CoffeeWeb thread with relaxed atomics, readable from any thread without
+/// locking, e.g. by a metrics exporter.
+struct CoffeeWebMetrics
+{
+    /// Upper bounds of the request latency histogram buckets in milliseconds
+    static constexpr std::array<quint32, 10> latencyBucketsMs = {{10, 25, 50, 100, 250, 500, 1000, 2500, 5000, 10000}};
+
+    std::atomic<quint64> requestsStarted {0};
+    std::atomic<quint64> requestsCancelled {0};
+
+    std::atomic<quint64> repliesOk {0};          ///< return code 200
+    std::atomic<quint64> repliesTimeout {0};     ///< return code 408
+    std::atomic<quint64> repliesServerError {0}; ///< return code 500
+    std::atomic<quint64> repliesOther {0};
+
+    /// Finished requests per latency bucket (not cumulative), the last one is above all bounds
+    std::array<std::atomic<quint64>, latencyBucketsMs.size() + 1> latencyBuckets {};
+    std::atomic<quint64> latencySumUs {0};
+};
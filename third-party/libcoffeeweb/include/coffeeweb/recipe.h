@@ -0,0 +1,33 @@
+// Bio-Hybrid Coffee Machine Example - Copyright (c) 2021 Bio-Hybrid GmbH
+#pragma once
+
+#include <QJsonObject>
+#include <QMetaType>
+#include <QString>
+#include <QVector>
+
+/// A single coffee recipe, as described in the recipes JSON format.
+struct Recipe
+{
+    QString name;
+    int beansGram = 0;
+    QString grindLevel;
+    int waterMl = 0;
+    int waterTemp = 0;
+
+    bool hasMilk = false;
+    int milkMl = 0;
+    int milkTemp = 0;
+    int foamMl = 0;
+
+    /// Creates a recipe from a JSON recipe object
+    static Recipe fromJson(const QJsonObject& object);
+
+    /// Returns the recipe as JSON object (same layout as in the recipes JSON)
+    QJsonObject toJson() const;
+
+    bool operator==(const Recipe& other) const;
+    bool operator!=(const Recipe& other) const { return !(*this == other); }
+};
+
+Q_DECLARE_METATYPE(Recipe)
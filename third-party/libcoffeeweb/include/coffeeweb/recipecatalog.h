@@ -0,0 +1,66 @@
+// Bio-Hybrid Coffee Machine Example - Copyright (c) 2021 Bio-Hybrid GmbH
+#pragma once
+
+#include "recipe.h"
+
+#include <QByteArray>
+#include <QString>
+
+#include <memory>
+
+class QJsonDocument;
+
+/// Read-only view on a compiled binary recipe catalog.
+///
+/// The catalog file is memory-mapped, records are read in place: opening a catalog
+/// validates the header, the name index and the string references, no recipe is parsed or
+/// copied.
+/// Catalogs are produced by `RecipeCatalog::compile()` (see the `recipe-compiler` tool).
+class RecipeCatalog
+{
+public:
+    /// Version of the binary layout written by compile()
+    static constexpr quint32 formatVersion = 1;
+
+    RecipeCatalog();
+    ~RecipeCatalog();
+
+    RecipeCatalog(const RecipeCatalog&) = delete;
+    RecipeCatalog& operator=(const RecipeCatalog&) = delete;
+
+    /// Maps the given catalog file (also works for uncompressed Qt resources),
+    /// returns false and sets errorString() if the file is not a valid catalog.
+    bool open(const QString& fileName);
+
+    /// Unmaps the current catalog
+    void close();
+
+    /// Returns if a catalog is mapped
+    bool isOpen() const;
+
+    /// Returns a description of the last error
+    QString errorString() const;
+
+    /// Returns the number of recipes in the catalog
+    int count() const;
+
+    QString collectionName() const;
+    QString collectionVersion() const;
+
+    /// Returns the UTF-8 name of the recipe at index without copying (valid while open)
+    QByteArray nameUtf8(int index) const;
+
+    /// Returns the recipe at index
+    Recipe recipe(int index) const;
+
+    /// Returns the index of the recipe with the given name (binary search), or -1
+    int indexOf(const QString& name) const;
+
+    /// Compiles a recipes JSON document into the binary catalog format.
+    /// Returns an empty array and sets errorString if the document is invalid.
+    static QByteArray compile(const QJsonDocument& document, QString* errorString = nullptr);
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> impl_;
+};
@@ -0,0 +1,70 @@
+// Bio-Hybrid Coffee Machine Example - Copyright (c) 2021 Bio-Hybrid GmbH
+#pragma once
+
+#include "recipe.h"
+
+#include <QString>
+#include <QVector>
+
+#include <climits>
+#include <unordered_map>
+#include <vector>
+
+/// Search index over a list of recipes.
+///
+/// Supports case-insensitive prefix search on the words of a recipe name, fuzzy
+/// (trigram based, typo tolerant) name search and range filters on beans, water and
+/// milk presence. Results are row numbers into the indexed list, in ascending order.
+class RecipeIndex
+{
+public:
+    enum class Milk { Any, With, Without };
+
+    struct Filter
+    {
+        QString text;               ///< name query, empty matches all recipes
+        bool fuzzy = true;          ///< also match names with typos when there is no prefix match
+        int minBeansGram = 0;
+        int maxBeansGram = INT_MAX;
+        int minWaterMl = 0;
+        int maxWaterMl = INT_MAX;
+        Milk milk = Milk::Any;
+
+        /// Returns if the filter matches every recipe
+        bool isEmpty() const;
+    };
+
+    /// (Re)builds the index for the given recipes
+    void build(const QVector<Recipe>& recipes);
+
+    /// Removes all recipes from the index
+    void clear();
+
+    /// Returns the number of indexed recipes
+    int size() const { return int(beans_.size()); }
+
+    /// Returns the rows whose name has a word starting with prefix
+    std::vector<int> prefixMatches(const QString& prefix) const;
+
+    /// Returns the rows whose name is similar to query (shares most of its trigrams)
+    std::vector<int> fuzzyMatches(const QString& query) const;
+
+    /// Returns the rows matching the filter
+    std::vector<int> query(const Filter& filter) const;
+
+private:
+    struct WordEntry {
+        QString word; ///< case folded name, starting at a word boundary
+        int row;
+    };
+
+    bool matchesRanges(int row, const Filter& filter) const;
+
+    std::vector<WordEntry> words_;                        // sorted by word
+    std::unordered_map<quint64, std::vector<int>> trigrams_; // trigram -> rows
+    std::vector<int> rowsByBeans_;                        // rows sorted by beans
+    std::vector<int> beans_;
+    std::vector<int> water_;
+    std::vector<quint8> hasMilk_;
+    mutable std::vector<quint16> hitCounts_;              // scratch buffer for fuzzy search
+};
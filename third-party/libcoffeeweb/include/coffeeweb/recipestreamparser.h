@@ -0,0 +1,103 @@
+// Bio-Hybrid Coffee Machine Example - Copyright (c) 2021 Bio-Hybrid GmbH
+#pragma once
+
+#include "recipe.h"
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+#include <functional>
+#include <vector>
+
+/// Incremental (SAX-style) parser for the recipes JSON format.
+///
+/// The input can be fed in chunks of any size. Recipes are handed out in batches as soon
+/// as they are decoded, so memory use depends on the batch size and the longest token,
+/// but not on the size of the collection.
+class RecipeStreamParser
+{
+public:
+    using BatchHandler = std::function<void(const QVector<Recipe>& recipes)>;
+    using CollectionHandler = std::function<void()>;
+
+    explicit RecipeStreamParser(BatchHandler handler, int batchSize = 64);
+
+    /// Sets a handler that is called when the recipes array starts, i.e. when the
+    /// collection properties that precede it (name, version) are known
+    void setCollectionHandler(CollectionHandler handler) { collectionHandler_ = std::move(handler); }
+
+    /// Parses the next chunk of input, returns false on a syntax error
+    bool feed(const char* data, qint64 size);
+    bool feed(const QByteArray& data) { return feed(data.constData(), data.size()); }
+
+    /// Signals the end of input, flushes the remaining recipes.
+    /// Returns false if the document is incomplete or had an error.
+    bool finish();
+
+    /// Resets the parser for a new document
+    void reset();
+
+    /// Stops parsing, also from within a handler: feed() returns false for the rest of the document
+    void abort();
+
+    bool hasError() const { return failed_; }
+    QString errorString() const { return errorString_; }
+
+    /// Top-level properties of the document (available as soon as they were parsed)
+    int returnCode() const { return returnCode_; }
+    QString errorMessage() const { return errorMessage_; }
+    QString collectionName() const { return collectionName_; }
+    QString collectionVersion() const { return collectionVersion_; }
+
+    /// Number of recipes decoded so far
+    qint64 recipesParsed() const { return recipesParsed_; }
+
+private:
+    enum class Lex { Default, String, StringEscape, StringUnicode, Number, Literal };
+    enum class Role { Root, Recipes, Recipe, Milk, Other };
+    /// The tokens a container accepts next, "End" is its closing bracket
+    enum class Expect { KeyOrEnd, Key, Colon, ValueOrEnd, Value, CommaOrEnd };
+
+    struct Level {
+        bool isObject = false;
+        Expect expect = Expect::KeyOrEnd;
+        Role role = Role::Other;
+        QByteArray key;
+    };
+
+    bool process(char c);
+    bool onSeparator(char c);
+    bool beginContainer(bool isObject);
+    bool endContainer(bool isObject);
+    bool onString();
+    bool onPrimitive(bool isNumber);
+    bool expectValue();
+    void valueDone();
+    void flush();
+    bool unexpected(const QString& token);
+    bool setError(const QString& error);
+
+    BatchHandler handler_;
+    CollectionHandler collectionHandler_;
+    int batchSize_ = 64;
+
+    Lex lex_ = Lex::Default;
+    QByteArray token_;
+    QByteArray unicode_;
+    ushort highSurrogate_ = 0;
+    qint64 offset_ = 0;
+    bool done_ = false;
+    std::vector<Level> stack_;
+
+    Recipe recipe_;
+    QVector<Recipe> batch_;
+
+    bool failed_ = false;
+    QString errorString_;
+    int returnCode_ = 0;
+    QString errorMessage_;
+    QString collectionName_;
+    QString collectionVersion_;
+    qint64 recipesParsed_ = 0;
+};
@@ -0,0 +1,62 @@
+// Bio-Hybrid Coffee Machine Example - Copyright (c) 2021 Bio-Hybrid GmbH
+#include "backendmodel.h"
+
+#include <QFile>
+#include <QRandomGenerator>
+
+#include <cmath>
+#include <random>
+
+// -------------------------------------------------------------------------------------------------
+UniformLatency::UniformLatency(quint32 minMs, quint32 maxMs)
+    : minMs_(minMs), maxMs_(qMax(minMs + 1, maxMs))
+{
+}
+
+// -------------------------------------------------------------------------------------------------
+quint32 UniformLatency::sampleMs()
+{
+    return QRandomGenerator::global()->bounded(minMs_, maxMs_);
+}
+
+// -------------------------------------------------------------------------------------------------
+LogNormalLatency::LogNormalLatency(double medianMs, double sigma)
+    : mu_(std::log(qMax(1.0, medianMs))), sigma_(qMax(0.0, sigma))
+{
+}
+
+// -------------------------------------------------------------------------------------------------
+quint32 LogNormalLatency::sampleMs()
+{
+    std::lognormal_distribution<double> distribution(mu_, sigma_);
+    return quint32(qBound(0.0, distribution(*QRandomGenerator::global()), 3600.0 * 1000));
+}
+
+// -------------------------------------------------------------------------------------------------
+RecordedLatency::RecordedLatency(std::vector<quint32> samplesMs)
+    : samplesMs_(std::move(samplesMs))
+{
+}
+
+// -------------------------------------------------------------------------------------------------
+std::unique_ptr<RecordedLatency> RecordedLatency::fromFile(const QString& fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QFile::ReadOnly | QFile::Text)) return nullptr;
+
+    std::vector<quint32> samples;
+    while (!file.atEnd()) {
+        bool ok = false;
+        const auto value = file.readLine().trimmed().toUInt(&ok);
+        if (ok) samples.push_back(value);
+    }
+    if (samples.empty()) return nullptr;
+    return std::make_unique<RecordedLatency>(std::move(samples));
+}
+
+// -------------------------------------------------------------------------------------------------
+quint32 RecordedLatency::sampleMs()
+{
+    if (samplesMs_.empty()) return 0;
+    return samplesMs_[QRandomGenerator::global()->bounded(quint32(samplesMs_.size()))];
+}
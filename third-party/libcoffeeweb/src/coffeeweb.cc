@@ -1,15 +1,32 @@
 // Bio-Hybrid Coffee Machine Example - Copyright (c) 2021 Bio-Hybrid GmbH
 #include "coffeeweb.h"
+#include "httptransport.h"
+#include "recipestreamparser.h"
 
+#include <QBuffer>
+#include <QElapsedTimer>
 #include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
 #include <QRandomGenerator>
 #include <QTimer>
-#include <QTextStream>
 
+#include <algorithm>
+#include <climits>
+#include <functional>
 #include <map>
 
 // -------------------------------------------------------------------------------------------------
 namespace {
+    constexpr auto bundledRecipes = ":/recipes.json";
+    constexpr qint64 streamChunkSize = 16 * 1024;
+
+    QString errorReply(int returnCode, const QString& errorMessage) {
+        const QJsonObject reply {{"return_code", returnCode}, {"error_message", errorMessage}};
+        return QString::fromUtf8(QJsonDocument(reply).toJson(QJsonDocument::Compact));
+    }
+
     struct RequestTimers
     {
         RequestTimers(QTimer* replyTimer, QTimer* timeoutTimer)
@@ -30,88 +47,416 @@ namespace {
         QTimer* timeoutTimer_ = nullptr;
     };
 
+    struct RecipeStream
+    {
+        RecipeStream(std::unique_ptr<QIODevice> device, RecipeStreamParser::BatchHandler handler)
+            : device_(std::move(device)), parser_(std::move(handler)) {}
 
-
+        std::unique_ptr<QIODevice> device_;
+        RecipeStreamParser parser_;
+        bool cancelled_ = false;
+    };
 }
 
+constexpr std::array<quint32, 10> CoffeeWebMetrics::latencyBucketsMs;
+
 // -------------------------------------------------------------------------------------------------
 struct CoffeeWeb::Impl
 {
     Impl(CoffeeWeb* parent)
         : parent_(parent)
         , nextRequestId_(QRandomGenerator::global()->generate()) // random request id at start.
+        , metrics_(std::make_shared<CoffeeWebMetrics>())
     {
+        clock_.start();
     }
 
+    using ReplyHandler = std::function<void(quint32 requestId)>;
+    using ErrorHandler = std::function<void(quint32 requestId, int returnCode, const QString& errorMessage)>;
+
+    quint32 startRequest(quint32 timeoutMs, bool forceTimeout, ReplyHandler onReply, ErrorHandler onError);
+    QByteArray payload();
+    void readStreamChunk(quint32 requestId);
+    void finishStream(quint32 requestId, int returnCode, const QString& errorMessage);
+    void feedHttpStream(quint32 requestId, const QByteArray& chunk);
+    void finishHttpStream(quint32 requestId, int returnCode, const QString& errorMessage);
+    quint32 requestStarted();
+    void requestFinished(quint32 requestId, int returnCode);
+
     CoffeeWeb* const parent_ = nullptr;
     quint32 nextRequestId_ = 0;
     std::map<uint32_t, std::unique_ptr<RequestTimers>> requests_;
+    std::map<uint32_t, std::unique_ptr<RecipeStream>> streams_;
+
+    QString recipesSource_ = bundledRecipes;
+    BackendModel model_;
+    QByteArray cachedPayload_;
+    QString cachedReply_;
+
+    std::unique_ptr<HttpTransport> http_;
+
+    const std::shared_ptr<CoffeeWebMetrics> metrics_;
+    QElapsedTimer clock_;
+    std::map<uint32_t, qint64> startedNs_;
 };
 
 // -------------------------------------------------------------------------------------------------
-CoffeeWeb::CoffeeWeb(QObject* parent)
-    : QObject(parent)
-    , impl_(std::make_unique<Impl>(this))
+quint32 CoffeeWeb::Impl::requestStarted()
 {
-    Q_INIT_RESOURCE(json);
+    const auto requestId = nextRequestId_++;
+    startedNs_[requestId] = clock_.nsecsElapsed();
+    metrics_->requestsStarted.fetch_add(1, std::memory_order_relaxed);
+    return requestId;
 }
 
 // -------------------------------------------------------------------------------------------------
-CoffeeWeb::~CoffeeWeb() = default;
+void CoffeeWeb::Impl::requestFinished(quint32 requestId, int returnCode)
+{
+    const auto it = startedNs_.find(requestId);
+    if (it == startedNs_.end()) return;
+    const auto latencyUs = quint64((clock_.nsecsElapsed() - it->second) / 1000);
+    startedNs_.erase(it);
+
+    auto& replies = returnCode == 200 ? metrics_->repliesOk
+                  : returnCode == 408 ? metrics_->repliesTimeout
+                  : returnCode == 500 ? metrics_->repliesServerError
+                  : metrics_->repliesOther;
+    replies.fetch_add(1, std::memory_order_relaxed);
+
+    const auto& bounds = CoffeeWebMetrics::latencyBucketsMs;
+    const auto bucket = std::lower_bound(bounds.begin(), bounds.end(), quint32(qMin<quint64>(latencyUs / 1000, UINT_MAX)))
+                      - bounds.begin();
+    metrics_->latencyBuckets[size_t(bucket)].fetch_add(1, std::memory_order_relaxed);
+    metrics_->latencySumUs.fetch_add(latencyUs, std::memory_order_relaxed);
+}
 
 // -------------------------------------------------------------------------------------------------
-quint32 CoffeeWeb::requestRecipes(quint32 timeoutMs, bool forceTimeout)
+quint32 CoffeeWeb::Impl::startRequest(quint32 timeoutMs, bool forceTimeout, ReplyHandler onReply, ErrorHandler onError)
 {
-    const auto requestId = impl_->nextRequestId_++;
+    const auto requestId = requestStarted();
+
+    const auto scaled = [this](quint32 ms) { return int(double(ms) * model_.timeScale + 0.5); };
 
-    const auto timeoutTimer = new QTimer(this);
+    const auto timeoutTimer = new QTimer(parent_);
     timeoutTimer->setSingleShot(true);
-    timeoutTimer->setInterval(timeoutMs);
+    timeoutTimer->setInterval(scaled(timeoutMs));
 
-    // fake a random reply time, that sometimes is also longer than the timeout time
-    // in milliseconds - therefore the request would time out..
-    const auto replyTimer = new QTimer(this);
+    // fake a reply time from the latency model, by default random and sometimes also longer
+    // than the timeout time in milliseconds - therefore the request would time out..
+    const auto replyTimer = new QTimer(parent_);
     replyTimer->setSingleShot(true);
     if (forceTimeout) {
-        replyTimer->setInterval(timeoutMs + 1000);
+        replyTimer->setInterval(scaled(timeoutMs + 1000));
+    } else if (model_.latency) {
+        replyTimer->setInterval(scaled(model_.latency->sampleMs()));
     } else {
-        replyTimer->setInterval(QRandomGenerator::global()->bounded(
-                                    timeoutMs/4, timeoutMs + timeoutMs / 8));
+        replyTimer->setInterval(scaled(QRandomGenerator::global()->bounded(
+                                    timeoutMs/4, timeoutMs + timeoutMs / 8)));
     }
 
-    connect(timeoutTimer, &QTimer::timeout, this,
-    [this, requestId]() {
-        const auto it = impl_->requests_.find(requestId);
-        if (it != impl_->requests_.end()) {
-            impl_->requests_.erase(it);
+    QObject::connect(timeoutTimer, &QTimer::timeout, parent_,
+    [this, requestId, onError]() {
+        const auto it = requests_.find(requestId);
+        if (it != requests_.end()) {
+            requests_.erase(it);
         }
-        static const QString timeoutReply(R"({"return_code":408, "error_message": "Request timed out."}})");
-        emit recipesRequestReply(requestId, timeoutReply);
+        onError(requestId, 408, "Request timed out.");
     });
 
-    connect(replyTimer, &QTimer::timeout, this,
-    [this, requestId]() {
-        const auto it = impl_->requests_.find(requestId);
-        if (it != impl_->requests_.end()) {
-            impl_->requests_.erase(it);
+    QObject::connect(replyTimer, &QTimer::timeout, parent_,
+    [this, requestId, onReply, onError]() {
+        const auto it = requests_.find(requestId);
+        if (it != requests_.end()) {
+            requests_.erase(it);
         }
-        static const QString requestReply(R"({"return_code":200, "error_message": ""}})");
-        static const QString requestReplyOk = []()
-        {
-            QFile file(":/recipes.json");
-            if (!file.open(QFile::ReadOnly | QFile::Text)) {
-                return QString(R"({"return_code":500, "error_message": "Could not read file."}})");
-            }
-            QTextStream in(&file);
-            return in.readAll();
-        }();
 
-        emit recipesRequestReply(requestId, requestReplyOk);
+        // simulated backend errors
+        const auto draw = QRandomGenerator::global()->generateDouble();
+        if (draw < model_.timeoutErrorRate) {
+            onError(requestId, 408, "Request timed out.");
+        } else if (draw < model_.timeoutErrorRate + model_.serverErrorRate) {
+            onError(requestId, 500, "Internal server error.");
+        } else {
+            onReply(requestId);
+        }
     });
 
-    impl_->requests_.emplace(requestId, std::make_unique<RequestTimers>(replyTimer, timeoutTimer));
+    requests_.emplace(requestId, std::make_unique<RequestTimers>(replyTimer, timeoutTimer));
     replyTimer->start();
     timeoutTimer->start();
 
     return requestId;
 }
+
+// -------------------------------------------------------------------------------------------------
+QByteArray CoffeeWeb::Impl::payload()
+{
+    if (!cachedPayload_.isEmpty()) return cachedPayload_;
+
+    QFile file(recipesSource_);
+    if (!file.open(QFile::ReadOnly)) return {};
+    cachedPayload_ = file.readAll();
+    if (model_.payloadScale <= 1) return cachedPayload_;
+
+    // repeat the recipes, names get a suffix to stay unique
+    auto root = QJsonDocument::fromJson(cachedPayload_).object();
+    const auto recipes = root.value("recipes").toArray();
+    QJsonArray scaled;
+    for (int copy = 0; copy < model_.payloadScale; ++copy) {
+        for (const auto& value : recipes) {
+            auto recipe = value.toObject();
+            if (copy) recipe.insert("name", QString("%1 #%2").arg(recipe.value("name").toString()).arg(copy + 1));
+            scaled.append(recipe);
+        }
+    }
+    root.insert("recipes", scaled);
+    cachedPayload_ = QJsonDocument(root).toJson(QJsonDocument::Compact);
+    return cachedPayload_;
+}
+
+// -------------------------------------------------------------------------------------------------
+void CoffeeWeb::Impl::readStreamChunk(quint32 requestId)
+{
+    const auto it = streams_.find(requestId);
+    if (it == streams_.end()) return;
+    auto& stream = *it->second;
+    if (stream.cancelled_) {
+        streams_.erase(it);
+        return;
+    }
+
+    const auto chunk = stream.device_->read(streamChunkSize);
+    if (!stream.parser_.feed(chunk)) {
+        if (stream.cancelled_) {
+            streams_.erase(it);
+        } else {
+            finishStream(requestId, 500, stream.parser_.errorString());
+        }
+        return;
+    }
+
+    if (stream.device_->atEnd()) {
+        if (!stream.parser_.finish()) {
+            finishStream(requestId, 500, stream.parser_.errorString());
+        } else {
+            finishStream(requestId, stream.parser_.returnCode(), stream.parser_.errorMessage());
+        }
+        return;
+    }
+
+    // one chunk per event loop iteration, so the receivers can process each batch
+    QTimer::singleShot(0, parent_, [this, requestId]() { readStreamChunk(requestId); });
+}
+
+// -------------------------------------------------------------------------------------------------
+void CoffeeWeb::Impl::finishStream(quint32 requestId, int returnCode, const QString& errorMessage)
+{
+    streams_.erase(requestId);
+    requestFinished(requestId, returnCode);
+    emit parent_->recipesStreamFinished(requestId, returnCode, errorMessage);
+}
+
+// -------------------------------------------------------------------------------------------------
+void CoffeeWeb::Impl::feedHttpStream(quint32 requestId, const QByteArray& chunk)
+{
+    const auto it = streams_.find(requestId);
+    if (it == streams_.end()) return;
+    auto& stream = *it->second;
+
+    if (stream.cancelled_ || !stream.parser_.feed(chunk)) {
+        http_->cancel(requestId);
+        if (stream.cancelled_) {
+            streams_.erase(it);
+        } else {
+            finishStream(requestId, 500, stream.parser_.errorString());
+        }
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+void CoffeeWeb::Impl::finishHttpStream(quint32 requestId, int returnCode, const QString& errorMessage)
+{
+    const auto it = streams_.find(requestId);
+    if (it == streams_.end()) return;
+    auto& stream = *it->second;
+
+    if (stream.cancelled_) {
+        streams_.erase(it);
+    } else if (returnCode != 200) {
+        finishStream(requestId, returnCode, errorMessage);
+    } else if (!stream.parser_.finish()) {
+        finishStream(requestId, 500, stream.parser_.errorString());
+    } else {
+        finishStream(requestId, stream.parser_.returnCode(), stream.parser_.errorMessage());
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+CoffeeWeb::CoffeeWeb(QObject* parent)
+    : QObject(parent)
+    , impl_(std::make_unique<Impl>(this))
+{
+    Q_INIT_RESOURCE(json);
+    qRegisterMetaType<Recipe>();
+    qRegisterMetaType<QVector<Recipe>>();
+}
+
+// -------------------------------------------------------------------------------------------------
+CoffeeWeb::~CoffeeWeb() = default;
+
+// -------------------------------------------------------------------------------------------------
+void CoffeeWeb::setRecipesSource(const QString& fileName)
+{
+    impl_->recipesSource_ = fileName.isEmpty() ? QString(bundledRecipes) : fileName;
+    impl_->cachedPayload_.clear();
+    impl_->cachedReply_.clear();
+}
+
+// -------------------------------------------------------------------------------------------------
+void CoffeeWeb::setBackendModel(const BackendModel& model)
+{
+    impl_->model_ = model;
+    impl_->model_.payloadScale = qMax(1, model.payloadScale);
+    impl_->cachedPayload_.clear();
+    impl_->cachedReply_.clear();
+}
+
+// -------------------------------------------------------------------------------------------------
+BackendModel CoffeeWeb::backendModel() const
+{
+    return impl_->model_;
+}
+
+// -------------------------------------------------------------------------------------------------
+void CoffeeWeb::setBackendUrl(const QUrl& url)
+{
+    if (url.isEmpty()) {
+        impl_->http_.reset();
+        return;
+    }
+    if (!impl_->http_) impl_->http_ = std::make_unique<HttpTransport>(this);
+    impl_->http_->setUrl(url);
+}
+
+// -------------------------------------------------------------------------------------------------
+QUrl CoffeeWeb::backendUrl() const
+{
+    return impl_->http_ ? impl_->http_->url() : QUrl();
+}
+
+// -------------------------------------------------------------------------------------------------
+std::shared_ptr<const CoffeeWebMetrics> CoffeeWeb::metrics() const
+{
+    return impl_->metrics_;
+}
+
+// -------------------------------------------------------------------------------------------------
+void CoffeeWeb::cancelRequest(quint32 id)
+{
+    if (impl_->startedNs_.erase(id)) impl_->metrics_->requestsCancelled.fetch_add(1, std::memory_order_relaxed);
+    impl_->requests_.erase(id);
+    if (impl_->http_) impl_->http_->cancel(id);
+
+    // the stream may be inside a parser callback right now, so it is only removed later
+    const auto it = impl_->streams_.find(id);
+    if (it != impl_->streams_.end()) {
+        it->second->cancelled_ = true;
+        it->second->parser_.abort();
+        QTimer::singleShot(0, this, [this, id]() {
+            const auto it = impl_->streams_.find(id);
+            if (it != impl_->streams_.end() && it->second->cancelled_) impl_->streams_.erase(it);
+        });
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+quint32 CoffeeWeb::requestRecipes(quint32 timeoutMs, bool forceTimeout)
+{
+    if (impl_->http_) {
+        const auto requestId = impl_->requestStarted();
+        const auto body = std::make_shared<QByteArray>();
+        impl_->http_->get(requestId, forceTimeout ? 0 : timeoutMs,
+            [body](const QByteArray& chunk) { body->append(chunk); },
+            [this, requestId, body](int returnCode, const QString& errorMessage) {
+                impl_->requestFinished(requestId, returnCode);
+                emit recipesRequestReply(requestId, returnCode == 200 ? QString::fromUtf8(*body)
+                                                                      : errorReply(returnCode, errorMessage));
+            });
+        return requestId;
+    }
+
+    const auto onError = [this](quint32 requestId, int returnCode, const QString& errorMessage) {
+        impl_->requestFinished(requestId, returnCode);
+        emit recipesRequestReply(requestId, errorReply(returnCode, errorMessage));
+    };
+
+    const auto onReply = [this, onError](quint32 requestId) {
+        if (impl_->cachedReply_.isEmpty()) {
+            const auto payload = impl_->payload();
+            if (payload.isEmpty()) {
+                onError(requestId, 500, "Could not read file.");
+                return;
+            }
+            impl_->cachedReply_ = QString::fromUtf8(payload);
+        }
+
+        impl_->requestFinished(requestId, 200);
+        emit recipesRequestReply(requestId, impl_->cachedReply_);
+    };
+
+    return impl_->startRequest(timeoutMs, forceTimeout, onReply, onError);
+}
+
+// -------------------------------------------------------------------------------------------------
+quint32 CoffeeWeb::requestRecipesStreamed(quint32 timeoutMs, bool forceTimeout)
+{
+    const auto createStream = [this](quint32 requestId, std::unique_ptr<QIODevice> device) {
+        auto stream = std::make_unique<RecipeStream>(std::move(device),
+            [this, requestId](const QVector<Recipe>& recipes) {
+                emit recipesChunkReceived(requestId, recipes);
+            });
+        const auto parser = &stream->parser_;
+        parser->setCollectionHandler([this, requestId, parser]() {
+            emit recipesCollectionReceived(requestId, parser->collectionName(), parser->collectionVersion());
+        });
+        return stream;
+    };
+
+    if (impl_->http_) {
+        const auto requestId = impl_->requestStarted();
+        impl_->streams_.emplace(requestId, createStream(requestId, nullptr));
+        impl_->http_->get(requestId, forceTimeout ? 0 : timeoutMs,
+            [this, requestId](const QByteArray& chunk) { impl_->feedHttpStream(requestId, chunk); },
+            [this, requestId](int returnCode, const QString& errorMessage) {
+                impl_->finishHttpStream(requestId, returnCode, errorMessage);
+            });
+        return requestId;
+    }
+
+    const auto onError = [this](quint32 requestId, int returnCode, const QString& errorMessage) {
+        impl_->requestFinished(requestId, returnCode);
+        emit recipesStreamFinished(requestId, returnCode, errorMessage);
+    };
+
+    const auto onReply = [this, createStream](quint32 requestId) {
+        // unscaled collections are read from the file chunk by chunk
+        std::unique_ptr<QIODevice> device;
+        if (impl_->model_.payloadScale > 1) {
+            auto buffer = std::make_unique<QBuffer>();
+            buffer->setData(impl_->payload());
+            device = std::move(buffer);
+        } else {
+            device = std::make_unique<QFile>(impl_->recipesSource_);
+        }
+
+        if (!device->open(QIODevice::ReadOnly)) {
+            impl_->requestFinished(requestId, 500);
+            emit recipesStreamFinished(requestId, 500, "Could not read file.");
+            return;
+        }
+        impl_->streams_.emplace(requestId, createStream(requestId, std::move(device)));
+        impl_->readStreamChunk(requestId);
+    };
+
+    return impl_->startRequest(timeoutMs, forceTimeout, onReply, onError);
+}
@@ -0,0 +1,132 @@
+// Bio-Hybrid Coffee Machine Example - Copyright (c) 2021 Bio-Hybrid GmbH
+#include "httptransport.h"
+
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QTimer>
+
+#include <memory>
+
+// -------------------------------------------------------------------------------------------------
+namespace {
+    constexpr int maxCachedBody = 8 * 1024 * 1024;
+    constexpr int cachedChunkSize = 16 * 1024;
+
+    /// Returns the code reported for a failed reply, never 200: the HTTP error status if the server
+    /// sent one, 408 for a network timeout and 500 otherwise
+    int errorCode(QNetworkReply::NetworkError error, int status)
+    {
+        if (status >= 400) return status;
+        return error == QNetworkReply::TimeoutError ? 408 : 500;
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+HttpTransport::HttpTransport(QObject* context)
+    : context_(context)
+    , manager_(new QNetworkAccessManager(context))
+{
+}
+
+// -------------------------------------------------------------------------------------------------
+HttpTransport::~HttpTransport()
+{
+    while (!replies_.empty()) cancel(replies_.begin()->first);
+}
+
+// -------------------------------------------------------------------------------------------------
+void HttpTransport::setUrl(const QUrl& url)
+{
+    if (url_ == url) return;
+    url_ = url;
+    etag_.clear();
+    cachedBody_.clear();
+}
+
+// -------------------------------------------------------------------------------------------------
+void HttpTransport::get(quint32 id, quint32 timeoutMs, DataHandler onData, FinishedHandler onFinished)
+{
+    QNetworkRequest request(url_);
+    // Accept-Encoding is left to the manager, which then also decodes gzip/deflate itself
+    request.setRawHeader("Connection", "keep-alive");
+    if (!etag_.isEmpty()) request.setRawHeader("If-None-Match", etag_);
+
+    const auto reply = manager_->get(request);
+    replies_[id] = reply;
+
+    // body of a 200 reply, kept for revalidation as long as it is small enough
+    const auto body = std::make_shared<QByteArray>();
+    const auto cacheable = std::make_shared<bool>(true);
+
+    const auto timeoutTimer = new QTimer(reply);
+    timeoutTimer->setSingleShot(true);
+    QObject::connect(timeoutTimer, &QTimer::timeout, context_, [this, id, onFinished]() {
+        if (replies_.find(id) == replies_.end()) return; // already finished or cancelled
+        cancel(id);
+        onFinished(408, "Request timed out.");
+    });
+    timeoutTimer->start(int(timeoutMs));
+
+    QObject::connect(reply, &QNetworkReply::readyRead, context_, [reply, body, cacheable, onData]() {
+        if (reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() != 200) return;
+        const auto chunk = reply->readAll();
+        if (*cacheable) {
+            *cacheable = body->size() + chunk.size() <= maxCachedBody;
+            if (*cacheable) body->append(chunk); else body->clear();
+        }
+        onData(chunk);
+    });
+
+    QObject::connect(reply, &QNetworkReply::finished, context_,
+    [this, id, reply, body, cacheable, onData, onFinished]() {
+        replies_.erase(id);
+        reply->deleteLater();
+
+        const auto status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        if (reply->error() != QNetworkReply::NoError) {
+            // A failure after the headers keeps the 200 status, but the body is incomplete
+            onFinished(errorCode(reply->error(), status), reply->errorString());
+            return;
+        }
+
+        if (status == 304) {
+            for (int i = 0; i < cachedBody_.size(); i += cachedChunkSize) {
+                onData(QByteArray::fromRawData(cachedBody_.constData() + i, qMin(cachedChunkSize, cachedBody_.size() - i)));
+            }
+            onFinished(200, QString());
+            return;
+        }
+
+        if (status != 200) {
+            onFinished(status ? status : 500, reply->errorString());
+            return;
+        }
+
+        const auto rest = reply->readAll();
+        if (!rest.isEmpty()) {
+            if (*cacheable) {
+                *cacheable = body->size() + rest.size() <= maxCachedBody;
+                if (*cacheable) body->append(rest);
+            }
+            onData(rest);
+        }
+
+        etag_ = *cacheable ? reply->rawHeader("ETag") : QByteArray();
+        cachedBody_ = etag_.isEmpty() ? QByteArray() : *body;
+        onFinished(200, QString());
+    });
+}
+
+// -------------------------------------------------------------------------------------------------
+void HttpTransport::cancel(quint32 id)
+{
+    const auto it = replies_.find(id);
+    if (it == replies_.end()) return;
+    const auto reply = it->second;
+    replies_.erase(it);
+
+    reply->disconnect(context_);
+    reply->abort();
+    reply->deleteLater();
+}
@@ -0,0 +1,49 @@
+// Bio-Hybrid Coffee Machine Example - Copyright (c) 2021 Bio-Hybrid GmbH
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+#include <QUrl>
+
+#include <functional>
+#include <map>
+
+class QNetworkAccessManager;
+class QNetworkReply;
+class QObject;
+
+/// HTTP backend of CoffeeWeb.
+///
+/// Connections are kept alive and reused by the network access manager, compressed
+/// (gzip/deflate) replies are decoded transparently and the last reply is revalidated with
+/// a conditional GET (ETag / If-None-Match), a 304 reply is served from the kept body.
+class HttpTransport
+{
+public:
+    /// Called for every chunk of the (decoded) reply body
+    using DataHandler = std::function<void(const QByteArray& chunk)>;
+    /// Called once at the end, 'returnCode' is 200 or the HTTP/transport error code
+    using FinishedHandler = std::function<void(int returnCode, const QString& errorMessage)>;
+
+    explicit HttpTransport(QObject* context);
+    ~HttpTransport();
+
+    void setUrl(const QUrl& url);
+    QUrl url() const { return url_; }
+
+    /// Starts a GET of the recipes url
+    void get(quint32 id, quint32 timeoutMs, DataHandler onData, FinishedHandler onFinished);
+
+    /// Aborts a running GET, no handler is called anymore
+    void cancel(quint32 id);
+
+private:
+    QObject* const context_;
+    QNetworkAccessManager* const manager_;
+    QUrl url_;
+    std::map<quint32, QNetworkReply*> replies_;
+
+    // last validated reply, bodies above maxCachedBody are not kept
+    QByteArray etag_;
+    QByteArray cachedBody_;
+};
@@ -0,0 +1,57 @@
+// Bio-Hybrid Coffee Machine Example - Copyright (c) 2021 Bio-Hybrid GmbH
+#include "recipe.h"
+
+// -------------------------------------------------------------------------------------------------
+Recipe Recipe::fromJson(const QJsonObject& object)
+{
+    Recipe recipe;
+    recipe.name = object.value("name").toString();
+    recipe.beansGram = object.value("beans_g").toInt();
+    recipe.grindLevel = object.value("grind_level").toString();
+    recipe.waterMl = object.value("water_ml").toInt();
+    recipe.waterTemp = object.value("water_temp").toInt();
+
+    const auto milk = object.value("milk");
+    recipe.hasMilk = milk.isObject();
+    if (recipe.hasMilk) {
+        const auto milkObject = milk.toObject();
+        recipe.milkMl = milkObject.value("milk_ml").toInt();
+        recipe.milkTemp = milkObject.value("milk_temp").toInt();
+        recipe.foamMl = milkObject.value("foam_ml").toInt();
+    }
+    return recipe;
+}
+
+// -------------------------------------------------------------------------------------------------
+QJsonObject Recipe::toJson() const
+{
+    QJsonObject object {
+        {"name", name},
+        {"beans_g", beansGram},
+        {"grind_level", grindLevel},
+        {"water_ml", waterMl},
+        {"water_temp", waterTemp},
+    };
+    if (hasMilk) {
+        object.insert("milk", QJsonObject {
+            {"milk_ml", milkMl},
+            {"milk_temp", milkTemp},
+            {"foam_ml", foamMl},
+        });
+    }
+    return object;
+}
+
+// -------------------------------------------------------------------------------------------------
+bool Recipe::operator==(const Recipe& other) const
+{
+    return name == other.name
+        && beansGram == other.beansGram
+        && grindLevel == other.grindLevel
+        && waterMl == other.waterMl
+        && waterTemp == other.waterTemp
+        && hasMilk == other.hasMilk
+        && milkMl == other.milkMl
+        && milkTemp == other.milkTemp
+        && foamMl == other.foamMl;
+}
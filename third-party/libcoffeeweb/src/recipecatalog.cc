@@ -0,0 +1,360 @@
+// Bio-Hybrid Coffee Machine Example - Copyright (c) 2021 Bio-Hybrid GmbH
+#include "recipecatalog.h"
+
+#include <QFile>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QtEndian>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <vector>
+
+// -------------------------------------------------------------------------------------------------
+namespace {
+    // Catalog layout (all integers little endian):
+    //   CatalogHeader
+    //   RecipeRecord[recipeCount]
+    //   quint32 nameIndex[recipeCount]   - record indices sorted by UTF-8 name
+    //   string table                     - UTF-8 strings referenced by StringRef, not terminated
+    constexpr char catalogMagic[8] = {'C', 'W', 'R', 'C', 'P', 'C', 'A', 'T'};
+
+    constexpr quint8 flagHasMilk = 0x01;
+
+    constexpr std::array<const char*, 7> grindLevels = {
+        "extra-course", "course", "medium-coarse", "medium", "medium-fine", "fine", "extra-fine"
+    };
+
+    struct StringRef
+    {
+        quint32_le offset;
+        quint32_le length;
+    };
+
+    struct CatalogHeader
+    {
+        char magic[8];
+        quint32_le version;
+        quint32_le headerSize;
+        quint32_le fileSize;
+        quint32_le recipeCount;
+        quint32_le recipesOffset;
+        quint32_le nameIndexOffset;
+        quint32_le stringsOffset;
+        quint32_le stringsSize;
+        StringRef collectionName;
+        StringRef collectionVersion;
+    };
+
+    struct RecipeRecord
+    {
+        StringRef name;
+        quint16_le beansGram;
+        quint16_le waterMl;
+        quint16_le waterTemp;
+        quint16_le milkMl;
+        quint16_le milkTemp;
+        quint16_le foamMl;
+        quint8 grindLevel;
+        quint8 flags;
+        quint16_le reserved;
+    };
+
+    static_assert(sizeof(StringRef) == 8, "unexpected catalog layout");
+    static_assert(sizeof(CatalogHeader) == 56, "unexpected catalog layout");
+    static_assert(sizeof(RecipeRecord) == 24, "unexpected catalog layout");
+
+    // Collects deduplicated strings for the string table
+    class StringTableBuilder
+    {
+    public:
+        StringRef add(const QString& string) {
+            const auto utf8 = string.toUtf8();
+            auto it = offsets_.find(utf8);
+            if (it == offsets_.end()) {
+                it = offsets_.insert(utf8, quint32(data_.size()));
+                data_.append(utf8);
+            }
+            StringRef ref;
+            ref.offset = it.value();
+            ref.length = quint32(utf8.size());
+            return ref;
+        }
+
+        const QByteArray& data() const { return data_; }
+
+    private:
+        QHash<QByteArray, quint32> offsets_;
+        QByteArray data_;
+    };
+
+    bool toUInt16(const QJsonObject& object, const char* key, quint16_le* value) {
+        const auto v = object.value(key).toInt(-1);
+        if (v < 0 || v > 0xFFFF) return false;
+        *value = quint16(v);
+        return true;
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+struct RecipeCatalog::Impl
+{
+    QByteArray stringAt(const StringRef& ref) const {
+        const quint32 offset = ref.offset;
+        const quint32 length = ref.length;
+        if (quint64(offset) + length > header_->stringsSize) return {};
+        return QByteArray::fromRawData(strings_ + offset, int(length));
+    }
+
+    QFile file_;
+    QString errorString_;
+    const CatalogHeader* header_ = nullptr;
+    const RecipeRecord* records_ = nullptr;
+    const quint32_le* nameIndex_ = nullptr;
+    const char* strings_ = nullptr;
+};
+
+// -------------------------------------------------------------------------------------------------
+RecipeCatalog::RecipeCatalog()
+    : impl_(std::make_unique<Impl>())
+{
+}
+
+// -------------------------------------------------------------------------------------------------
+RecipeCatalog::~RecipeCatalog() = default;
+
+// -------------------------------------------------------------------------------------------------
+bool RecipeCatalog::open(const QString& fileName)
+{
+    close();
+
+    impl_->file_.setFileName(fileName);
+    if (!impl_->file_.open(QFile::ReadOnly)) {
+        impl_->errorString_ = impl_->file_.errorString();
+        return false;
+    }
+
+    const auto size = impl_->file_.size();
+    const uchar* data = size >= qint64(sizeof(CatalogHeader)) ? impl_->file_.map(0, size) : nullptr;
+    const auto fail = [this](const QString& error) {
+        impl_->errorString_ = error;
+        impl_->file_.close();
+        return false;
+    };
+    if (!data) return fail(QString("%1: not a recipe catalog").arg(fileName));
+
+    const auto header = reinterpret_cast<const CatalogHeader*>(data);
+    if (std::memcmp(header->magic, catalogMagic, sizeof(catalogMagic)) != 0) {
+        return fail(QString("%1: not a recipe catalog").arg(fileName));
+    }
+    if (header->version != formatVersion || header->headerSize != sizeof(CatalogHeader)) {
+        return fail(QString("%1: unsupported catalog version %2").arg(fileName).arg(quint32(header->version)));
+    }
+
+    const quint64 count = header->recipeCount;
+    if (header->fileSize != size
+        || quint64(header->recipesOffset) + count * sizeof(RecipeRecord) > quint64(size)
+        || quint64(header->nameIndexOffset) + count * sizeof(quint32) > quint64(size)
+        || quint64(header->stringsOffset) + header->stringsSize > quint64(size))
+    {
+        return fail(QString("%1: truncated or corrupt catalog").arg(fileName));
+    }
+
+    // The records are used in place, their name index entries and strings are checked once here
+    const auto records = reinterpret_cast<const RecipeRecord*>(data + header->recipesOffset);
+    const auto nameIndex = reinterpret_cast<const quint32_le*>(data + header->nameIndexOffset);
+    const auto validString = [header](const StringRef& ref) {
+        return quint64(ref.offset) + ref.length <= header->stringsSize;
+    };
+    auto valid = validString(header->collectionName) && validString(header->collectionVersion);
+    for (quint64 i = 0; valid && i < count; ++i) {
+        valid = nameIndex[i] < count && validString(records[i].name);
+    }
+    if (!valid) return fail(QString("%1: truncated or corrupt catalog").arg(fileName));
+
+    impl_->header_ = header;
+    impl_->records_ = records;
+    impl_->nameIndex_ = nameIndex;
+    impl_->strings_ = reinterpret_cast<const char*>(data + header->stringsOffset);
+    impl_->errorString_.clear();
+    return true;
+}
+
+// -------------------------------------------------------------------------------------------------
+void RecipeCatalog::close()
+{
+    impl_->header_ = nullptr;
+    impl_->records_ = nullptr;
+    impl_->nameIndex_ = nullptr;
+    impl_->strings_ = nullptr;
+    impl_->file_.close(); // also unmaps
+}
+
+// -------------------------------------------------------------------------------------------------
+bool RecipeCatalog::isOpen() const
+{
+    return impl_->header_ != nullptr;
+}
+
+// -------------------------------------------------------------------------------------------------
+QString RecipeCatalog::errorString() const
+{
+    return impl_->errorString_;
+}
+
+// -------------------------------------------------------------------------------------------------
+int RecipeCatalog::count() const
+{
+    return isOpen() ? int(impl_->header_->recipeCount) : 0;
+}
+
+// -------------------------------------------------------------------------------------------------
+QString RecipeCatalog::collectionName() const
+{
+    if (!isOpen()) return {};
+    return QString::fromUtf8(impl_->stringAt(impl_->header_->collectionName));
+}
+
+// -------------------------------------------------------------------------------------------------
+QString RecipeCatalog::collectionVersion() const
+{
+    if (!isOpen()) return {};
+    return QString::fromUtf8(impl_->stringAt(impl_->header_->collectionVersion));
+}
+
+// -------------------------------------------------------------------------------------------------
+QByteArray RecipeCatalog::nameUtf8(int index) const
+{
+    if (index < 0 || index >= count()) return {};
+    return impl_->stringAt(impl_->records_[index].name);
+}
+
+// -------------------------------------------------------------------------------------------------
+Recipe RecipeCatalog::recipe(int index) const
+{
+    if (index < 0 || index >= count()) return {};
+
+    const auto& record = impl_->records_[index];
+    Recipe recipe;
+    recipe.name = QString::fromUtf8(impl_->stringAt(record.name));
+    recipe.beansGram = record.beansGram;
+    if (record.grindLevel < grindLevels.size()) {
+        recipe.grindLevel = QString::fromLatin1(grindLevels[record.grindLevel]);
+    }
+    recipe.waterMl = record.waterMl;
+    recipe.waterTemp = record.waterTemp;
+    recipe.hasMilk = (record.flags & flagHasMilk) != 0;
+    recipe.milkMl = record.milkMl;
+    recipe.milkTemp = record.milkTemp;
+    recipe.foamMl = record.foamMl;
+    return recipe;
+}
+
+// -------------------------------------------------------------------------------------------------
+int RecipeCatalog::indexOf(const QString& name) const
+{
+    const auto key = name.toUtf8();
+    const auto begin = impl_->nameIndex_;
+    const auto end = begin + count();
+    const auto it = std::lower_bound(begin, end, key, [this](const quint32_le& i, const QByteArray& k) {
+        return impl_->stringAt(impl_->records_[quint32(i)].name) < k;
+    });
+    if (it == end || impl_->stringAt(impl_->records_[quint32(*it)].name) != key) return -1;
+    return int(quint32(*it));
+}
+
+// -------------------------------------------------------------------------------------------------
+QByteArray RecipeCatalog::compile(const QJsonDocument& document, QString* errorString)
+{
+    const auto fail = [errorString](const QString& error) {
+        if (errorString) *errorString = error;
+        return QByteArray();
+    };
+
+    const auto root = document.object();
+    if (!root.value("recipes").isArray()) return fail("missing 'recipes' array");
+    const auto recipes = root.value("recipes").toArray();
+
+    StringTableBuilder strings;
+    std::vector<RecipeRecord> records;
+    records.reserve(size_t(recipes.size()));
+    std::vector<QByteArray> names;
+    names.reserve(size_t(recipes.size()));
+
+    for (const auto& value : recipes) {
+        const auto object = value.toObject();
+        const auto name = object.value("name").toString();
+        if (name.isEmpty()) return fail(QString("recipe %1 has no name").arg(records.size()));
+
+        RecipeRecord record {};
+        record.name = strings.add(name);
+
+        const auto grindLevel = object.value("grind_level").toString().toLatin1();
+        const auto grindIt = std::find_if(grindLevels.begin(), grindLevels.end(),
+                                          [&grindLevel](const char* level) { return grindLevel == level; });
+        if (grindIt == grindLevels.end()) {
+            return fail(QString("%1: unknown grind level '%2'").arg(name, QString::fromLatin1(grindLevel)));
+        }
+        record.grindLevel = quint8(grindIt - grindLevels.begin());
+
+        if (!toUInt16(object, "beans_g", &record.beansGram)
+            || !toUInt16(object, "water_ml", &record.waterMl)
+            || !toUInt16(object, "water_temp", &record.waterTemp))
+        {
+            return fail(QString("%1: invalid beans or water values").arg(name));
+        }
+
+        if (object.value("milk").isObject()) {
+            const auto milk = object.value("milk").toObject();
+            record.flags |= flagHasMilk;
+            if (!toUInt16(milk, "milk_ml", &record.milkMl)
+                || !toUInt16(milk, "milk_temp", &record.milkTemp)
+                || !toUInt16(milk, "foam_ml", &record.foamMl))
+            {
+                return fail(QString("%1: invalid milk values").arg(name));
+            }
+        }
+
+        records.push_back(record);
+        names.push_back(name.toUtf8());
+    }
+
+    std::vector<quint32> nameIndex(records.size());
+    for (quint32 i = 0; i < nameIndex.size(); ++i) nameIndex[i] = i;
+    std::sort(nameIndex.begin(), nameIndex.end(), [&names](quint32 a, quint32 b) { return names[a] < names[b]; });
+    for (size_t i = 1; i < nameIndex.size(); ++i) {
+        if (names[nameIndex[i - 1]] == names[nameIndex[i]]) {
+            return fail(QString("duplicate recipe name '%1'").arg(QString::fromUtf8(names[nameIndex[i]])));
+        }
+    }
+
+    CatalogHeader header {};
+    std::memcpy(header.magic, catalogMagic, sizeof(catalogMagic));
+    header.collectionName = strings.add(root.value("collection_name").toString());
+    header.collectionVersion = strings.add(root.value("collection_version").toString());
+
+    const auto recipesSize = records.size() * sizeof(RecipeRecord);
+    const auto indexSize = nameIndex.size() * sizeof(quint32);
+    header.version = formatVersion;
+    header.headerSize = sizeof(CatalogHeader);
+    header.recipeCount = quint32(records.size());
+    header.recipesOffset = sizeof(CatalogHeader);
+    header.nameIndexOffset = quint32(sizeof(CatalogHeader) + recipesSize);
+    header.stringsOffset = quint32(sizeof(CatalogHeader) + recipesSize + indexSize);
+    header.stringsSize = quint32(strings.data().size());
+    header.fileSize = header.stringsOffset + header.stringsSize;
+
+    QByteArray catalog;
+    catalog.reserve(int(header.fileSize));
+    catalog.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    catalog.append(reinterpret_cast<const char*>(records.data()), int(recipesSize));
+    for (const auto index : nameIndex) {
+        const quint32_le le(index);
+        catalog.append(reinterpret_cast<const char*>(&le), sizeof(le));
+    }
+    catalog.append(strings.data());
+    return catalog;
+}
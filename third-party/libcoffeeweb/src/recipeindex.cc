@@ -0,0 +1,162 @@
+// Bio-Hybrid Coffee Machine Example - Copyright (c) 2021 Bio-Hybrid GmbH
+#include "recipeindex.h"
+
+#include <algorithm>
+
+// -------------------------------------------------------------------------------------------------
+namespace {
+    QString normalized(const QString& text) {
+        return text.simplified().toCaseFolded();
+    }
+
+    quint64 trigramKey(const QString& s, int i) {
+        return (quint64(s.at(i).unicode()) << 32) | (quint64(s.at(i + 1).unicode()) << 16)
+               | quint64(s.at(i + 2).unicode());
+    }
+
+    // Trigrams of " name " (padded so that short words and word starts count as well)
+    std::vector<quint64> trigramsOf(const QString& name) {
+        const auto padded = QString(' ') + name + QString(' ');
+        std::vector<quint64> keys;
+        for (int i = 0; i + 2 < padded.size(); ++i) keys.push_back(trigramKey(padded, i));
+        std::sort(keys.begin(), keys.end());
+        keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+        return keys;
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+bool RecipeIndex::Filter::isEmpty() const
+{
+    return text.trimmed().isEmpty() && minBeansGram <= 0 && maxBeansGram == INT_MAX
+        && minWaterMl <= 0 && maxWaterMl == INT_MAX && milk == Milk::Any;
+}
+
+// -------------------------------------------------------------------------------------------------
+void RecipeIndex::clear()
+{
+    words_.clear();
+    trigrams_.clear();
+    rowsByBeans_.clear();
+    beans_.clear();
+    water_.clear();
+    hasMilk_.clear();
+    hitCounts_.clear();
+}
+
+// -------------------------------------------------------------------------------------------------
+void RecipeIndex::build(const QVector<Recipe>& recipes)
+{
+    clear();
+
+    const auto count = size_t(recipes.size());
+    beans_.reserve(count);
+    water_.reserve(count);
+    hasMilk_.reserve(count);
+    words_.reserve(count * 2);
+
+    for (int row = 0; row < recipes.size(); ++row) {
+        const auto& recipe = recipes.at(row);
+        beans_.push_back(recipe.beansGram);
+        water_.push_back(recipe.waterMl);
+        hasMilk_.push_back(recipe.hasMilk ? 1 : 0);
+
+        const auto name = normalized(recipe.name);
+        for (int i = 0; i < name.size(); ++i) {
+            if (i == 0 || name.at(i - 1) == ' ') words_.push_back({name.mid(i), row});
+        }
+        for (const auto key : trigramsOf(name)) trigrams_[key].push_back(row);
+    }
+
+    std::sort(words_.begin(), words_.end(), [](const WordEntry& a, const WordEntry& b) {
+        return a.word < b.word;
+    });
+
+    rowsByBeans_.resize(count);
+    for (size_t i = 0; i < count; ++i) rowsByBeans_[i] = int(i);
+    std::stable_sort(rowsByBeans_.begin(), rowsByBeans_.end(), [this](int a, int b) {
+        return beans_[size_t(a)] < beans_[size_t(b)];
+    });
+
+    hitCounts_.assign(count, 0);
+}
+
+// -------------------------------------------------------------------------------------------------
+std::vector<int> RecipeIndex::prefixMatches(const QString& prefix) const
+{
+    const auto key = normalized(prefix);
+    std::vector<int> rows;
+    if (key.isEmpty()) return rows;
+
+    auto it = std::lower_bound(words_.begin(), words_.end(), key, [](const WordEntry& e, const QString& k) {
+        return e.word < k;
+    });
+    for (; it != words_.end() && it->word.startsWith(key); ++it) rows.push_back(it->row);
+
+    std::sort(rows.begin(), rows.end());
+    rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
+    return rows;
+}
+
+// -------------------------------------------------------------------------------------------------
+std::vector<int> RecipeIndex::fuzzyMatches(const QString& query) const
+{
+    const auto keys = trigramsOf(normalized(query));
+    std::vector<int> rows;
+    if (keys.size() < 3) return rows; // too short for trigrams to mean anything
+
+    std::vector<int> touched;
+    for (const auto key : keys) {
+        const auto it = trigrams_.find(key);
+        if (it == trigrams_.end()) continue;
+        for (const auto row : it->second) {
+            if (hitCounts_[size_t(row)]++ == 0) touched.push_back(row);
+        }
+    }
+
+    // a single typo changes at most three trigrams of the query
+    const auto required = std::max<size_t>(1, keys.size() > 3 ? keys.size() - 3 : 1);
+    for (const auto row : touched) {
+        if (hitCounts_[size_t(row)] >= required) rows.push_back(row);
+        hitCounts_[size_t(row)] = 0;
+    }
+
+    std::sort(rows.begin(), rows.end());
+    return rows;
+}
+
+// -------------------------------------------------------------------------------------------------
+bool RecipeIndex::matchesRanges(int row, const Filter& filter) const
+{
+    const auto r = size_t(row);
+    if (beans_[r] < filter.minBeansGram || beans_[r] > filter.maxBeansGram) return false;
+    if (water_[r] < filter.minWaterMl || water_[r] > filter.maxWaterMl) return false;
+    if (filter.milk == Milk::With && !hasMilk_[r]) return false;
+    if (filter.milk == Milk::Without && hasMilk_[r]) return false;
+    return true;
+}
+
+// -------------------------------------------------------------------------------------------------
+std::vector<int> RecipeIndex::query(const Filter& filter) const
+{
+    std::vector<int> rows;
+
+    if (!filter.text.trimmed().isEmpty()) {
+        rows = prefixMatches(filter.text);
+        if (rows.empty() && filter.fuzzy) rows = fuzzyMatches(filter.text);
+        rows.erase(std::remove_if(rows.begin(), rows.end(), [&](int row) { return !matchesRanges(row, filter); }),
+                   rows.end());
+        return rows;
+    }
+
+    // no text: narrow down by the beans range first, then check the remaining filters
+    const auto first = std::lower_bound(rowsByBeans_.begin(), rowsByBeans_.end(), filter.minBeansGram,
+                                        [this](int row, int v) { return beans_[size_t(row)] < v; });
+    const auto last = std::upper_bound(first, rowsByBeans_.end(), filter.maxBeansGram,
+                                       [this](int v, int row) { return v < beans_[size_t(row)]; });
+    for (auto it = first; it != last; ++it) {
+        if (matchesRanges(*it, filter)) rows.push_back(*it);
+    }
+    std::sort(rows.begin(), rows.end());
+    return rows;
+}
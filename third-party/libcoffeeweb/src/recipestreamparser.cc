@@ -0,0 +1,368 @@
+// Bio-Hybrid Coffee Machine Example - Copyright (c) 2021 Bio-Hybrid GmbH
+#include "recipestreamparser.h"
+
+// -------------------------------------------------------------------------------------------------
+namespace {
+    bool isWhitespace(char c) {
+        return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+    }
+
+    bool isNumberChar(char c) {
+        return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+    }
+
+    int toInt(const QByteArray& token) {
+        bool ok = false;
+        const auto value = token.toInt(&ok);
+        return ok ? value : qRound(token.toDouble());
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+RecipeStreamParser::RecipeStreamParser(BatchHandler handler, int batchSize)
+    : handler_(std::move(handler))
+    , batchSize_(qMax(1, batchSize))
+{
+    batch_.reserve(batchSize_);
+}
+
+// -------------------------------------------------------------------------------------------------
+void RecipeStreamParser::reset()
+{
+    lex_ = Lex::Default;
+    token_.clear();
+    unicode_.clear();
+    highSurrogate_ = 0;
+    offset_ = 0;
+    done_ = false;
+    stack_.clear();
+    recipe_ = Recipe();
+    batch_.clear();
+    failed_ = false;
+    errorString_.clear();
+    returnCode_ = 0;
+    errorMessage_.clear();
+    collectionName_.clear();
+    collectionVersion_.clear();
+    recipesParsed_ = 0;
+}
+
+// -------------------------------------------------------------------------------------------------
+bool RecipeStreamParser::feed(const char* data, qint64 size)
+{
+    if (hasError()) return false;
+    for (qint64 i = 0; i < size; ++i, ++offset_) {
+        // also checks for abort() calls from the handlers
+        if (!process(data[i]) || failed_) return false;
+    }
+    return true;
+}
+
+// -------------------------------------------------------------------------------------------------
+void RecipeStreamParser::abort()
+{
+    failed_ = true;
+    errorString_ = "aborted";
+}
+
+// -------------------------------------------------------------------------------------------------
+bool RecipeStreamParser::finish()
+{
+    if (hasError()) return false;
+    // a number or literal at the very end is only terminated by the end of input
+    if ((lex_ == Lex::Number || lex_ == Lex::Literal) && !process(' ')) return false;
+    if (!done_ || lex_ != Lex::Default) return setError("unexpected end of input");
+    flush();
+    return true;
+}
+
+// -------------------------------------------------------------------------------------------------
+bool RecipeStreamParser::process(char c)
+{
+    switch (lex_) {
+    case Lex::String:
+        if (c == '"') {
+            lex_ = Lex::Default;
+            return onString();
+        }
+        if (c == '\\') {
+            lex_ = Lex::StringEscape;
+        } else {
+            token_.append(c);
+        }
+        return true;
+
+    case Lex::StringEscape:
+        lex_ = Lex::String;
+        switch (c) {
+        case '"': token_.append('"'); break;
+        case '\\': token_.append('\\'); break;
+        case '/': token_.append('/'); break;
+        case 'b': token_.append('\b'); break;
+        case 'f': token_.append('\f'); break;
+        case 'n': token_.append('\n'); break;
+        case 'r': token_.append('\r'); break;
+        case 't': token_.append('\t'); break;
+        case 'u': lex_ = Lex::StringUnicode; unicode_.clear(); break;
+        default: return setError("invalid escape sequence");
+        }
+        return true;
+
+    case Lex::StringUnicode: {
+        unicode_.append(c);
+        if (unicode_.size() < 4) return true;
+        lex_ = Lex::String;
+        bool ok = false;
+        const auto unit = ushort(unicode_.toUShort(&ok, 16));
+        if (!ok) return setError("invalid unicode escape");
+        if (QChar::isHighSurrogate(unit)) {
+            highSurrogate_ = unit;
+        } else if (QChar::isLowSurrogate(unit) && highSurrogate_) {
+            const QChar pair[2] = { QChar(highSurrogate_), QChar(unit) };
+            token_.append(QString(pair, 2).toUtf8());
+            highSurrogate_ = 0;
+        } else {
+            token_.append(QString(QChar(unit)).toUtf8());
+            highSurrogate_ = 0;
+        }
+        return true;
+    }
+
+    case Lex::Number:
+        if (isNumberChar(c)) {
+            token_.append(c);
+            return true;
+        }
+        lex_ = Lex::Default;
+        if (!onPrimitive(true)) return false;
+        return process(c);
+
+    case Lex::Literal:
+        if (c >= 'a' && c <= 'z') {
+            token_.append(c);
+            return true;
+        }
+        lex_ = Lex::Default;
+        if (!onPrimitive(false)) return false;
+        return process(c);
+
+    case Lex::Default:
+        break;
+    }
+
+    if (isWhitespace(c)) return true;
+    if (done_) return setError("unexpected data after document");
+
+    switch (c) {
+    case '{': return beginContainer(true);
+    case '}': return endContainer(true);
+    case '[': return beginContainer(false);
+    case ']': return endContainer(false);
+    case ':':
+    case ',':
+        return onSeparator(c);
+    case '"':
+        lex_ = Lex::String;
+        token_.clear();
+        return true;
+    default:
+        break;
+    }
+
+    if (isNumberChar(c)) {
+        lex_ = Lex::Number;
+        token_ = QByteArray(1, c);
+        return true;
+    }
+    if (c >= 'a' && c <= 'z') {
+        lex_ = Lex::Literal;
+        token_ = QByteArray(1, c);
+        return true;
+    }
+    return setError(QString("unexpected character '%1'").arg(c));
+}
+
+// -------------------------------------------------------------------------------------------------
+bool RecipeStreamParser::beginContainer(bool isObject)
+{
+    Level level;
+    level.isObject = isObject;
+    level.expect = isObject ? Expect::KeyOrEnd : Expect::ValueOrEnd;
+
+    if (stack_.empty()) {
+        if (!isObject) return setError("document is not an object");
+        level.role = Role::Root;
+    } else {
+        if (!expectValue()) return false;
+        auto& parent = stack_.back();
+        if (parent.role == Role::Root && !isObject && parent.key == "recipes") {
+            level.role = Role::Recipes;
+            if (collectionHandler_) collectionHandler_();
+        } else if (parent.role == Role::Recipes && isObject) {
+            level.role = Role::Recipe;
+            recipe_ = Recipe();
+        } else if (parent.role == Role::Recipe && isObject && parent.key == "milk") {
+            level.role = Role::Milk;
+            recipe_.hasMilk = true;
+        }
+    }
+
+    stack_.push_back(level);
+    return true;
+}
+
+// -------------------------------------------------------------------------------------------------
+bool RecipeStreamParser::endContainer(bool isObject)
+{
+    if (stack_.empty() || stack_.back().isObject != isObject) {
+        return setError(QString("unexpected '%1'").arg(isObject ? '}' : ']'));
+    }
+    const auto expect = stack_.back().expect;
+    if (expect != Expect::KeyOrEnd && expect != Expect::ValueOrEnd && expect != Expect::CommaOrEnd) {
+        return unexpected(QString("'%1'").arg(isObject ? '}' : ']'));
+    }
+
+    if (stack_.back().role == Role::Recipe) {
+        batch_.append(recipe_);
+        ++recipesParsed_;
+        if (batch_.size() >= batchSize_) flush();
+    }
+
+    stack_.pop_back();
+    if (stack_.empty()) {
+        done_ = true;
+    } else {
+        valueDone();
+    }
+    return true;
+}
+
+// -------------------------------------------------------------------------------------------------
+bool RecipeStreamParser::onString()
+{
+    if (stack_.empty()) return setError("document is not an object");
+
+    auto& level = stack_.back();
+    if (level.expect == Expect::KeyOrEnd || level.expect == Expect::Key) {
+        level.key = token_;
+        level.expect = Expect::Colon;
+        return true;
+    }
+    if (!expectValue()) return false;
+
+    const auto value = QString::fromUtf8(token_);
+    switch (level.role) {
+    case Role::Root:
+        if (level.key == "error_message") errorMessage_ = value;
+        else if (level.key == "collection_name") collectionName_ = value;
+        else if (level.key == "collection_version") collectionVersion_ = value;
+        break;
+    case Role::Recipe:
+        if (level.key == "name") recipe_.name = value;
+        else if (level.key == "grind_level") recipe_.grindLevel = value;
+        break;
+    default:
+        break;
+    }
+
+    valueDone();
+    return true;
+}
+
+// -------------------------------------------------------------------------------------------------
+bool RecipeStreamParser::onPrimitive(bool isNumber)
+{
+    if (stack_.empty()) return setError("document is not an object");
+    if (!isNumber && token_ != "true" && token_ != "false" && token_ != "null") {
+        return setError(QString("invalid literal '%1'").arg(QString::fromLatin1(token_)));
+    }
+
+    if (!expectValue()) return false;
+    const auto& level = stack_.back();
+
+    if (isNumber) {
+        const auto value = toInt(token_);
+        switch (level.role) {
+        case Role::Root:
+            if (level.key == "return_code") returnCode_ = value;
+            break;
+        case Role::Recipe:
+            if (level.key == "beans_g") recipe_.beansGram = value;
+            else if (level.key == "water_ml") recipe_.waterMl = value;
+            else if (level.key == "water_temp") recipe_.waterTemp = value;
+            break;
+        case Role::Milk:
+            if (level.key == "milk_ml") recipe_.milkMl = value;
+            else if (level.key == "milk_temp") recipe_.milkTemp = value;
+            else if (level.key == "foam_ml") recipe_.foamMl = value;
+            break;
+        default:
+            break;
+        }
+    }
+
+    valueDone();
+    return true;
+}
+
+// -------------------------------------------------------------------------------------------------
+bool RecipeStreamParser::onSeparator(char c)
+{
+    if (stack_.empty()) return setError(QString("unexpected '%1'").arg(c));
+
+    auto& level = stack_.back();
+    if (c == ':' && level.expect == Expect::Colon) {
+        level.expect = Expect::Value;
+        return true;
+    }
+    if (c == ',' && level.expect == Expect::CommaOrEnd) {
+        level.expect = level.isObject ? Expect::Key : Expect::Value;
+        return true;
+    }
+    return unexpected(QString("'%1'").arg(c));
+}
+
+// -------------------------------------------------------------------------------------------------
+bool RecipeStreamParser::expectValue()
+{
+    const auto expect = stack_.back().expect;
+    return expect == Expect::Value || expect == Expect::ValueOrEnd || unexpected("value");
+}
+
+// -------------------------------------------------------------------------------------------------
+void RecipeStreamParser::valueDone()
+{
+    stack_.back().expect = Expect::CommaOrEnd;
+}
+
+// -------------------------------------------------------------------------------------------------
+void RecipeStreamParser::flush()
+{
+    if (batch_.isEmpty()) return;
+    if (handler_) handler_(batch_);
+    batch_.clear();
+}
+
+// -------------------------------------------------------------------------------------------------
+bool RecipeStreamParser::unexpected(const QString& token)
+{
+    const auto& level = stack_.back();
+    QString expected;
+    switch (level.expect) {
+    case Expect::KeyOrEnd: expected = "key or '}'"; break;
+    case Expect::Key: expected = "key"; break;
+    case Expect::Colon: expected = "':'"; break;
+    case Expect::ValueOrEnd: expected = "value or ']'"; break;
+    case Expect::Value: expected = "value"; break;
+    case Expect::CommaOrEnd: expected = level.isObject ? "',' or '}'" : "',' or ']'"; break;
+    }
+    return setError(QString("expected %1 instead of %2").arg(expected, token));
+}
+
+// -------------------------------------------------------------------------------------------------
+bool RecipeStreamParser::setError(const QString& error)
+{
+    failed_ = true;
+    errorString_ = QString("%1 at offset %2").arg(error).arg(offset_);
+    return false;
+}
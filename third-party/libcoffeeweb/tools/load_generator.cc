@@ -0,0 +1,145 @@
+// Bio-Hybrid Coffee Machine Example - Copyright (c) 2021 Bio-Hybrid GmbH
+#include <coffeeweb/coffeeweb.h>
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QRegularExpression>
+#include <QTextStream>
+#include <QTimer>
+#include <QDebug>
+
+#include <algorithm>
+#include <map>
+#include <vector>
+
+// -------------------------------------------------------------------------------------------------
+namespace {
+    std::shared_ptr<LatencyModel> parseLatency(const QString& spec) {
+        // uniform:<min>,<max> | lognormal:<median>,<sigma> | recorded:<file>
+        const auto kind = spec.section(':', 0, 0);
+        const auto args = spec.section(':', 1).split(',');
+        if (kind == "uniform" && args.size() == 2) {
+            return std::make_shared<UniformLatency>(args[0].toUInt(), args[1].toUInt());
+        }
+        if (kind == "lognormal" && args.size() == 2) {
+            return std::make_shared<LogNormalLatency>(args[0].toDouble(), args[1].toDouble());
+        }
+        if (kind == "recorded") {
+            return RecordedLatency::fromFile(spec.section(':', 1));
+        }
+        return nullptr;
+    }
+
+    double percentile(const std::vector<double>& sorted, double p) {
+        if (sorted.empty()) return 0;
+        const auto index = size_t(p / 100.0 * double(sorted.size() - 1) + 0.5);
+        return sorted[std::min(index, sorted.size() - 1)];
+    }
+
+    int returnCodeOf(const QString& json) {
+        static const QRegularExpression re(R"("return_code"\s*:\s*(\d+))");
+        const auto match = re.match(json.left(256));
+        return match.hasMatch() ? match.captured(1).toInt() : -1;
+    }
+}
+
+// Issues recipe requests at a target rate and concurrency and reports client side
+// throughput and latency percentiles, e.g.:
+//   coffeeweb-loadgen --rate 200 --concurrency 50 --duration 30 --latency lognormal:120,0.6
+int main(int argc, char** argv)
+{
+  QCoreApplication app(argc, argv);
+
+  QCommandLineParser parser;
+  parser.setApplicationDescription("Load generator for CoffeeWeb recipe requests");
+  parser.addHelpOption();
+  parser.addOption({"rate", "Requests per second (default: 50).", "rate", "50"});
+  parser.addOption({"concurrency", "Maximum requests in flight (default: 16).", "n", "16"});
+  parser.addOption({"duration", "Test duration in seconds (default: 10).", "seconds", "10"});
+  parser.addOption({"timeout", "Request timeout in ms (default: 4000).", "ms", "4000"});
+  parser.addOption({"latency", "Simulated latency: uniform:<min>,<max>, lognormal:<median>,<sigma> "
+                                "or recorded:<file>.", "spec"});
+  parser.addOption({"error-408", "Probability of a simulated 408 reply.", "p", "0"});
+  parser.addOption({"error-500", "Probability of a simulated 500 reply.", "p", "0"});
+  parser.addOption({"payload-scale", "Repeat the recipes n times per reply.", "n", "1"});
+  parser.addOption({"url", "Use the HTTP backend at <url> instead of the simulation.", "url"});
+  parser.addOption({"streamed", "Use streamed requests (decodes the recipes)."});
+  parser.process(app);
+
+  const auto rate = qMax(0.1, parser.value("rate").toDouble());
+  const auto concurrency = qMax(1, parser.value("concurrency").toInt());
+  const auto durationMs = qint64(parser.value("duration").toDouble() * 1000);
+  const auto timeoutMs = parser.value("timeout").toUInt();
+  const auto streamed = parser.isSet("streamed");
+
+  CoffeeWeb web;
+  BackendModel model;
+  if (parser.isSet("latency")) {
+    model.latency = parseLatency(parser.value("latency"));
+    if (!model.latency) {
+      qCritical() << "Invalid latency model:" << parser.value("latency");
+      return 2;
+    }
+  }
+  model.timeoutErrorRate = parser.value("error-408").toDouble();
+  model.serverErrorRate = parser.value("error-500").toDouble();
+  model.payloadScale = parser.value("payload-scale").toInt();
+  web.setBackendModel(model);
+  if (parser.isSet("url")) web.setBackendUrl(QUrl::fromUserInput(parser.value("url")));
+
+  QElapsedTimer clock;
+  std::map<quint32, qint64> inFlight; // request id -> start time in ns
+  std::map<int, quint64> codes;
+  std::vector<double> latenciesMs;
+  quint64 sent = 0, skipped = 0;
+
+  const auto complete = [&](quint32 id, int returnCode) {
+    const auto it = inFlight.find(id);
+    if (it == inFlight.end()) return;
+    latenciesMs.push_back(double(clock.nsecsElapsed() - it->second) / 1e6);
+    ++codes[returnCode];
+    inFlight.erase(it);
+  };
+  QObject::connect(&web, &CoffeeWeb::recipesRequestReply, [&](quint32 id, const QString& json) {
+    complete(id, returnCodeOf(json));
+  });
+  QObject::connect(&web, &CoffeeWeb::recipesStreamFinished, [&](quint32 id, int returnCode, const QString&) {
+    complete(id, returnCode);
+  });
+
+  // open loop: requests are due at a fixed rate, due requests beyond the concurrency limit are skipped
+  QTimer ticker;
+  ticker.setInterval(1);
+  QObject::connect(&ticker, &QTimer::timeout, [&]() {
+    const auto elapsedMs = clock.elapsed();
+    const auto due = quint64(double(qMin(elapsedMs, durationMs)) * rate / 1000.0);
+    while (sent + skipped < due) {
+      if (int(inFlight.size()) >= concurrency) {
+        ++skipped;
+        continue;
+      }
+      const auto start = clock.nsecsElapsed();
+      const auto id = streamed ? web.requestRecipesStreamed(timeoutMs) : web.requestRecipes(timeoutMs);
+      inFlight.emplace(id, start);
+      ++sent;
+    }
+    if (elapsedMs >= durationMs && inFlight.empty()) app.quit();
+  });
+
+  clock.start();
+  ticker.start();
+  app.exec();
+
+  const auto totalS = double(clock.elapsed()) / 1000.0;
+  std::sort(latenciesMs.begin(), latenciesMs.end());
+
+  QTextStream out(stdout);
+  out << "sent: " << sent << ", completed: " << latenciesMs.size() << ", skipped (concurrency): " << skipped << '\n'
+      << "throughput: " << double(latenciesMs.size()) / totalS << " replies/s\n"
+      << "latency ms: p50 " << percentile(latenciesMs, 50) << ", p90 " << percentile(latenciesMs, 90)
+      << ", p95 " << percentile(latenciesMs, 95) << ", p99 " << percentile(latenciesMs, 99)
+      << ", max " << (latenciesMs.empty() ? 0.0 : latenciesMs.back()) << '\n';
+  for (const auto& code : codes) out << "return code " << code.first << ": " << code.second << '\n';
+  return 0;
+}
@@ -0,0 +1,49 @@
+// Bio-Hybrid Coffee Machine Example - Copyright (c) 2021 Bio-Hybrid GmbH
+#include <coffeeweb/recipecatalog.h>
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QJsonDocument>
+#include <QSaveFile>
+#include <QDebug>
+
+// Compiles a recipes JSON file into the binary recipe catalog format:
+//   recipe-compiler <recipes.json> <catalog.bin>
+int main(int argc, char** argv)
+{
+  QCoreApplication app(argc, argv);
+
+  const auto args = app.arguments();
+  if (args.size() != 3) {
+    qCritical() << "usage: recipe-compiler <recipes.json> <catalog.bin>";
+    return 2;
+  }
+
+  QFile input(args.at(1));
+  if (!input.open(QFile::ReadOnly)) {
+    qCritical() << qPrintable(args.at(1)) << ":" << qPrintable(input.errorString());
+    return 1;
+  }
+
+  QJsonParseError parseError;
+  const auto document = QJsonDocument::fromJson(input.readAll(), &parseError);
+  if (document.isNull()) {
+    qCritical() << qPrintable(args.at(1)) << ":" << qPrintable(parseError.errorString())
+                << "at offset" << parseError.offset;
+    return 1;
+  }
+
+  QString error;
+  const auto catalog = RecipeCatalog::compile(document, &error);
+  if (catalog.isEmpty()) {
+    qCritical() << qPrintable(args.at(1)) << ":" << qPrintable(error);
+    return 1;
+  }
+
+  QSaveFile output(args.at(2));
+  if (!output.open(QFile::WriteOnly) || output.write(catalog) != catalog.size() || !output.commit()) {
+    qCritical() << qPrintable(args.at(2)) << ":" << qPrintable(output.errorString());
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,122 @@
+// Bio-Hybrid Coffee Machine Example - Copyright (c) 2021 Bio-Hybrid GmbH
+#include <coffeeweb/recipestreamparser.h>
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTemporaryDir>
+#include <QTextStream>
+
+// -------------------------------------------------------------------------------------------------
+namespace {
+    struct Result
+    {
+        double firstRecipeMs = 0;
+        double totalMs = 0;
+        qint64 peakRssKb = 0;
+        qint64 recipes = 0;
+    };
+
+    // Resets the peak RSS (VmHWM) of the process (Linux >= 4.0)
+    void resetPeakRss() {
+        QFile clearRefs("/proc/self/clear_refs");
+        if (clearRefs.open(QFile::WriteOnly)) clearRefs.write("5");
+    }
+
+    qint64 statusValueKb(const QByteArray& key) {
+        QFile status("/proc/self/status");
+        if (!status.open(QFile::ReadOnly)) return -1;
+        for (const auto& line : status.readAll().split('\n')) {
+            if (line.startsWith(key)) return line.mid(key.size()).trimmed().split(' ').first().toLongLong();
+        }
+        return -1;
+    }
+
+    void writeCatalog(const QString& fileName, int count) {
+        QFile file(fileName);
+        file.open(QFile::WriteOnly);
+        QTextStream out(&file);
+        out << R"({"return_code": 200, "error_message": "", "collection_name": "Benchmark",)"
+            << R"( "collection_version": "v1", "recipes": [)" << '\n';
+        for (int i = 0; i < count; ++i) {
+            out << (i ? ",\n" : "")
+                << R"(  {"name": "Recipe )" << i << R"(", "beans_g": )" << (8 + i % 20)
+                << R"(, "grind_level": "medium", "water_ml": )" << (30 + i % 300)
+                << R"(, "water_temp": 92)";
+            if (i % 2) out << R"(, "milk": {"milk_ml": 120, "milk_temp": 80, "foam_ml": 20})";
+            out << '}';
+        }
+        out << "\n]}\n";
+    }
+
+    Result runStreaming(const QString& fileName) {
+        Result result;
+        resetPeakRss();
+        QElapsedTimer timer;
+        timer.start();
+
+        RecipeStreamParser parser([&](const QVector<Recipe>& recipes) {
+            if (result.recipes == 0) result.firstRecipeMs = timer.nsecsElapsed() / 1e6;
+            result.recipes += recipes.size();
+        });
+
+        QFile file(fileName);
+        file.open(QFile::ReadOnly);
+        while (!file.atEnd()) parser.feed(file.read(64 * 1024));
+        parser.finish();
+
+        result.totalMs = timer.nsecsElapsed() / 1e6;
+        result.peakRssKb = statusValueKb("VmHWM:");
+        return result;
+    }
+
+    Result runDocument(const QString& fileName) {
+        Result result;
+        resetPeakRss();
+        QElapsedTimer timer;
+        timer.start();
+
+        QFile file(fileName);
+        file.open(QFile::ReadOnly);
+        const auto recipesJson = QJsonDocument::fromJson(file.readAll()).object().value("recipes").toArray();
+        QVector<Recipe> recipes;
+        recipes.reserve(recipesJson.size());
+        for (const auto& value : recipesJson) {
+            recipes.append(Recipe::fromJson(value.toObject()));
+            if (recipes.size() == 1) result.firstRecipeMs = timer.nsecsElapsed() / 1e6;
+        }
+
+        result.totalMs = timer.nsecsElapsed() / 1e6;
+        result.peakRssKb = statusValueKb("VmHWM:");
+        result.recipes = recipes.size();
+        return result;
+    }
+}
+
+// Compares the streaming recipe parser with parsing the whole document at once:
+//   recipe-stream-bench [recipe count, default 100000]
+int main(int argc, char** argv)
+{
+  QCoreApplication app(argc, argv);
+  const auto count = app.arguments().size() > 1 ? app.arguments().at(1).toInt() : 100000;
+
+  QTemporaryDir dir;
+  const auto fileName = dir.filePath("recipes.json");
+  writeCatalog(fileName, count);
+
+  QTextStream out(stdout);
+  out << "recipes: " << count << ", file size: " << QFile(fileName).size() / 1024 << " KiB\n"
+      << "baseline RSS: " << statusValueKb("VmRSS:") << " KiB\n";
+
+  // streaming first, so the document run can not lower its peak
+  const auto print = [&out](const char* name, const Result& r) {
+    out << name << ": first recipe " << r.firstRecipeMs << " ms, total " << r.totalMs
+        << " ms, peak RSS " << r.peakRssKb << " KiB, recipes " << r.recipes << '\n';
+  };
+  print("streaming", runStreaming(fileName));
+  print("document ", runDocument(fileName));
+  return 0;
+}
@@ -0,0 +1,196 @@
+// Bio-Hybrid Coffee Machine Example - Copyright (c) 2021 Bio-Hybrid GmbH
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QHostAddress>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QDebug>
+
+#include <array>
+
+// -------------------------------------------------------------------------------------------------
+namespace {
+    struct Stats
+    {
+        quint64 connections = 0;
+        quint64 requests = 0;
+        quint64 notModified = 0;
+        quint64 compressed = 0;
+        quint64 bytesSent = 0;
+        quint64 bodyBytesUncompressed = 0;
+    };
+
+    quint32 crc32(const QByteArray& data) {
+        static const auto table = []() {
+            std::array<quint32, 256> t {};
+            for (quint32 i = 0; i < 256; ++i) {
+                quint32 c = i;
+                for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                t[i] = c;
+            }
+            return t;
+        }();
+        quint32 crc = 0xFFFFFFFFu;
+        for (const auto byte : data) crc = table[(crc ^ quint8(byte)) & 0xFF] ^ (crc >> 8);
+        return crc ^ 0xFFFFFFFFu;
+    }
+
+    void appendLE32(QByteArray& out, quint32 value) {
+        for (int i = 0; i < 4; ++i) out.append(char((value >> (8 * i)) & 0xFF));
+    }
+
+    // HTTP 'deflate' is a zlib stream, that is what qCompress() produces after its size prefix
+    QByteArray deflate(const QByteArray& data) {
+        return qCompress(data, 9).mid(4);
+    }
+
+    // gzip wraps the raw deflate data of the zlib stream (without 2 byte header, 4 byte adler32)
+    QByteArray gzip(const QByteArray& data) {
+        const auto zlib = deflate(data);
+        QByteArray out("\x1f\x8b\x08\x00\x00\x00\x00\x00\x00\x03", 10);
+        out.append(zlib.mid(2, zlib.size() - 6));
+        appendLE32(out, crc32(data));
+        appendLE32(out, quint32(data.size()));
+        return out;
+    }
+
+    class RecipeServer : public QObject
+    {
+    public:
+        explicit RecipeServer(const QDir& root) : root_(root) {
+            QObject::connect(&server_, &QTcpServer::newConnection, this, [this]() {
+                while (const auto socket = server_.nextPendingConnection()) {
+                    ++stats_.connections;
+                    QObject::connect(socket, &QTcpSocket::readyRead, this, [this, socket]() { onReadyRead(socket); });
+                    QObject::connect(socket, &QTcpSocket::disconnected, this, [this, socket]() {
+                        buffers_.remove(socket);
+                        socket->deleteLater();
+                    });
+                }
+            });
+        }
+
+        bool listen(quint16 port) { return server_.listen(QHostAddress::LocalHost, port); }
+        quint16 port() const { return server_.serverPort(); }
+
+    private:
+        void onReadyRead(QTcpSocket* socket) {
+            auto& buffer = buffers_[socket];
+            buffer.append(socket->readAll());
+
+            // requests without body, possibly several per connection (keep-alive)
+            for (int end = buffer.indexOf("\r\n\r\n"); end >= 0; end = buffer.indexOf("\r\n\r\n")) {
+                const auto request = buffer.left(end);
+                buffer.remove(0, end + 4);
+                handleRequest(socket, request);
+            }
+        }
+
+        void handleRequest(QTcpSocket* socket, const QByteArray& request) {
+            ++stats_.requests;
+            const auto lines = request.split('\n');
+            const auto requestLine = lines.first().trimmed().split(' ');
+            QByteArray ifNoneMatch, acceptEncoding;
+            bool keepAlive = requestLine.value(2) == "HTTP/1.1";
+            for (int i = 1; i < lines.size(); ++i) {
+                const auto colon = lines[i].indexOf(':');
+                if (colon < 0) continue;
+                const auto name = lines[i].left(colon).trimmed().toLower();
+                const auto value = lines[i].mid(colon + 1).trimmed();
+                if (name == "if-none-match") ifNoneMatch = value;
+                else if (name == "accept-encoding") acceptEncoding = value.toLower();
+                else if (name == "connection") keepAlive = value.toLower() != "close";
+            }
+
+            const auto path = QString::fromUtf8(requestLine.value(1));
+            if (requestLine.value(0) != "GET") {
+                send(socket, "405 Method Not Allowed", {}, {}, keepAlive);
+                return;
+            }
+
+            if (path == "/stats") {
+                const auto body = QString(R"({"connections": %1, "requests": %2, "not_modified": %3, )"
+                                          R"("compressed": %4, "bytes_sent": %5, "body_bytes_uncompressed": %6})")
+                    .arg(stats_.connections).arg(stats_.requests).arg(stats_.notModified)
+                    .arg(stats_.compressed).arg(stats_.bytesSent).arg(stats_.bodyBytesUncompressed).toUtf8();
+                send(socket, "200 OK", {"Content-Type: application/json"}, body, keepAlive);
+                return;
+            }
+
+            QFile file(root_.filePath(path.mid(1)));
+            if (path.contains("..") || !file.open(QFile::ReadOnly)) {
+                send(socket, "404 Not Found", {}, {}, keepAlive);
+                return;
+            }
+
+            const auto content = file.readAll();
+            const auto etag = '"' + QCryptographicHash::hash(content, QCryptographicHash::Sha1).toHex() + '"';
+            if (ifNoneMatch == etag) {
+                ++stats_.notModified;
+                send(socket, "304 Not Modified", {"ETag: " + etag}, {}, keepAlive);
+                return;
+            }
+
+            QList<QByteArray> headers {"Content-Type: application/json", "ETag: " + etag};
+            QByteArray body = content;
+            if (acceptEncoding.contains("gzip")) {
+                body = gzip(content);
+                headers << "Content-Encoding: gzip";
+            } else if (acceptEncoding.contains("deflate")) {
+                body = deflate(content);
+                headers << "Content-Encoding: deflate";
+            }
+            if (body.size() != content.size()) ++stats_.compressed;
+            stats_.bodyBytesUncompressed += quint64(content.size());
+            send(socket, "200 OK", headers, body, keepAlive);
+        }
+
+        void send(QTcpSocket* socket, const QByteArray& status, const QList<QByteArray>& headers,
+                  const QByteArray& body, bool keepAlive)
+        {
+            QByteArray response = "HTTP/1.1 " + status + "\r\n";
+            for (const auto& header : headers) response += header + "\r\n";
+            response += "Content-Length: " + QByteArray::number(body.size()) + "\r\n";
+            response += keepAlive ? "Connection: keep-alive\r\n\r\n" : "Connection: close\r\n\r\n";
+            response += body;
+
+            stats_.bytesSent += quint64(response.size());
+            socket->write(response);
+            qInfo().noquote() << status << "-" << body.size() << "bytes, total sent:" << stats_.bytesSent
+                              << "connections:" << stats_.connections << "requests:" << stats_.requests;
+            if (!keepAlive) socket->disconnectFromHost();
+        }
+
+        QDir root_;
+        QTcpServer server_;
+        QHash<QTcpSocket*, QByteArray> buffers_;
+        Stats stats_;
+    };
+}
+
+// Serves recipe JSON files on localhost with keep-alive, gzip/deflate and ETags, e.g.:
+//   recipe-test-server --port 8080 third-party/libcoffeeweb/src
+//   CoffeeMachine --recipes-url http://localhost:8080/recipes.json
+// Connection reuse and bytes on the wire are reported per request and via GET /stats.
+int main(int argc, char** argv)
+{
+  QCoreApplication app(argc, argv);
+
+  QCommandLineParser parser;
+  parser.setApplicationDescription("Local HTTP server for recipe files");
+  parser.addHelpOption();
+  parser.addOption({"port", "Port to listen on (default: 8080).", "port", "8080"});
+  parser.addPositionalArgument("directory", "Directory with the recipe files.");
+  parser.process(app);
+
+  RecipeServer server(QDir(parser.positionalArguments().value(0, ".")));
+  if (!server.listen(quint16(parser.value("port").toUInt()))) {
+    qCritical() << "Could not listen on port" << parser.value("port");
+    return 1;
+  }
+  qInfo() << "Serving recipes on http://localhost:" << server.port();
+  return app.exec();
+}
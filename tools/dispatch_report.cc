@@ -0,0 +1,266 @@
+// Bio-Hybrid Coffee Machine Example - Copyright (c) 2021 Bio-Hybrid GmbH
+#include "machine_dispatcher.h"
+
+#include <coffeemaker/benchsupport.h>
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QEventLoop>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRandomGenerator>
+#include <QTextStream>
+#include <QTimer>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <vector>
+
+// -------------------------------------------------------------------------------------------------
+namespace {
+    struct Arrival {
+        double atMs;
+        int recipe;
+    };
+
+    struct Result {
+        QString routing;
+        std::vector<double> waitsMs;
+        double lastFinishMs = 0;
+        int aborted = 0;
+        double routeNs = 0;
+    };
+
+    /// Each route() is timed this many times, a single call is below the clock resolution
+    constexpr int routeRepeats = 256;
+
+    std::vector<Arrival> generateTrace(int recipes, int count, double perMinute, quint32 seed)
+    {
+        QRandomGenerator random(seed);
+        std::vector<Arrival> trace;
+        double at = 0;
+        for (int i = 0; i < count; ++i) {
+            at += -std::log(1.0 - random.generateDouble()) * 60000.0 / perMinute;
+            trace.push_back({at, int(random.bounded(quint32(recipes)))});
+        }
+        return trace;
+    }
+
+    /// Machines of a cafeteria in the middle of the day: some low, some due for a cleaning
+    CoffeeMaker* createMachine(int machineId, HardwareModel model, QRandomGenerator& random)
+    {
+        const auto levels = std::visit([&](auto profile) {
+            using Profile = decltype(profile);
+            CoffeeMaker::Levels filled;
+            filled.beans = int(random.bounded(Profile::beansMax / 10, Profile::beansMax + 1));
+            filled.water = int(random.bounded(Profile::waterMax / 6, Profile::waterMax + 1));
+            filled.milk = int(random.bounded(0, Profile::milkMax + 1));
+            filled.restBin = int(random.bounded(0, Profile::restBinMax * 5 / 6));
+            filled.cupsProcessed = int(random.bounded(0, Profile::maxCupsUntilCleanReq));
+            return filled;
+        }, hardwareProfile(model));
+        const auto maker = new CoffeeMaker(model, levels);
+        maker->setMachineId(machineId);
+        return maker;
+    }
+
+    /// The staff fixes a stalled machine after the time the dispatcher expects
+    void attend(CoffeeMaker* maker, const MachineDispatcher::StallTimes& stalls, double timeScale)
+    {
+        QObject::connect(maker, &CoffeeMaker::currentStateChanged, maker, [=](CoffeeMaker::State state) {
+            const auto later = [=](double ms, std::function<void()> fix) {
+                QTimer::singleShot(int(ms * timeScale), maker, [=]() {
+                    if (maker->currentState() == state) fix();
+                });
+            };
+            switch (state) {
+            case CoffeeMaker::State::CleaningRequired:
+                later(stalls.cleaningMs, [maker]() { maker->cleanTheMachine(); });
+                break;
+            case CoffeeMaker::State::BinFull:
+                later(stalls.emptyingMs, [maker]() { maker->emptyRestBinContainer(); });
+                break;
+            case CoffeeMaker::State::OverflowFull:
+                later(stalls.emptyingMs, [maker]() { maker->emptyOverflowContainer(); });
+                break;
+            case CoffeeMaker::State::BeansEmpty:
+                later(stalls.refillMs, [maker]() { maker->addBeanstoContainer(maker->beansContainerMax()); });
+                break;
+            case CoffeeMaker::State::WaterEmpty:
+                later(stalls.refillMs, [maker]() { maker->addWatertoContainer(maker->waterContainerMax()); });
+                break;
+            case CoffeeMaker::State::MilkEmpty:
+                later(stalls.refillMs, [maker]() { maker->addMilkToContainer(maker->milkContainerMax()); });
+                break;
+            default:
+                break;
+            }
+        });
+    }
+
+    Result run(MachineDispatcher::Routing routing, const QString& name, const std::vector<HardwareModel>& models,
+               quint32 seed, double timeScale, const std::vector<Arrival>& trace, const std::vector<Recipe>& recipes)
+    {
+        Result result;
+        result.routing = name;
+
+        MachineDispatcher dispatcher(routing);
+        dispatcher.setTimeScale(timeScale);
+        const MachineDispatcher::StallTimes stalls;
+        QRandomGenerator random(seed);
+        for (size_t i = 0; i < models.size(); ++i) {
+            const auto maker = createMachine(int(i) + 1, models[i], random);
+            maker->setTimeScale(timeScale);
+            attend(maker, stalls, timeScale);
+            dispatcher.addMachine(maker);
+        }
+
+        QEventLoop loop;
+        size_t done = 0;
+        const auto complete = [&]() {
+            result.lastFinishMs = dispatcher.nowMs();
+            if (++done == trace.size()) loop.quit();
+        };
+        QObject::connect(&dispatcher, &MachineDispatcher::orderFinished, &loop, [&](quint64, int, double waitMs) {
+            result.waitsMs.push_back(waitMs);
+            complete();
+        });
+        QObject::connect(&dispatcher, &MachineDispatcher::orderAborted, &loop, [&]() {
+            ++result.aborted;
+            complete();
+        });
+
+        QElapsedTimer routeTimer;
+        qint64 routeNs = 0;
+        for (const auto& arrival : trace) {
+            QTimer::singleShot(int(arrival.atMs * timeScale), &loop, [&, arrival]() {
+                const auto& recipe = recipes[size_t(arrival.recipe)];
+                int picked = 0;
+                routeTimer.start();
+                for (int i = 0; i < routeRepeats; ++i) picked += dispatcher.route(recipe);
+                routeNs += routeTimer.nsecsElapsed();
+                Q_UNUSED(picked)
+                dispatcher.dispatch(recipe);
+            });
+        }
+        loop.exec();
+        result.routeNs = double(routeNs) / double(trace.size() * routeRepeats);
+        return result;
+    }
+
+    /// Routing cost only: banks of growing size with queued orders, the event loop never runs
+    void benchRouting(QTextStream& out, const std::vector<Recipe>& recipes, quint32 seed)
+    {
+        out << qSetFieldWidth(12) << left << "machines" << "ns/route" << "round-robin" << qSetFieldWidth(0) << '\n';
+        for (int machines = 4; machines <= 1024; machines *= 4) {
+            out << qSetFieldWidth(12) << left << machines;
+            for (const auto routing : {MachineDispatcher::Routing::EarliestCompletion, MachineDispatcher::Routing::RoundRobin}) {
+                MachineDispatcher dispatcher(routing);
+                QRandomGenerator random(seed);
+                for (int i = 0; i < machines; ++i) {
+                    dispatcher.addMachine(createMachine(i + 1, HardwareModel::Standard, random));
+                }
+                for (int i = 0; i < 4 * machines; ++i) {
+                    dispatcher.dispatch(recipes[random.bounded(quint32(recipes.size()))]);
+                }
+
+                constexpr int calls = 200000;
+                int picked = 0;
+                QElapsedTimer timer;
+                timer.start();
+                for (int i = 0; i < calls; ++i) picked += dispatcher.route(recipes[size_t(i) % recipes.size()]);
+                out << double(timer.nsecsElapsed()) / calls;
+                Q_UNUSED(picked)
+            }
+            out << qSetFieldWidth(0) << '\n';
+        }
+    }
+}
+
+// Replays one arrival trace on a bank of time-compressed machines with earliest completion and
+// round-robin routing and compares wait times and throughput, e.g.:
+//   coffee-dispatch-report --machines 4 --orders 400 --rate 60
+//   coffee-dispatch-report --machines 6 --models cafe,compact,standard
+//   coffee-dispatch-report --bench
+int main(int argc, char** argv)
+{
+  QCoreApplication app(argc, argv);
+
+  QCommandLineParser parser;
+  parser.setApplicationDescription("Order routing over a bank of coffee machines");
+  parser.addHelpOption();
+  parser.addOption({"machines", "Machines in the bank (default: 4).", "n", "4"});
+  parser.addOption({"models", "Hardware models of the bank, cycled, e.g. cafe,compact (default: standard).",
+                    "list", "standard"});
+  parser.addOption({"orders", "Orders of the generated trace (default: 400).", "n", "400"});
+  parser.addOption({"rate", "Orders per minute (default: 40).", "n", "40"});
+  parser.addOption({"seed", "Random seed of the trace and the machine levels (default: 1).", "seed", "1"});
+  parser.addOption({"recipes", "Recipes JSON file.", "file", COFFEE_DEFAULT_RECIPES});
+  parser.addOption({"time-scale", "Real time per machine time (default: 0.001).", "factor", "0.001"});
+  parser.addOption({"bench", "Only measure the routing cost for growing banks."});
+  parser.process(app);
+
+  QTextStream out(stdout);
+  QTextStream err(stderr);
+
+  QFile recipesFile(parser.value("recipes"));
+  if (!recipesFile.open(QFile::ReadOnly)) {
+    err << parser.value("recipes") << ": " << recipesFile.errorString() << endl;
+    return 1;
+  }
+  std::vector<Recipe> recipes;
+  const auto recipeArray = QJsonDocument::fromJson(recipesFile.readAll()).object().value("recipes").toArray();
+  for (const auto& value : recipeArray) recipes.push_back(Recipe::fromJson(value.toObject()));
+  if (recipes.empty()) {
+    err << "No recipes in " << parser.value("recipes") << endl;
+    return 1;
+  }
+
+  // Every machine persists its levels and snapshots, keep them away from the real machine's settings
+  const SettingsSandbox settingsSandbox;
+
+  const auto seed = parser.value("seed").toUInt();
+  if (parser.isSet("bench")) {
+    benchRouting(out, recipes, seed);
+    return 0;
+  }
+
+  const auto machines = qBound(1, parser.value("machines").toInt(), 4096);
+  std::vector<HardwareModel> cycle;
+  for (const auto& name : parser.value("models").split(',', QString::SkipEmptyParts)) {
+    auto model = HardwareModel::Standard;
+    if (!parseHardwareModel(name.trimmed(), &model)) {
+      err << "Unknown hardware model " << name << endl;
+      return 1;
+    }
+    cycle.push_back(model);
+  }
+  if (cycle.empty()) cycle.push_back(HardwareModel::Standard);
+  std::vector<HardwareModel> models;
+  for (int i = 0; i < machines; ++i) models.push_back(cycle[size_t(i) % cycle.size()]);
+  const auto timeScale = qBound(1e-5, parser.value("time-scale").toDouble(), 1.0);
+  const auto trace = generateTrace(int(recipes.size()), qMax(1, parser.value("orders").toInt()),
+                                   qMax(0.1, parser.value("rate").toDouble()), seed);
+
+  const std::vector<Result> results = {
+    run(MachineDispatcher::Routing::EarliestCompletion, "earliest", models, seed, timeScale, trace, recipes),
+    run(MachineDispatcher::Routing::RoundRobin, "round-robin", models, seed, timeScale, trace, recipes),
+  };
+
+  out << trace.size() << " orders on " << machines << " machines (" << parser.value("models") << ") over " << trace.back().atMs / 60000
+      << " min, wait times in s\n\n";
+  out << qSetFieldWidth(12) << left << "routing" << "cups/h" << "mean" << "p95" << "max" << "aborted"
+      << "ns/route" << qSetFieldWidth(0) << '\n';
+  for (const auto& result : results) {
+    out << qSetFieldWidth(12) << left << result.routing
+        << double(result.waitsMs.size()) / (result.lastFinishMs / 3600000)
+        << mean(result.waitsMs) / 1000 << percentile(result.waitsMs, 95) / 1000
+        << percentile(result.waitsMs, 100) / 1000 << result.aborted << result.routeNs
+        << qSetFieldWidth(0) << '\n';
+  }
+  out.flush();
+  return 0;
+}
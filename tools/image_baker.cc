@@ -0,0 +1,126 @@
+// Bio-Hybrid Coffee Machine Example - Copyright (c) 2021 Bio-Hybrid GmbH
+#include "baked_image.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFileInfo>
+#include <QImage>
+#include <QSaveFile>
+#include <QSize>
+#include <QTextStream>
+#include <QDebug>
+
+#include <cstring>
+
+// -------------------------------------------------------------------------------------------------
+namespace {
+    /// Writes the image as pre-decoded pixels in the BakedImage layout
+    bool writeBaked(const QImage& image, const QString& fileName)
+    {
+        BakedImage::Header header;
+        std::memcpy(header.magic, BakedImage::magic, sizeof(header.magic));
+        header.width = quint32(image.width());
+        header.height = quint32(image.height());
+        header.bytesPerLine = quint32(image.bytesPerLine());
+        header.format = quint32(image.format());
+        header.reserved[0] = 0;
+        header.reserved[1] = 0;
+
+        QSaveFile output(fileName);
+        const auto pixelBytes = qint64(image.height()) * image.bytesPerLine();
+        if (!output.open(QFile::WriteOnly)
+            || output.write(reinterpret_cast<const char*>(&header), sizeof(header)) != sizeof(header)
+            || output.write(reinterpret_cast<const char*>(image.constBits()), pixelBytes) != pixelBytes
+            || !output.commit()) {
+            qCritical() << qPrintable(fileName) << ":" << qPrintable(output.errorString());
+            return false;
+        }
+        return true;
+    }
+
+    bool parseSize(const QString& text, QSize* size)
+    {
+        const auto parts = text.split('x');
+        bool okWidth = false, okHeight = false;
+        if (parts.size() == 2) *size = QSize(parts.at(0).toInt(&okWidth), parts.at(1).toInt(&okHeight));
+        return okWidth && okHeight && !size->isEmpty();
+    }
+}
+
+// Scales images to the sizes they are shown at and stores them pre-decoded, together with a
+// resource file listing all variants under the "/baked" prefix:
+//   image-baker <output-dir> <image>[:<w>x<h>[,<w>x<h>...]]...
+// Without sizes the image is baked at its original size. Variants are named <base>@<w>x<h>.cwimg.
+int main(int argc, char** argv)
+{
+  QCoreApplication app(argc, argv);
+
+  const auto args = app.arguments();
+  if (args.size() < 3) {
+    qCritical() << "usage: image-baker <output-dir> <image>[:<w>x<h>[,<w>x<h>...]]...";
+    return 2;
+  }
+
+  const QDir outputDir(args.at(1));
+  if (!outputDir.mkpath(".")) {
+    qCritical() << "Cannot create" << qPrintable(args.at(1));
+    return 1;
+  }
+
+  QStringList variants;
+  for (const auto& arg : args.mid(2)) {
+    // Windows paths may contain a drive colon, the size list follows the last one
+    const auto colon = arg.lastIndexOf(':');
+    const auto hasSizes = colon > 1;
+    const auto fileName = hasSizes ? arg.left(colon) : arg;
+
+    QImage image(fileName);
+    if (image.isNull()) {
+      qCritical() << "Cannot read image" << qPrintable(fileName);
+      return 1;
+    }
+    // The formats the scene graph uploads without conversion
+    image = image.convertToFormat(image.hasAlphaChannel() ? QImage::Format_ARGB32_Premultiplied
+                                                          : QImage::Format_RGB32);
+
+    QVector<QSize> sizes;
+    if (hasSizes) {
+      for (const auto& sizeText : arg.mid(colon + 1).split(',')) {
+        QSize size;
+        if (!parseSize(sizeText, &size)) {
+          qCritical() << "Invalid size" << qPrintable(sizeText) << "for" << qPrintable(fileName);
+          return 1;
+        }
+        sizes.append(size);
+      }
+    } else {
+      sizes.append(image.size());
+    }
+
+    const auto baseName = QFileInfo(fileName).completeBaseName();
+    for (const auto& size : sizes) {
+      const auto scaled = size == image.size() ? image
+                        : image.scaled(size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+      const auto variant = QString("%1@%2x%3.%4").arg(baseName).arg(size.width()).arg(size.height())
+                                                 .arg(BakedImage::fileSuffix);
+      if (!writeBaked(scaled, outputDir.filePath(variant))) return 1;
+      variants.append(variant);
+    }
+  }
+
+  QSaveFile qrc(outputDir.filePath("baked_images.qrc"));
+  if (!qrc.open(QFile::WriteOnly | QFile::Text)) {
+    qCritical() << qPrintable(qrc.fileName()) << ":" << qPrintable(qrc.errorString());
+    return 1;
+  }
+  QTextStream out(&qrc);
+  out << "<RCC>\n    <qresource prefix=\"/baked\">\n";
+  for (const auto& variant : variants) out << "        <file>" << variant << "</file>\n";
+  out << "    </qresource>\n</RCC>\n";
+  out.flush();
+  if (!qrc.commit()) {
+    qCritical() << qPrintable(qrc.fileName()) << ":" << qPrintable(qrc.errorString());
+    return 1;
+  }
+  return 0;
+}
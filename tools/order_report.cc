@@ -0,0 +1,255 @@
+// Bio-Hybrid Coffee Machine Example - Copyright (c) 2021 Bio-Hybrid GmbH
+#include "order_queue.h"
+
+#include <coffeemaker/benchsupport.h>
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QEventLoop>
+#include <QFile>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRandomGenerator>
+#include <QSaveFile>
+#include <QTextStream>
+#include <QTimer>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// -------------------------------------------------------------------------------------------------
+namespace {
+    struct Arrival {
+        double atMs;
+        QString recipe;
+    };
+
+    struct Result {
+        QString policy;
+        std::vector<double> waitsMs;
+        QHash<QString, std::vector<double>> waitsByRecipe;
+        int aborted = 0;
+        CoffeeMaker::ThermalReport thermal;
+    };
+
+    /// Reads a trace with one "<seconds> <recipe name>" per line, # starts a comment
+    std::vector<Arrival> readTrace(const QString& fileName, QString& error)
+    {
+        std::vector<Arrival> trace;
+        QFile file(fileName);
+        if (!file.open(QFile::ReadOnly | QFile::Text)) {
+            error = file.errorString();
+            return trace;
+        }
+        int lineNumber = 0;
+        while (!file.atEnd()) {
+            ++lineNumber;
+            const auto line = QString::fromUtf8(file.readLine()).section('#', 0, 0).trimmed();
+            if (line.isEmpty()) continue;
+            bool ok = false;
+            const auto seconds = line.section(' ', 0, 0).toDouble(&ok);
+            const auto recipe = line.section(' ', 1).trimmed();
+            if (!ok || recipe.isEmpty()) {
+                error = QString("line %1: expected <seconds> <recipe name>").arg(lineNumber);
+                return {};
+            }
+            trace.push_back({seconds * 1000, recipe});
+        }
+        std::stable_sort(trace.begin(), trace.end(), [](const Arrival& a, const Arrival& b) { return a.atMs < b.atMs; });
+        return trace;
+    }
+
+    /// Poisson arrivals of uniformly chosen recipes
+    std::vector<Arrival> generateTrace(const QStringList& recipes, int count, double perMinute, quint32 seed)
+    {
+        QRandomGenerator random(seed);
+        std::vector<Arrival> trace;
+        double at = 0;
+        for (int i = 0; i < count; ++i) {
+            at += -std::log(1.0 - random.generateDouble()) * 60000.0 / perMinute;
+            trace.push_back({at, recipes[int(random.bounded(quint32(recipes.size())))]});
+        }
+        return trace;
+    }
+
+    /// Keeps the machine going like an attentive barista, refills and cleanings take no time
+    void attend(CoffeeMaker& maker)
+    {
+        QObject::connect(&maker, &CoffeeMaker::currentStateChanged, &maker, [&maker](CoffeeMaker::State state) {
+            switch (state) {
+            case CoffeeMaker::State::Off: maker.turnOn(); break;
+            case CoffeeMaker::State::BeansEmpty: maker.addBeanstoContainer(maker.beansContainerMax()); break;
+            case CoffeeMaker::State::WaterEmpty: maker.addWatertoContainer(maker.waterContainerMax()); break;
+            case CoffeeMaker::State::MilkEmpty: maker.addMilkToContainer(maker.milkContainerMax()); break;
+            case CoffeeMaker::State::BinFull: maker.emptyRestBinContainer(); break;
+            case CoffeeMaker::State::OverflowFull: maker.emptyOverflowContainer(); break;
+            case CoffeeMaker::State::CleaningRequired: maker.cleanTheMachine(); break;
+            default: break;
+            }
+        });
+    }
+
+    Result run(SchedulingPolicy policy, const QString& name, double agingRate, double timeScale,
+               const std::vector<Arrival>& trace, const QHash<QString, Recipe>& recipes)
+    {
+        Result result;
+        result.policy = name;
+
+        CoffeeMaker::Levels levels;
+        CoffeeMaker maker(levels);
+        maker.setTimeScale(timeScale);
+        attend(maker);
+        CoffeeMaker::Maintenance fill;
+        fill.addBeansGram = maker.beansContainerMax();
+        fill.addWaterMl = maker.waterContainerMax();
+        fill.addMilkMl = maker.milkContainerMax();
+        maker.applyMaintenance(fill);
+
+        OrderQueue queue(&maker, policy, agingRate);
+        queue.setTimeScale(timeScale);
+
+        QEventLoop loop;
+        QHash<quint64, QString> recipeOf;
+        size_t done = 0;
+        const auto complete = [&]() {
+            if (++done == trace.size()) loop.quit();
+        };
+        QObject::connect(&queue, &OrderQueue::orderFinished, &loop, [&](quint64 id, double waitMs) {
+            result.waitsMs.push_back(waitMs);
+            result.waitsByRecipe[recipeOf.value(id)].push_back(waitMs);
+            complete();
+        });
+        QObject::connect(&queue, &OrderQueue::orderAborted, &loop, [&]() {
+            ++result.aborted;
+            complete();
+        });
+
+        // The arrivals are replayed in machine time, the queue measures in machine time as well
+        for (const auto& arrival : trace) {
+            QTimer::singleShot(int(arrival.atMs * timeScale), &loop, [&, arrival]() {
+                recipeOf.insert(queue.enqueue(recipes.value(arrival.recipe)), arrival.recipe);
+            });
+        }
+        maker.turnOn();
+        loop.exec();
+        result.thermal = maker.thermalReport();
+        return result;
+    }
+}
+
+// Replays one arrival trace with every scheduling policy on a time-compressed machine and reports
+// the customer wait times, e.g.:
+//   coffee-order-report --orders 300 --rate 7 --record trace.txt
+//   coffee-order-report --trace trace.txt
+int main(int argc, char** argv)
+{
+  QCoreApplication app(argc, argv);
+
+  QCommandLineParser parser;
+  parser.setApplicationDescription("Customer wait times of the order scheduling policies");
+  parser.addHelpOption();
+  parser.addOption({"trace", "Arrival trace, one \"<seconds> <recipe name>\" per line.", "file"});
+  parser.addOption({"record", "Write the generated trace to <file>.", "file"});
+  parser.addOption({"orders", "Orders of a generated trace (default: 200).", "n", "200"});
+  parser.addOption({"rate", "Orders per minute of a generated trace (default: 7).", "n", "7"});
+  parser.addOption({"seed", "Random seed of a generated trace (default: 1).", "seed", "1"});
+  parser.addOption({"recipes", "Recipes JSON file.", "file", COFFEE_DEFAULT_RECIPES});
+  parser.addOption({"aging", "Aging rate, ms of estimate per ms waited (default: 0.5).", "rate", "0.5"});
+  parser.addOption({"time-scale", "Real time per machine time (default: 0.001).", "factor", "0.001"});
+  parser.process(app);
+
+  QTextStream out(stdout);
+  QTextStream err(stderr);
+
+  QFile recipesFile(parser.value("recipes"));
+  if (!recipesFile.open(QFile::ReadOnly)) {
+    err << parser.value("recipes") << ": " << recipesFile.errorString() << endl;
+    return 1;
+  }
+  QHash<QString, Recipe> recipes;
+  QStringList names;
+  const auto recipeArray = QJsonDocument::fromJson(recipesFile.readAll()).object().value("recipes").toArray();
+  for (const auto& value : recipeArray) {
+    const auto recipe = Recipe::fromJson(value.toObject());
+    recipes.insert(recipe.name, recipe);
+    names.append(recipe.name);
+  }
+  if (names.isEmpty()) {
+    err << "No recipes in " << parser.value("recipes") << endl;
+    return 1;
+  }
+
+  std::vector<Arrival> trace;
+  if (parser.isSet("trace")) {
+    QString error;
+    trace = readTrace(parser.value("trace"), error);
+    if (!error.isEmpty()) {
+      err << parser.value("trace") << ": " << error << endl;
+      return 1;
+    }
+    for (const auto& arrival : trace) {
+      if (!recipes.contains(arrival.recipe)) {
+        err << "Unknown recipe in trace: " << arrival.recipe << endl;
+        return 1;
+      }
+    }
+  } else {
+    trace = generateTrace(names, qMax(1, parser.value("orders").toInt()),
+                          qMax(0.1, parser.value("rate").toDouble()), parser.value("seed").toUInt());
+  }
+  if (trace.empty()) {
+    err << "The trace has no arrivals" << endl;
+    return 1;
+  }
+
+  if (parser.isSet("record")) {
+    QSaveFile file(parser.value("record"));
+    if (file.open(QFile::WriteOnly | QFile::Text)) {
+      QTextStream trace_out(&file);
+      trace_out << "# <seconds> <recipe name>\n";
+      for (const auto& arrival : trace) trace_out << arrival.atMs / 1000 << ' ' << arrival.recipe << '\n';
+      trace_out.flush();
+    }
+    if (!file.commit()) {
+      err << parser.value("record") << ": " << file.errorString() << endl;
+      return 1;
+    }
+  }
+
+  // The machine persists its levels and snapshots, keep them away from the real machine's settings
+  const SettingsSandbox settingsSandbox;
+
+  const auto agingRate = parser.value("aging").toDouble();
+  const auto timeScale = qBound(1e-5, parser.value("time-scale").toDouble(), 1.0);
+  const std::vector<Result> results = {
+    run(SchedulingPolicy::Fifo, "FIFO", agingRate, timeScale, trace, recipes),
+    run(SchedulingPolicy::ShortestJobFirst, "SJF", agingRate, timeScale, trace, recipes),
+    run(SchedulingPolicy::AgingShortestJobFirst, "SJF+aging", agingRate, timeScale, trace, recipes),
+  };
+
+  out << trace.size() << " orders over " << trace.back().atMs / 60000 << " min, wait times in s\n\n";
+  out << qSetFieldWidth(12) << left << "policy" << "mean" << "p95" << "max" << "aborted";
+  for (const auto& name : names) out << name.left(11);
+  out << qSetFieldWidth(0) << '\n';
+  for (const auto& result : results) {
+    out << qSetFieldWidth(12) << left << result.policy << mean(result.waitsMs) / 1000
+        << percentile(result.waitsMs, 95) / 1000
+        << percentile(result.waitsMs, 100) / 1000 << result.aborted;
+    for (const auto& name : names) out << mean(result.waitsByRecipe.value(name)) / 1000;
+    out << qSetFieldWidth(0) << '\n';
+  }
+
+  out << "\nBoiler preheat, heat-up waits and saved latency in s, energy in kJ\n\n";
+  out << qSetFieldWidth(12) << left << "policy" << "waited" << "saved" << "energy" << "preheat"
+      << qSetFieldWidth(0) << '\n';
+  for (const auto& result : results) {
+    out << qSetFieldWidth(12) << left << result.policy << result.thermal.heatUpWaitMs / 1000
+        << result.thermal.latencySavedMs / 1000 << result.thermal.energyJ / 1000
+        << result.thermal.preheatEnergyJ / 1000 << qSetFieldWidth(0) << '\n';
+  }
+  out.flush();
+  return 0;
+}
@@ -0,0 +1,161 @@
+// Bio-Hybrid Coffee Machine Example - Copyright (c) 2021 Bio-Hybrid GmbH
+#include "remote_protocol.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QLocalSocket>
+#include <QTextStream>
+
+#include <algorithm>
+#include <vector>
+
+using namespace RemoteProtocol;
+
+// -------------------------------------------------------------------------------------------------
+namespace {
+    struct Command {
+        const char* name;
+        Op op;
+    };
+
+    const Command commands[] = {
+        {"ping", Op::Ping}, {"status", Op::GetStatus}, {"turn-on", Op::TurnOn}, {"turn-off", Op::TurnOff},
+        {"start", Op::StartCommandMode}, {"cancel", Op::CancelCommandMode}, {"finish", Op::FinishCommandMode},
+        {"grind", Op::Grind}, {"brew", Op::Brew}, {"milk", Op::MilkPrep},
+        {"place-cup", Op::PlaceCup}, {"remove-cup", Op::RemoveCup},
+        {"add-water", Op::AddWater}, {"add-milk", Op::AddMilk}, {"add-beans", Op::AddBeans},
+        {"empty-overflow", Op::EmptyOverflow}, {"empty-rest-bin", Op::EmptyRestBin}, {"clean", Op::Clean},
+        {"service", Op::Service},
+    };
+
+    /// Blocks until the next frame arrived, false if the connection failed
+    bool readFrame(QLocalSocket& socket, QByteArray& in, Frame& frame) {
+        for (;;) {
+            int offset = 0;
+            bool valid = true;
+            if (take(in, offset, frame, valid)) {
+                in.remove(0, offset);
+                return valid;
+            }
+            if (!socket.waitForReadyRead(5000)) return false;
+            in += socket.readAll();
+        }
+    }
+
+    void printFrame(QTextStream& out, const Frame& frame) {
+        out << "id " << frame.id << " status " << frame.code;
+        for (int i = 0; i < frame.argumentCount; ++i) out << (i == 0 ? "  " : " ") << frame.arguments[i];
+        out << endl;
+    }
+}
+
+// Talks the RemoteProtocol to a CoffeeMachine started with --remote <name>, e.g.:
+//   coffee-remote turn-on
+//   coffee-remote brew 200 92
+//   coffee-remote --watch
+//   coffee-remote --bench 100000 --depth 64 status
+int main(int argc, char** argv)
+{
+  QCoreApplication app(argc, argv);
+
+  QCommandLineParser parser;
+  parser.setApplicationDescription("Remote control for the CoffeeMaker");
+  parser.addHelpOption();
+  parser.addOption({"name", "Local socket name (default: coffeemaker).", "name", "coffeemaker"});
+  parser.addOption({"watch", "Subscribe and print status notifications until interrupted."});
+  parser.addOption({"bench", "Send the command <count> times pipelined and report the rate.", "count"});
+  parser.addOption({"depth", "Requests in flight for --bench (default: 32).", "n", "32"});
+  parser.addPositionalArgument("command", "ping, status, turn-on, turn-off, start, cancel, finish, grind <g> <level>, "
+                                          "brew <ml> <temp>, milk <ml> <temp> <foam>, place-cup, remove-cup, "
+                                          "add-water <ml>, add-milk <ml>, add-beans <g>, empty-overflow, "
+                                          "empty-rest-bin, clean, service <water ml> <milk ml> <beans g> "
+                                          "<empty overflow> <empty rest bin> <clean>");
+  parser.process(app);
+
+  QTextStream out(stdout);
+  QTextStream err(stderr);
+
+  QLocalSocket socket;
+  socket.connectToServer(parser.value("name"));
+  if (!socket.waitForConnected(3000)) {
+    err << "Cannot connect to " << parser.value("name") << ": " << socket.errorString() << endl;
+    return 1;
+  }
+  QByteArray in;
+  Frame frame;
+
+  if (parser.isSet("watch")) {
+    QByteArray request;
+    append(request, 1, quint8(Op::Subscribe));
+    append(request, 2, quint8(Op::GetStatus));
+    socket.write(request);
+    for (;;) {
+      while (readFrame(socket, in, frame)) printFrame(out, frame);
+      if (socket.state() != QLocalSocket::ConnectedState) return 1;
+    }
+  }
+
+  const auto positional = parser.positionalArguments();
+  const auto command = std::find_if(std::begin(commands), std::end(commands), [&](const Command& c) {
+    return !positional.isEmpty() && positional.first() == c.name;
+  });
+  if (command == std::end(commands)) parser.showHelp(1);
+
+  qint32 arguments[maxArguments] = {};
+  const auto argumentCount = qMin(positional.size() - 1, maxArguments);
+  for (int i = 0; i < argumentCount; ++i) arguments[i] = positional[i + 1].toInt();
+
+  if (!parser.isSet("bench")) {
+    QByteArray request;
+    append(request, 1, quint8(command->op), arguments, argumentCount);
+    socket.write(request);
+    while (readFrame(socket, in, frame)) {
+      if (frame.id != 1) continue;
+      printFrame(out, frame);
+      return frame.code == quint8(Status::Ok) ? 0 : 2;
+    }
+    err << "No reply: " << socket.errorString() << endl;
+    return 1;
+  }
+
+  // Keeps `depth` requests in flight, refilling the pipeline with one write per read
+  const auto count = parser.value("bench").toUInt();
+  const auto depth = qMax(1u, parser.value("depth").toUInt());
+  std::vector<qint64> sentNs(count + 1);
+  std::vector<qint64> latenciesNs;
+  latenciesNs.reserve(count);
+  QElapsedTimer timer;
+  timer.start();
+
+  quint32 sent = 0;
+  quint32 received = 0;
+  quint32 failed = 0;
+  while (received < count) {
+    QByteArray requests;
+    while (sent < count && sent - received < depth) {
+      ++sent;
+      sentNs[sent] = timer.nsecsElapsed();
+      append(requests, sent, quint8(command->op), arguments, argumentCount);
+    }
+    if (!requests.isEmpty()) socket.write(requests);
+    if (!readFrame(socket, in, frame)) {
+      err << "Connection failed after " << received << " replies: " << socket.errorString() << endl;
+      return 1;
+    }
+    if (frame.id == 0 || frame.id > sent) continue;
+    latenciesNs.push_back(timer.nsecsElapsed() - sentNs[frame.id]);
+    if (frame.code != quint8(Status::Ok)) ++failed;
+    ++received;
+  }
+
+  const auto seconds = double(timer.nsecsElapsed()) / 1e9;
+  std::sort(latenciesNs.begin(), latenciesNs.end());
+  const auto percentileUs = [&](double p) {
+    return latenciesNs.empty() ? 0.0 : double(latenciesNs[size_t(p / 100.0 * double(latenciesNs.size() - 1))]) / 1000.0;
+  };
+  out << count << " x " << command->name << " in " << seconds << " s: " << double(count) / seconds << " ops/s, "
+      << failed << " failed\n"
+      << "latency us  p50 " << percentileUs(50) << "  p99 " << percentileUs(99) << "  max " << percentileUs(100) << endl;
+  return 0;
+}
@@ -0,0 +1,455 @@
+// Bio-Hybrid Coffee Machine Example - Copyright (c) 2021 Bio-Hybrid GmbH
+#include <coffeemaker/benchsupport.h>
+#include <coffeemaker/coffeemaker.h>
+#include <coffeeweb/coffeeweb.h>
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QRandomGenerator>
+#include <QSet>
+#include <QSettings>
+#include <QTextStream>
+#include <QTimer>
+
+#include <atomic>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <vector>
+
+#include <unistd.h>
+
+// -------------------------------------------------------------------------------------------------
+// Counts every allocation of the process, Qt's included, to see allocations that are never freed
+namespace {
+    std::atomic<quint64> allocations {0};
+    std::atomic<quint64> deallocations {0};
+}
+
+void* operator new(std::size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (const auto memory = std::malloc(size ? size : 1)) return memory;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept
+{
+    if (!memory) return;
+    deallocations.fetch_add(1, std::memory_order_relaxed);
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+    operator delete(memory);
+}
+
+// -------------------------------------------------------------------------------------------------
+namespace {
+    using State = CoffeeMaker::State;
+
+    struct Sample {
+        double simulatedHours = 0;
+        double realSeconds = 0;
+        qint64 rssKiB = 0;
+        qint64 liveAllocations = 0;
+        quint64 transitions = 0;    ///< in this sample's window
+        quint64 commands = 0;       ///< in this sample's window
+        double transitionsPerSecond = 0;
+    };
+
+    qint64 residentKiB()
+    {
+        QFile statm("/proc/self/statm");
+        if (!statm.open(QFile::ReadOnly)) return 0;
+        const auto fields = statm.readAll().split(' ');
+        return fields.size() > 1 ? fields[1].toLongLong() * sysconf(_SC_PAGESIZE) / 1024 : 0;
+    }
+
+    /// Returns if the state machine has a transition from `from` to `to`
+    bool isLegal(State from, State to)
+    {
+        if (to == State::Off) return true;
+        switch (from) {
+        case State::Unknown: return false;
+        case State::Off: return to == State::SelfCheck;
+        case State::SelfCheck:
+        case State::StandBy:
+            return to == State::BinFull || to == State::CleaningRequired || to == State::OverflowFull
+                || (from == State::SelfCheck && to == State::StandBy)
+                || (from == State::StandBy && to == State::CommandMode);
+        case State::BinFull:
+        case State::CleaningRequired:
+        case State::OverflowFull:
+            return to == State::StandBy;
+        case State::CommandMode:
+            return to == State::Grinding || to == State::Brewing || to == State::PrepMilk || to == State::StandBy;
+        case State::Grinding: return to == State::CommandMode || to == State::BeansEmpty || to == State::StandBy;
+        case State::Brewing: return to == State::CommandMode || to == State::WaterEmpty || to == State::StandBy;
+        case State::PrepMilk: return to == State::CommandMode || to == State::MilkEmpty || to == State::StandBy;
+        case State::BeansEmpty: return to == State::Grinding || to == State::StandBy;
+        case State::WaterEmpty: return to == State::Brewing || to == State::StandBy;
+        case State::MilkEmpty: return to == State::PrepMilk || to == State::StandBy;
+        }
+        return false;
+    }
+
+    /// Full containers and empty bins of the standard machine the soak runs on
+    CoffeeMaker::Levels fullLevels()
+    {
+        CoffeeMaker::Levels levels;
+        levels.beans = StandardProfile::beansMax;
+        levels.water = StandardProfile::waterMax;
+        levels.milk = StandardProfile::milkMax;
+        return levels;
+    }
+
+    /// Least squares slope of y over x
+    double slope(const std::vector<double>& x, const std::vector<double>& y)
+    {
+        const auto n = double(x.size());
+        double sx = 0, sy = 0, sxx = 0, sxy = 0;
+        for (size_t i = 0; i < x.size(); ++i) {
+            sx += x[i]; sy += y[i]; sxx += x[i] * x[i]; sxy += x[i] * y[i];
+        }
+        const auto d = n * sxx - sx * sx;
+        return d == 0 ? 0 : (n * sxy - sx * sy) / d;
+    }
+
+    /// Drives a machine and a CoffeeWeb with random but valid commands and checks invariants
+    class Soak
+    {
+    public:
+        Soak(double timeScale, quint32 seed, QTextStream& out)
+            : timeScale_(timeScale), random_(seed), out_(out)
+        {
+            maker_.setTimeScale(timeScale);
+
+            BackendModel model;
+            model.latency = std::make_shared<UniformLatency>(50, 1500);
+            model.timeoutErrorRate = 0.02;
+            model.serverErrorRate = 0.02;
+            model.timeScale = timeScale;
+            web_.setBackendModel(model);
+
+            QObject::connect(&maker_, &CoffeeMaker::currentStateChanged, &maker_, [this](State state) {
+                onState(state);
+            });
+            const auto checkLevels = [this]() { this->checkLevels(); };
+            QObject::connect(&maker_, &CoffeeMaker::waterContainerLevelChanged, &maker_, checkLevels);
+            QObject::connect(&maker_, &CoffeeMaker::milkContainerLevelChanged, &maker_, checkLevels);
+            QObject::connect(&maker_, &CoffeeMaker::beansContainerLevelChanged, &maker_, checkLevels);
+            QObject::connect(&maker_, &CoffeeMaker::restBinLevelChanged, &maker_, checkLevels);
+            QObject::connect(&maker_, &CoffeeMaker::overflowContainerLevelChanged, &maker_, checkLevels);
+            QObject::connect(&maker_, &CoffeeMaker::cupsProcessedChanged, &maker_, checkLevels);
+            QObject::connect(&maker_, &CoffeeMaker::levelsChanged, &maker_, checkLevels);
+
+            QObject::connect(&web_, &CoffeeWeb::recipesRequestReply, &web_, [this](quint32 id) {
+                finishRequest(id);
+            });
+            QObject::connect(&web_, &CoffeeWeb::recipesStreamFinished, &web_, [this](quint32 id) {
+                finishRequest(id);
+            });
+        }
+
+        /// Simulated milliseconds since the start
+        double simulatedMs() const { return double(clock_.nsecsElapsed()) / 1e6 / timeScale_; }
+
+        void start()
+        {
+            clock_.start();
+            scheduleWebRequest();
+        }
+
+        /// Stops issuing web requests, the outstanding ones still finish
+        void stopWeb() { webStopped_ = true; }
+
+        int outstandingRequests() const { return outstanding_.size(); }
+        quint64 violations() const { return violations_; }
+        quint64 transitions() const { return transitions_; }
+        quint64 commands() const { return commands_; }
+        quint64 requests() const { return requests_; }
+
+    private:
+        /// Runs `action` after `simulatedMs` unless the machine changed its state meanwhile
+        void later(int simulatedMs, std::function<void()> action)
+        {
+            const auto generation = generation_;
+            QTimer::singleShot(int(simulatedMs * timeScale_), &maker_, [this, generation, action]() {
+                if (generation != generation_) return;
+                ++commands_;
+                action();
+            });
+        }
+
+        int between(int low, int high) { return int(random_.bounded(quint32(low), quint32(high))); }
+        bool chance(double p) { return random_.generateDouble() < p; }
+
+        void violation(const QString& message)
+        {
+            if (++violations_ <= 10) {
+                out_ << "VIOLATION at " << simulatedMs() / 3.6e6 << " h: " << message << endl;
+            }
+        }
+
+        void checkLevels()
+        {
+            const auto within = [this](const char* name, int level, int max) {
+                if (level < 0 || level > max) violation(QString("%1 level %2 outside [0, %3]").arg(name).arg(level).arg(max));
+            };
+            within("water", maker_.waterContainerLevel(), maker_.waterContainerMax());
+            within("milk", maker_.milkContainerLevel(), maker_.milkContainerMax());
+            within("beans", maker_.beansContainerLevel(), maker_.beansContainerMax());
+            if (maker_.restBinLevel() < 0) violation("negative rest bin level");
+            if (maker_.overflowContainerLevel() < 0) violation("negative overflow level");
+            if (maker_.cupsProcessed() < 0) violation("negative cups processed");
+        }
+
+        void onState(State state)
+        {
+            ++transitions_;
+            ++generation_;
+            if (!isLegal(state_, state)) {
+                violation(QString("illegal transition %1 -> %2").arg(int(state_)).arg(int(state)));
+            }
+            if (state_ == State::StandBy && state == State::CommandMode
+                && (maker_.restBinLevel() >= maker_.restBinLevelMax()
+                    || maker_.overflowContainerLevel() >= maker_.overflowContainerMax()
+                    || maker_.cupsProcessed() >= maker_.maxCupsProcessedUntilCleanMode())) {
+                violation("command mode entered with a full container or cleaning required");
+            }
+            state_ = state;
+
+            switch (state) {
+            case State::Off:
+                later(between(1000, 10000), [this]() { maker_.turnOn(); });
+                break;
+            case State::StandBy:
+                step_ = 0;
+                if (chance(0.01)) {
+                    later(between(1000, 5000), [this]() { maker_.turnOff(); });
+                } else {
+                    later(between(2000, 30000), [this]() { refillLow(); maker_.startCommandMode(); });
+                }
+                break;
+            case State::CommandMode:
+                later(between(500, 3000), [this]() { nextStep(); });
+                break;
+            case State::BeansEmpty:
+                later(between(5000, 60000), [this]() { maker_.addBeanstoContainer(maker_.beansContainerMax()); });
+                break;
+            case State::WaterEmpty:
+                later(between(5000, 60000), [this]() { maker_.addWatertoContainer(maker_.waterContainerMax()); });
+                break;
+            case State::MilkEmpty:
+                if (chance(0.2)) later(between(2000, 10000), [this]() { maker_.cancelCommandMode(); });
+                else later(between(5000, 60000), [this]() { maker_.addMilkToContainer(maker_.milkContainerMax()); });
+                break;
+            case State::BinFull:
+                later(between(5000, 60000), [this]() { maker_.emptyRestBinContainer(); });
+                break;
+            case State::OverflowFull:
+                later(between(5000, 60000), [this]() { maker_.emptyOverflowContainer(); });
+                break;
+            case State::CleaningRequired:
+                later(between(10000, 120000), [this]() { maker_.cleanTheMachine(); });
+                break;
+            default:
+                break; // timed steps
+            }
+        }
+
+        /// Tops the containers up now and then, like a barista would
+        void refillLow()
+        {
+            if (maker_.waterContainerLevel() < maker_.waterContainerMax() / 4 && chance(0.5)) {
+                maker_.addWatertoContainer(maker_.waterContainerMax());
+            }
+            if (maker_.beansContainerLevel() < maker_.beansContainerMax() / 4 && chance(0.5)) {
+                maker_.addBeanstoContainer(maker_.beansContainerMax());
+            }
+            if (maker_.milkContainerLevel() < maker_.milkContainerMax() / 4 && chance(0.5)) {
+                maker_.addMilkToContainer(maker_.milkContainerMax());
+            }
+        }
+
+        /// Grind, brew, optionally milk, then finish; sometimes cancelled
+        void nextStep()
+        {
+            if (chance(0.02)) {
+                maker_.cancelCommandMode();
+                step_ = 0;
+                return;
+            }
+            switch (step_++) {
+            case 0:
+                if (chance(0.95)) maker_.placeCup();
+                else maker_.removeCup();
+                maker_.doGrinding(between(7, 21), CoffeeMaker::GrindLevel(between(0, 7)));
+                break;
+            case 1:
+                maker_.doBrew(between(30, 250), between(85, 97));
+                break;
+            case 2:
+                if (chance(0.4)) {
+                    maker_.doMilkPrep(between(50, 200), between(60, 86), chance(0.5));
+                    break;
+                }
+                Q_FALLTHROUGH();
+            default:
+                maker_.finishCommandMode();
+                step_ = 0;
+                break;
+            }
+        }
+
+        void scheduleWebRequest()
+        {
+            if (webStopped_) return;
+            QTimer::singleShot(int(between(10000, 120000) * timeScale_), &web_, [this]() {
+                const auto id = chance(0.5) ? web_.requestRecipesStreamed() : web_.requestRecipes();
+                outstanding_.insert(id);
+                ++requests_;
+                if (chance(0.1)) {
+                    web_.cancelRequest(id);
+                    outstanding_.remove(id);
+                }
+                scheduleWebRequest();
+            });
+        }
+
+        void finishRequest(quint32 id)
+        {
+            if (!outstanding_.remove(id)) violation(QString("reply for unknown or cancelled request %1").arg(id));
+        }
+
+    private:
+        const double timeScale_;
+        QRandomGenerator random_;
+        QTextStream& out_;
+        CoffeeMaker maker_ {fullLevels()};
+        CoffeeWeb web_;
+        QElapsedTimer clock_;
+
+        State state_ = State::Unknown;
+        quint64 generation_ = 0;
+        int step_ = 0;
+        bool webStopped_ = false;
+        QSet<quint32> outstanding_;
+
+        quint64 violations_ = 0;
+        quint64 transitions_ = 0;
+        quint64 commands_ = 0;
+        quint64 requests_ = 0;
+    };
+}
+
+// Drives a CoffeeMaker and a CoffeeWeb with random valid commands for hours of simulated time,
+// checks invariants and fails on memory or throughput drift, e.g.:
+//   coffee-soak --hours 24 --time-scale 0.001
+int main(int argc, char** argv)
+{
+  QCoreApplication app(argc, argv);
+
+  QCommandLineParser parser;
+  parser.setApplicationDescription("Soak test for the CoffeeMaker and CoffeeWeb");
+  parser.addHelpOption();
+  parser.addOption({"hours", "Simulated hours (default: 24).", "hours", "24"});
+  parser.addOption({"time-scale", "Real time per simulated time (default: 0.001).", "factor", "0.001"});
+  parser.addOption({"sample", "Sample interval in simulated minutes (default: 30).", "minutes", "30"});
+  parser.addOption({"seed", "Random seed (default: 1).", "seed", "1"});
+  parser.addOption({"max-rss-growth", "Allowed RSS growth after warm-up in MiB (default: 8).", "MiB", "8"});
+  parser.addOption({"max-live-growth", "Allowed growth of live allocations after warm-up (default: 5000).",
+                    "count", "5000"});
+  parser.addOption({"max-throughput-drop", "Allowed throughput drop in percent (default: 25).", "percent", "25"});
+  parser.process(app);
+
+  const auto hours = qMax(0.01, parser.value("hours").toDouble());
+  const auto timeScale = qBound(1e-6, parser.value("time-scale").toDouble(), 1.0);
+  const auto sampleMs = qMax(1.0, parser.value("sample").toDouble()) * 60000;
+  const auto maxRssGrowthKiB = parser.value("max-rss-growth").toDouble() * 1024;
+  const auto maxLiveGrowth = parser.value("max-live-growth").toDouble();
+  const auto maxThroughputDrop = parser.value("max-throughput-drop").toDouble() / 100;
+
+  // The machine persists its levels, keep them away from the real machine's settings
+  const SettingsSandbox settingsSandbox;
+
+  QTextStream out(stdout);
+  Soak soak(timeScale, parser.value("seed").toUInt(), out);
+
+  std::vector<Sample> samples;
+  quint64 lastTransitions = 0;
+  quint64 lastCommands = 0;
+  double lastRealSeconds = 0;
+  QElapsedTimer real;
+
+  out << "sim h\treal s\tRSS KiB\tlive allocs\ttransitions\tcommands\ttransitions/s" << endl;
+  const auto sampler = new QTimer(&app);
+  sampler->setInterval(qMax(1, int(sampleMs * timeScale)));
+  QObject::connect(sampler, &QTimer::timeout, &app, [&]() {
+    Sample sample;
+    sample.simulatedHours = soak.simulatedMs() / 3.6e6;
+    sample.realSeconds = double(real.nsecsElapsed()) / 1e9;
+    sample.rssKiB = residentKiB();
+    sample.liveAllocations = qint64(allocations.load(std::memory_order_relaxed) - deallocations.load(std::memory_order_relaxed));
+    sample.transitions = soak.transitions() - lastTransitions;
+    sample.commands = soak.commands() - lastCommands;
+    sample.transitionsPerSecond = double(sample.transitions) / qMax(1e-9, sample.realSeconds - lastRealSeconds);
+    lastTransitions = soak.transitions();
+    lastCommands = soak.commands();
+    lastRealSeconds = sample.realSeconds;
+    samples.push_back(sample);
+    out << sample.simulatedHours << '\t' << sample.realSeconds << '\t' << sample.rssKiB << '\t'
+        << sample.liveAllocations << '\t' << sample.transitions << '\t' << sample.commands << '\t'
+        << sample.transitionsPerSecond << endl;
+
+    if (sample.simulatedHours < hours) return;
+    sampler->stop();
+    // Lets the outstanding requests finish, their timeouts are scaled as well
+    soak.stopWeb();
+    QTimer::singleShot(qMax(100, int(10000 * timeScale)), &app, &QCoreApplication::quit);
+  });
+
+  real.start();
+  soak.start();
+  sampler->start();
+  app.exec();
+
+  // Drift after the first 20% (allocator pools, caches and QSettings warm up)
+  bool failed = soak.violations() > 0;
+  std::vector<double> x, rss, live;
+  const auto warmUp = samples.size() / 5;
+  for (size_t i = warmUp; i < samples.size(); ++i) {
+    x.push_back(samples[i].simulatedHours);
+    rss.push_back(double(samples[i].rssKiB));
+    live.push_back(double(samples[i].liveAllocations));
+  }
+  out << "\n" << soak.transitions() << " transitions, " << soak.commands() << " commands, "
+      << soak.requests() << " web requests, " << soak.violations() << " invariant violations" << endl;
+
+  if (x.size() < 4) {
+    out << "Too few samples for a drift analysis, use more --hours or a shorter --sample" << endl;
+    return failed ? 1 : 0;
+  }
+  const auto span = x.back() - x.front();
+  const auto rssGrowth = slope(x, rss) * span;
+  const auto liveGrowth = slope(x, live) * span;
+  const auto third = x.size() / 3;
+  double early = 0, late = 0;
+  for (size_t i = 0; i < third; ++i) {
+    early += samples[warmUp + i].transitionsPerSecond;
+    late += samples[samples.size() - 1 - i].transitionsPerSecond;
+  }
+  const auto drop = early > 0 ? 1.0 - late / early : 0.0;
+
+  const auto verdict = [&](bool ok) { failed |= !ok; return ok ? "ok" : "FAIL"; };
+  out << "RSS growth " << rssGrowth / 1024 << " MiB: " << verdict(rssGrowth <= maxRssGrowthKiB) << '\n'
+      << "live allocation growth " << liveGrowth << ": " << verdict(liveGrowth <= maxLiveGrowth) << '\n'
+      << "throughput drop " << drop * 100 << " %: " << verdict(drop <= maxThroughputDrop) << '\n'
+      << "outstanding web requests " << soak.outstandingRequests() << ": "
+      << verdict(soak.outstandingRequests() == 0) << endl;
+  return failed ? 1 : 0;
+}